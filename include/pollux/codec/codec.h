@@ -2,6 +2,7 @@
 #define POLLUX_CODEC_CODEC_H
 
 #include "pollux/codec/av1.h"
+#include "pollux/codec/h264.h"
 #include "pollux/codec/hevc.h"
 
 #ifndef codec_range_min
@@ -0,0 +1,81 @@
+#ifndef POLLUX_CODEC_H264_H
+#define POLLUX_CODEC_H264_H
+
+/**
+ * @brief Bit rate control mode for H.264.
+ */
+typedef enum {
+  h264_rc_none,
+
+  /**
+   * @brief Constant Rate Factor (CRF) mode.
+   */
+  h264_rc_crf,
+} h264_rate_t;
+
+/**
+ * @brief Tune options for H.264.
+ */
+typedef enum {
+  h264_tune_none,
+
+  /**
+   * @brief Zero latency, suitable for live streaming.
+   */
+  h264_tune_zerolatency,
+
+  /**
+   * @brief Optimize for fast encoding and decoding.
+   */
+  h264_tune_fast_codec,
+} h264_tune_t;
+
+/**
+ * @brief H.264 encodes parameter. The bit rate and the GOP size are the ones of
+ * `pollux_encode_args_t`.
+ */
+typedef struct {
+  /**
+   * @brief Encoding speed/preset level. Higher is faster.
+   *
+   * @note Range: codec_range_min ~ codec_range_max.
+   * If the configuration is set to 0, no changes will be made.
+   */
+  int speed_level;
+
+  /**
+   * @brief Rate control mode.
+   *
+   * @note If the configuration is set to `h264_rc_none`, no changes will be
+   * made.
+   */
+  h264_rate_t rc_mode;
+
+  /**
+   * @brief Quality level for Constant Rate Factor (CRF) mode. Higher is
+   * better.
+   *
+   * @note This parameter is used for `CRF` mode.
+   * Range: codec_range_min ~ codec_range_max.
+   * If the configuration is set to 0, no changes will be made.
+   */
+  int quality_level;
+
+  /**
+   * @brief Tuning option for the encoder.
+   *
+   * @note If the configuration is set to `h264_tune_none`, no changes will be
+   * made.
+   */
+  h264_tune_t tune_mode;
+
+  /**
+   * @brief Advanced options of the encoder library in a key-value string
+   * format, e.g. the `x264-params` of `libx264`.
+   *
+   * @example "scenecut=0:rc-lookahead=0"
+   */
+  const char *advanced_options;
+} h264_encode_args_t;
+
+#endif // POLLUX_CODEC_H264_H
@@ -6,10 +6,15 @@
 
 #include "pollux/codec/av1.h"
 #include "pollux/codec/codec.h"
+#include "pollux/codec/h264.h"
 #include "pollux/codec/hevc.h"
 #include "pollux/internal/util.h"
 #include "pollux/pollux_codec_id.h"
 
+#if !defined(codec_h264_libx264)
+#  define codec_h264_libx264
+#endif
+
 #if !defined(codec_hevc_libx265) && !defined(codec_hevc_hevc_nvenc) && \
   !defined(codec_hevc_hevc_amf) && !defined(codec_hevc_hevc_qsv)
 #  define codec_hevc_libx265
@@ -25,6 +30,7 @@ static inline void codec_range_check_or_set(int *range) {
   range_set(codec_range_min, codec_range_max, range);
 }
 
+void h264_priv_set(void *cc_priv, const h264_encode_args_t *args);
 void hevc_priv_set(void *cc_priv, const hevc_encode_args_t *args);
 void av1_priv_set(void *cc_priv, const av1_encode_args_t *args);
 
@@ -2,9 +2,12 @@
 #define POLLUX_INTERNAL_CODEC_FFMPEG_DECODE_H
 
 #include <libavcodec/avcodec.h>
+#include <libavcodec/bsf.h>
 #include <libavformat/avformat.h>
 #include <libavutil/avutil.h>
 
+#include "pollux/internal/codec/ffmpeg_io.h"
+
 /**
  * @brief Decoder configuration parameters.
  */
@@ -13,6 +16,44 @@ typedef struct {
    * @brief Number of threads for decoding. 0 for auto.
    */
   int thread_count;
+
+  /**
+   * @brief Read local files through the memory-mapped input backend.
+   */
+  bool mmap_enable;
+
+  /**
+   * @brief The size of the readahead window in bytes, 0 to disable the
+   * readahead thread.
+   */
+  int64_t prefetch_size;
+
+  /**
+   * @brief Minimize the buffering of the demuxer and the delay of the decoder.
+   */
+  bool low_delay;
+
+  /**
+   * @brief Set to `AVCodecContext.draw_horiz_band` together with `opaque`,
+   * the decoder fails to open when the codec does not support it. The codec
+   * is then opened with a single thread, so that the callback is never called
+   * concurrently.
+   */
+  void (*draw_horiz_band)(AVCodecContext *s, const AVFrame *src,
+                          int offset[AV_NUM_DATA_POINTERS], int y, int type,
+                          int height);
+  void *opaque;
+
+  /**
+   * @brief The time base of the packets, only used by
+   * `ffmpeg_decoder_create_codec` and `ffmpeg_decoder_create_par`.
+   */
+  AVRational pkt_timebase;
+
+  /**
+   * @brief `AV_CODEC_EXPORT_DATA_*` of the codec context.
+   */
+  int export_side_data;
 } ffmpeg_decode_args_t;
 
 typedef struct {
@@ -23,6 +64,24 @@ typedef struct {
 
   AVFrame *frame;
   AVPacket *pkt;
+
+  /**
+   * @brief Custom input backend, nullptr if the protocol of the url is used.
+   */
+  ffmpeg_io_t *io;
+
+  /**
+   * @brief The Annex B conversion of the packets read by
+   * `ffmpeg_decoder_read_packet`, nullptr if it is not needed.
+   */
+  AVBSFContext *bsf;
+
+  /**
+   * @brief The parser of the packets read by `ffmpeg_decoder_read_packet`
+   * and its codec context, nullptr if it is not opened.
+   */
+  AVCodecParserContext *parser;
+  AVCodecContext *parser_ctx;
 } ffmpeg_decode_t;
 
 /**
@@ -30,11 +89,14 @@ typedef struct {
  * This function handles `avformat_open_input` and `avformat_find_stream_info`.
  *
  * @param[in] url The input media URL (file path, rtsp, etc.).
+ * @param[in] args Decoder configuration parameters. Can be nullptr for default
+ * settings.
  *
  * @return A pointer to the `ffmpeg_decode_t` context on success, nullptr on
  * failure.
  */
-ffmpeg_decode_t *ffmpeg_decoder_create(const char *url);
+ffmpeg_decode_t *ffmpeg_decoder_create(const char *url,
+                                       const ffmpeg_decode_args_t *args);
 
 /**
  * @brief Destroys the decoder context and frees all associated resources.
@@ -58,6 +120,92 @@ void ffmpeg_decoder_destroy(ffmpeg_decode_t **d_ptr);
 int ffmpeg_decoder_open_stream(ffmpeg_decode_t *d, enum AVMediaType media_type,
                                const ffmpeg_decode_args_t *args);
 
+/**
+ * @brief Finds a specific media stream without opening a decoder, for reading
+ * the compressed packets only. The stream is not required to have a decoder,
+ * and the other streams are discarded.
+ *
+ * @param[in] d The decoder context created by ffmpeg_decoder_create.
+ * @param[in] media_type The type of media to find (e.g., AVMEDIA_TYPE_VIDEO).
+ *
+ * @return 0 on success, a negative error code on failure.
+ */
+int ffmpeg_decoder_find_stream(ffmpeg_decode_t *d, enum AVMediaType media_type);
+
+/**
+ * @brief Sets up the conversion of the packets of the stream found by
+ * `ffmpeg_decoder_find_stream` to Annex B, when the stream is H.264/HEVC in
+ * the length-prefixed format. Otherwise nothing is done.
+ *
+ * @param[in] d The decoder context.
+ *
+ * @return 0 on success, a negative error code on failure.
+ */
+int ffmpeg_decoder_annexb_open(ffmpeg_decode_t *d);
+
+/**
+ * @brief Sets up the parser of the codec of the stream found by
+ * `ffmpeg_decoder_find_stream`, after the Annex B conversion if any. Nothing
+ * is done if the codec has no parser.
+ *
+ * @param[in] d The decoder context.
+ *
+ * @return 0 on success, a negative error code on failure.
+ */
+int ffmpeg_decoder_parser_open(ffmpeg_decode_t *d);
+
+/**
+ * @brief Parses a packet read by `ffmpeg_decoder_read_packet`, without
+ * decoding it.
+ *
+ * @param[in] d The decoder context.
+ * @param[in] pkt A complete frame of the stream.
+ *
+ * @return The picture type of the packet, `AV_PICTURE_TYPE_NONE` if unknown.
+ */
+enum AVPictureType ffmpeg_decoder_parse(ffmpeg_decode_t *d,
+                                        const AVPacket *pkt);
+
+/**
+ * @brief Reads the next packet of the stream, through the Annex B conversion
+ * if it is set up. The packets of the other streams are skipped.
+ *
+ * @param[in] d The decoder context.
+ * @param[out] pkt The packet, which must be unreferenced by the caller.
+ *
+ * @return 0 on success, `pollux_err_stream_end` at the end of the url, a
+ * negative error code on failure.
+ */
+int ffmpeg_decoder_read_packet(ffmpeg_decode_t *d, AVPacket *pkt);
+
+/**
+ * @brief Creates a decoder context without a demuxer, for feeding the packets
+ * directly. `fmt_ctx` is nullptr and `stream_index` is invalid.
+ *
+ * @param[in] codec_id The codec of the packets.
+ * @param[in] args Decoder configuration parameters. Can be nullptr for default
+ * settings.
+ *
+ * @return A pointer to the `ffmpeg_decode_t` context on success, nullptr on
+ * failure.
+ */
+ffmpeg_decode_t *ffmpeg_decoder_create_codec(enum AVCodecID codec_id,
+                                             const ffmpeg_decode_args_t *args);
+
+/**
+ * @brief Same as `ffmpeg_decoder_create_codec`, with the codec parameters of
+ * the packets, e.g. the `par_out` of the conversion of a demuxer.
+ *
+ * @param[in] par The codec parameters of the packets, including the extradata.
+ * @param[in] args Decoder configuration parameters. Can be nullptr for default
+ * settings.
+ *
+ * @return A pointer to the `ffmpeg_decode_t` context on success, nullptr on
+ * failure.
+ */
+ffmpeg_decode_t *ffmpeg_decoder_create_par(const AVCodecParameters *par,
+                                           const ffmpeg_decode_args_t *args);
+
 /**
  * @brief Allocates reusable resources (AVPacket and AVFrame) for the decoding
  * loop.
@@ -69,6 +69,8 @@ typedef struct {
 } ffmpeg_encode_t;
 
 void ffmpeg_encoder_deinit(ffmpeg_encode_t *e);
+int ffmpeg_encoder_alloc(ffmpeg_encode_t *e, const char *url,
+                         const char *cont_fmt);
 int ffmpeg_encoder_init(ffmpeg_encode_t *e, const char *url,
                         const char *cont_fmt);
 void ffmpeg_encoder_ctx_free(ffmpeg_encode_t *e);
@@ -77,4 +79,16 @@ int ffmpeg_encoder_ctx_alloc(ffmpeg_encode_t *e, ffmpeg_encode_args_t *args,
 void ffmpeg_encoder_close(ffmpeg_encode_t *e);
 int ffmpeg_encoder_open(ffmpeg_encode_t *e);
 
+/**
+ * @brief Allocate the codec context only, without an output stream. When
+ * `fmt_ctx` is nullptr, the parameter sets are kept in-band.
+ */
+int ffmpeg_encoder_codec_alloc(ffmpeg_encode_t *e, ffmpeg_encode_args_t *args,
+                               enum AVCodecID codec_id);
+
+/**
+ * @brief Open the codec context allocated by `ffmpeg_encoder_codec_alloc`.
+ */
+int ffmpeg_encoder_codec_open(ffmpeg_encode_t *e);
+
 #endif // POLLUX_INTERNAL_CODEC_FFMPEG_ENCODE_H
@@ -0,0 +1,105 @@
+#ifndef POLLUX_INTERNAL_CODEC_FFMPEG_IO_H
+#define POLLUX_INTERNAL_CODEC_FFMPEG_IO_H
+
+#include <libavformat/avio.h>
+#include <string.h>
+
+#include "pollux/internal/decls.h"
+
+/**
+ * @brief Custom input backend, which is handed to the demuxer through the
+ * `pb` member of the `AVFormatContext` (`AVFMT_FLAG_CUSTOM_IO`).
+ */
+typedef struct ffmpeg_io_t {
+  /**
+   * @brief The `AVIO` context, which reads through the backend.
+   */
+  AVIOContext *avio;
+
+  /**
+   * @brief Private data of the backend.
+   */
+  void *priv_data;
+
+  /**
+   * @brief Release the private data of the backend. The `avio` member is
+   * released by the `ffmpeg_io_close` function.
+   */
+  void (*close)(struct ffmpeg_io_t *io);
+} ffmpeg_io_t;
+
+/**
+ * @brief Whether the url can be served by a local file backend, that is, the
+ * url is a plain path or uses the `file:` protocol.
+ */
+static inline bool ffmpeg_io_url_is_local(const char *url) {
+  if (!url)
+    return false;
+  if (!strncmp(url, "file:", 5))
+    return true;
+
+  return strstr(url, "://") ? false : true;
+}
+
+/**
+ * @brief Skip the `file:` protocol prefix of a local url.
+ */
+static inline const char *ffmpeg_io_url_to_path(const char *url) {
+  return strncmp(url, "file:", 5) ? url : url + 5;
+}
+
+/**
+ * @brief Allocate the input backend and its `AVIO` context.
+ *
+ * @param[out] io_ptr The input backend.
+ * @param[in] priv_data Private data of the backend, which is the `opaque` of
+ * the callbacks.
+ * @param[in] buffer_size The size of the `AVIO` buffer.
+ * @param[in] read_packet, seek Callbacks of the `AVIO` context.
+ * @param[in] close Release the private data.
+ *
+ * @return 0 on success, error code otherwise. On failure, the `close` callback
+ * is not called.
+ */
+int ffmpeg_io_alloc(ffmpeg_io_t **io_ptr, void *priv_data, int buffer_size,
+                    int (*read_packet)(void *opaque, uint8_t *buf,
+                                       int buf_size),
+                    int64_t (*seek)(void *opaque, int64_t offset, int whence),
+                    void (*close)(ffmpeg_io_t *io));
+
+/**
+ * @brief Open a memory-mapped input for a local file. The file is mapped
+ * read-only as a whole, and the kernel is advised to read ahead sequentially,
+ * so that refilling the `AVIO` buffer is served from the page cache without a
+ * `read` system call.
+ *
+ * @param[out] io_ptr The input backend.
+ * @param[in] url Local file path, `file:` prefix is allowed.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+int ffmpeg_io_mmap_open(ffmpeg_io_t **io_ptr, const char *url);
+
+/**
+ * @brief Open an input with a readahead thread. The url is opened through the
+ * protocol of ffmpeg, and a separate thread keeps up to `size` bytes read
+ * ahead of the demuxer in a ring buffer, so that the demuxer is not blocked
+ * on the latency of the storage at steady state. A seek outside the buffered
+ * range invalidates the buffer and restarts the readahead from the new
+ * position.
+ *
+ * @param[out] io_ptr The input backend.
+ * @param[in] url Input url.
+ * @param[in] size The size of the readahead window in bytes.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+int ffmpeg_io_prefetch_open(ffmpeg_io_t **io_ptr, const char *url,
+                            int64_t size);
+
+/**
+ * @brief Close the input backend, it will be set to nullptr after closing.
+ */
+void ffmpeg_io_close(ffmpeg_io_t **io_ptr);
+
+#endif // POLLUX_INTERNAL_CODEC_FFMPEG_IO_H
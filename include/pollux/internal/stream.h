@@ -0,0 +1,66 @@
+#ifndef POLLUX_INTERNAL_STREAM_H
+#define POLLUX_INTERNAL_STREAM_H
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+
+#include "pollux/internal/ffmpeg_cvt/codec_id.h"
+#include "pollux/internal/ffmpeg_cvt/pixel.h"
+#include "pollux/pollux_stream.h"
+
+/**
+ * @brief Fill the stream information from an opened codec context.
+ *
+ * @param[in] fc The format context, nullptr if there is no demuxer.
+ * @param[in] time_base The time base of the timestamps.
+ */
+static inline void stream_fill_codec(pollux_stream_info_t *s,
+                                     const AVCodecContext *cc,
+                                     const AVFormatContext *fc,
+                                     AVRational time_base) {
+  s->video_width = cc->width;
+  s->video_height = cc->height;
+  s->bit_rate = cc->bit_rate;
+  s->video_frame_rate.num = cc->framerate.num;
+  s->video_frame_rate.den = cc->framerate.den;
+  s->max_b_frames = cc->max_b_frames;
+  s->gop_size = cc->gop_size;
+
+  cvt_pix_ff_to_plx(cc->pix_fmt, &s->video_img_fmt);
+  cvt_codec_id_ff_to_plx(cc->codec_id, &s->video_codec_id);
+
+  s->duration = fc ? fc->duration : 0;
+  s->time_base.num = time_base.num;
+  s->time_base.den = time_base.den;
+}
+
+/**
+ * @brief Fill the stream information from the parameters of a demuxed stream,
+ * without a codec context. The fields that are only known by the decoder,
+ * `max_b_frames` and `gop_size`, are 0.
+ */
+static inline void stream_fill_par(pollux_stream_info_t *s,
+                                   const AVFormatContext *fc,
+                                   const AVStream *st) {
+  const AVCodecParameters *par = st->codecpar;
+
+  s->video_width = par->width;
+  s->video_height = par->height;
+  s->bit_rate = par->bit_rate;
+
+  AVRational fr = st->avg_frame_rate.num ? st->avg_frame_rate
+                                         : st->r_frame_rate;
+  s->video_frame_rate.num = fr.num;
+  s->video_frame_rate.den = fr.den;
+  s->max_b_frames = 0;
+  s->gop_size = 0;
+
+  cvt_pix_ff_to_plx((enum AVPixelFormat)par->format, &s->video_img_fmt);
+  cvt_codec_id_ff_to_plx(par->codec_id, &s->video_codec_id);
+
+  s->duration = fc->duration > 0 ? fc->duration : 0;
+  s->time_base.num = st->time_base.num;
+  s->time_base.den = st->time_base.den;
+}
+
+#endif // POLLUX_INTERNAL_STREAM_H
@@ -6,8 +6,12 @@
 #ifndef POLLUX_DECODE_H
 #define POLLUX_DECODE_H
 
+#include <stdbool.h>
+
 #include "pollux/pollux_codec_id.h"
 #include "pollux/pollux_frame.h"
+#include "pollux/pollux_packet.h"
+#include "pollux/pollux_stream.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -26,6 +30,56 @@ extern "C" {
  * (6) Call the `pollux_decode_deinit` function to release the decoder handle.
  */
 
+/**
+ * @brief What the decoding thread does when the result cache is full, that is,
+ * when the consumer is slower than the source.
+ */
+typedef enum {
+  /**
+   * @brief Wait until a result is released. Nothing is lost, but a live source
+   * falls behind real time without a bound.
+   */
+  pollux_decode_drop_block = 0,
+
+  /**
+   * @brief Discard the oldest result that has not been fetched yet, so that
+   * `result_get` always returns the most recent frames.
+   */
+  pollux_decode_drop_oldest,
+
+  /**
+   * @brief Discard the newly decoded frame, the cached results are kept.
+   */
+  pollux_decode_drop_newest,
+} pollux_decode_drop_policy_t;
+
+/**
+ * @brief The packet is a key frame, see `send_packet`. The flags are the same
+ * as those of `pollux_packet_t`, so that the demuxed packets can be sent as
+ * they are.
+ */
+#define POLLUX_DECODE_PACKET_FLAG_KEY POLLUX_PACKET_FLAG_KEY
+
+/**
+ * @brief Side data exported with the frames, see
+ * `pollux_decode_args_t.export_side_data`.
+ */
+#define POLLUX_DECODE_EXPORT_MVS (1 << 0)
+#define POLLUX_DECODE_EXPORT_QP (1 << 1)
+
+/**
+ * @brief Band callback, see `pollux_decode_args_t.band_cb`.
+ *
+ * @param[in] opaque `pollux_decode_args_t.band_opaque`.
+ * @param[in] frame The frame being decoded. Only the rows [y, y + height) are
+ * valid in this call, the timestamps may not be set yet.
+ * @param[in] y The first row of the band.
+ * @param[in] height The number of rows of the band.
+ */
+typedef void (*pollux_decode_band_cb_t)(void *opaque,
+                                        const pollux_frame_t *frame, int y,
+                                        int height);
+
 /**
  * @brief Decoding parameter.
  */
@@ -64,49 +118,183 @@ typedef struct {
    * image parameters, the image will not be converted multiple times.
    */
   pollux_img_t *fmt_cvt_img;
-} pollux_decode_args_t;
 
-typedef struct {
   /**
-   * @brief Video width and height.
+   * @brief Read local files through a memory-mapped input instead of the
+   * `file:` protocol of ffmpeg. The whole file is mapped read-only and the
+   * kernel is advised to read ahead sequentially, so demuxing is served from
+   * the page cache without a `read` system call per buffer refill.
+   *
+   * @note
+   * - (1) This parameter only takes effect for local files (a plain path or a
+   * `file:` url), it is ignored for network urls.
+   *
+   * - (2) When the file cannot be mapped, or the platform does not support
+   * `mmap`, the default protocol is used instead.
+   *
+   * - (3) When `prefetch_size_mb` is also configured, the readahead thread is
+   * used instead.
+   */
+  bool mmap_enable;
+
+  /**
+   * @brief The size of the input readahead window, unit: MB. 0 to disable.
+   *
+   * When it is configured, the input is read on a separate thread, which keeps
+   * up to this many megabytes buffered ahead of the demuxer. It is intended
+   * for slow storage, such as network filesystems or spinning disks, where
+   * `av_read_frame` would otherwise block the decoding on the latency of every
+   * cold block. A seek outside the buffered range invalidates the window and
+   * restarts the readahead from the new position.
+   */
+  int prefetch_size_mb;
+
+  /**
+   * @brief The number of extra times the url is played after reaching its end.
+   * 0 disables looping, a negative value loops forever.
+   *
+   * When looping, the decoding thread seeks back to the start by itself, so
+   * `result_get` does not return `pollux_err_stream_end` at the loop point and
+   * the frame delivery has no gap. The timestamps of the frames keep
+   * increasing across the loop point, each pass is offset by the duration of
+   * the previous passes.
+   *
+   * @note The timestamp offset is reset by `seek_file`.
+   */
+  int loop_count;
+
+  /**
+   * @brief Backpressure policy when the result cache is full, see
+   * `pollux_decode_drop_policy_t`. The default value is
+   * `pollux_decode_drop_block`.
+   *
+   * @note For live monitoring, `pollux_decode_drop_oldest` with a small
+   * `cache_count` bounds the latency to the depth of the cache.
+   */
+  pollux_decode_drop_policy_t drop_policy;
+
+  /**
+   * @brief The lag behind the wall clock tolerated before the decoder starts
+   * to catch up, unit: ms. 0 disables the catch-up mode.
+   *
+   * When the result cache is full or the output timestamps fall behind the
+   * wall clock by more than this value, the decoding work is reduced step by
+   * step: first the non-reference frames are skipped by the decoder, then
+   * only the key frames are decoded and the image conversion is skipped while
+   * results are still pending. Full decoding is restored once the pipeline
+   * has caught up.
+   *
+   * @note This is intended for live sources. For a file, a consumer slower
+   * than the decoder keeps the cache full, so frames will be skipped.
+   */
+  int catch_up_lag_ms;
+
+  /**
+   * @brief Low-latency profile for live ingest.
+   *
+   * - (1) The demuxer does not buffer packets and the probing of the input is
+   * limited to the first few tens of kilobytes.
+   *
+   * - (2) The decoder runs with `AV_CODEC_FLAG_LOW_DELAY` and slice threading
+   * instead of frame threading, so that a frame is output as soon as it is
+   * decoded.
+   *
+   * - (3) `cache_count` is set to 1 and `drop_policy` to
+   * `pollux_decode_drop_oldest`, so that `result_get` always returns the
+   * latest frame.
+   *
+   * @note The source is expected to be encoded without B-frames, otherwise
+   * the reordering delay of the stream remains.
+   */
+  bool low_delay;
+
+  /**
+   * @brief Band callback. When it is configured, the rows of the current frame
+   * are handed to the callback as soon as they are decoded, before the whole
+   * frame is finished, so that the consumer can start working on the top of
+   * the image early. When `fmt_cvt_img` is configured, each band is converted
+   * on its own and the converted rows are passed.
+   *
+   * @note
+   * - (1) The callback is called on the decoding thread and must return
+   * quickly, the frame is only valid during the call. The bands always come
+   * from this single thread, one at a time.
+   *
+   * - (2) The decoder is single-threaded, `thread_count` is ignored. Only the
+   * codecs with the band capability of ffmpeg are supported (e.g. MPEG-1/2,
+   * MPEG-4 Part 2), H.264, HEVC, AV1 and the hardware decoders are not,
+   * `param_set` fails for them.
+   *
+   * - (3) The complete frames are still returned by `result_get`.
+   */
+  pollux_decode_band_cb_t band_cb;
+
+  /**
+   * @brief The opaque pointer passed to `band_cb`.
    */
-  int video_width, video_height;
+  void *band_opaque;
 
   /**
-   * @brief The average bitrate.
+   * @brief Packet mode only. When it is configured, the data passed to
+   * `send_packet` is not copied, it is referenced by the decoder until this
+   * callback is called with the same pointer.
+   *
+   * @note The data must stay valid until the callback, and must be followed
+   * by 64 bytes of zeroed padding, which is the padding required by the
+   * bitstream readers of ffmpeg.
    */
-  int64_t bit_rate;
+  void (*packet_release_cb)(void *opaque, const uint8_t *data);
 
   /**
-   * @brief Video frame rate. In general, frame rate = num / den.
+   * @brief The opaque pointer passed to `packet_release_cb`.
    */
-  pollux_rational video_frame_rate;
+  void *packet_opaque;
 
   /**
-   * @brief Maximum number of B-frames between non-B-frames.
+   * @brief `POLLUX_DECODE_EXPORT_*`. The decoder exports the motion vectors
+   * and the quantization parameters of the blocks with the frames, which are
+   * read by `pollux_frame_mvs_get` and `pollux_frame_qp_get`, e.g. for motion
+   * analysis in the compressed domain without a pass over the pixels.
+   *
+   * @note The export is up to the decoder of ffmpeg: the motion vectors are
+   * exported by the H.264 and MPEG-1/2/4 decoders, and the quantization
+   * parameters by the H.264, MPEG-2 and VP9 decoders. The other decoders,
+   * including HEVC, ignore it.
    */
-  int max_b_frames;
+  int export_side_data;
+} pollux_decode_args_t;
 
+/**
+ * @brief Decoding statistics, counted since the last `param_set`.
+ */
+typedef struct {
   /**
-   * @brief The number of pictures in a group of pictures.
+   * @brief The number of frames output by the decoder.
    */
-  int gop_size;
+  uint64_t frames_decoded;
 
   /**
-   * @brief Video frame format.
+   * @brief The number of frames discarded by the backpressure policy.
    */
-  pollux_pix_fmt_t video_img_fmt;
+  uint64_t frames_dropped;
 
   /**
-   * @brief Video encoding format.
+   * @brief The number of decoded frames discarded before the image conversion
+   * by the catch-up mode. The frames skipped inside the decoder are never
+   * output, so they are not counted in `frames_decoded` either.
    */
-  pollux_codec_id_t video_codec_id;
+  uint64_t frames_skipped;
 
   /**
-   * @brief Stream duration, unit: us, 0 if unrecognized.
+   * @brief The current catch-up level, 0 means full decoding.
    */
-  int64_t duration;
-} pollux_decode_stream_info_t;
+  int catch_up_level;
+} pollux_decode_stats_t;
+
+/**
+ * @brief Stream information of the decoder, see `pollux_stream_info_t`.
+ */
+typedef pollux_stream_info_t pollux_decode_stream_info_t;
 
 /**
  * @brief Decode handle.
@@ -190,6 +378,14 @@ typedef struct pollux_decode_t {
   /**
    * @brief Seek to timestamp ts.
    *
+   * The seek is posted to the decoding thread and this function returns
+   * immediately, so it can be called at any time, e.g. at the rate of a
+   * scrubbing UI. Consecutive seeks that are not yet executed are collapsed
+   * into the latest one. The frames decoded before the seek, including those
+   * already in the cache, are discarded by `result_get`, so that the first
+   * frame returned afterwards belongs to the new position. If the seek fails,
+   * `result_get` returns `pollux_err_stream_end`.
+   *
    * @param[in] h Decoder handle.
    * @param[in] min_ts Smallest acceptable timestamp.
    * @param[in] ts Target timestamp.
@@ -199,6 +395,62 @@ typedef struct pollux_decode_t {
    */
   int (*seek_file)(struct pollux_decode_t *h, int64_t min_ts, int64_t ts,
                    int64_t max_ts);
+
+  /**
+   * @brief Get the decoding statistics. It is thread-safe with respect to the
+   * decoding thread and may be called at any time after `param_set`.
+   *
+   * @param[in] h Decoder handle.
+   * @param[out] stats Statistics.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*stats_get)(struct pollux_decode_t *h, pollux_decode_stats_t *stats);
+
+  /**
+   * @brief Set parameters to the decoder for the packet mode, in which the
+   * elementary stream packets are fed by `send_packet` instead of being read
+   * from a url. The decoded frames are returned by `result_get` as usual.
+   * The resources must be released through the `release` function.
+   *
+   * @param[in] h Decoder handle.
+   * @param[in] codec_id The codec of the packets.
+   * @param[in] time_base The time base of the timestamps of the packets.
+   * @param[in] args Configuration, `loop_count` and the input options of the
+   * url are ignored. When `fmt_cvt_img` is configured, its width, height and
+   * format must be valid, since the source image is unknown in advance.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note `seek_file` is not available in the packet mode, and the `stream`
+   * member only contains the codec information.
+   */
+  int (*packet_param_set)(struct pollux_decode_t *h, pollux_codec_id_t codec_id,
+                          pollux_rational time_base,
+                          const pollux_decode_args_t *args);
+
+  /**
+   * @brief Send a packet to the decoder in the packet mode. For H.264/HEVC,
+   * a packet is an access unit in Annex B format with in-band parameter sets.
+   *
+   * @param[in] h Decoder handle.
+   * @param[in] data The packet data. Passing nullptr drains the decoder: the
+   * remaining frames are output, followed by `pollux_err_stream_end` from
+   * `result_get`, after which new packets may be sent.
+   * @param[in] size The size of the data.
+   * @param[in] pts Presentation timestamp, in units of the time base.
+   * @param[in] dts Decoding timestamp, in units of the time base.
+   * @param[in] flags `POLLUX_DECODE_PACKET_FLAG_*`.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note The function blocks while the decoder cannot accept more data, that
+   * is, while the result cache is full under the `pollux_decode_drop_block`
+   * policy, and a packet sent right after a drain waits until the remaining
+   * frames have been output.
+   */
+  int (*send_packet)(struct pollux_decode_t *h, const uint8_t *data, int size,
+                     int64_t pts, int64_t dts, int flags);
 } pollux_decode_t;
 
 /**
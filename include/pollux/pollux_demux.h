@@ -0,0 +1,316 @@
+/**
+ * @note Unless otherwise specified, demuxing `API` are unsafe in
+ * multi-threading.
+ */
+
+#ifndef POLLUX_DEMUX_H
+#define POLLUX_DEMUX_H
+
+#include <stdbool.h>
+
+#include "pollux/pollux_attributes.h"
+#include "pollux/pollux_packet.h"
+#include "pollux/pollux_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Demuxing interface, which is based on ffmpeg. It reads the compressed
+ * packets of the video stream of a url without decoding them, for forwarding,
+ * remuxing or indexing.
+ *
+ * @details
+ * flow:
+ * (1) Call the `pollux_demux_init` function to get the demuxer handle.
+ * (2) Call the `param_set` function to open the url.
+ * (3) Call the `read_packet` function to get a packet.
+ * (4) Call the `packet_free` function to release the packet.
+ * Alternatively, call the `analyze` function to collect statistics of all the
+ * packets.
+ * (5) Call the `release` function to release the demuxing resource.
+ * (6) Call the `pollux_demux_deinit` function to release the demuxer handle.
+ */
+
+/**
+ * @brief Demuxing parameter.
+ */
+typedef struct {
+  /**
+   * @brief The maximum number of packets held by the caller at the same time,
+   * that is, the number of caches of the `pollux_packet_t` struct. The default
+   * value is 1.
+   */
+  int cache_count;
+
+  /**
+   * @brief Read local files through the memory-mapped input, see
+   * `pollux_decode_args_t.mmap_enable`.
+   */
+  bool mmap_enable;
+
+  /**
+   * @brief The size of the input readahead window, unit: MB. 0 to disable. See
+   * `pollux_decode_args_t.prefetch_size_mb`.
+   */
+  int prefetch_size_mb;
+
+  /**
+   * @brief Convert H.264/HEVC packets of the length-prefixed format, as stored
+   * in `mp4` and `mkv`, to Annex B with in-band parameter sets, as expected by
+   * `mpegts`, raw streams and `pollux_decode_t.send_packet`. It is ignored for
+   * other codecs and for streams that are already in Annex B.
+   */
+  bool annexb;
+} pollux_demux_args_t;
+
+/**
+ * @brief The information of a packet of the video stream, see `analyze`.
+ */
+typedef struct {
+  /**
+   * @brief Presentation and decoding timestamps, relative to the start of the
+   * stream, unit: us. `INT64_MIN` if unknown.
+   */
+  int64_t pts, dts;
+
+  /**
+   * @brief The byte offset of the packet in the url, -1 if unknown.
+   */
+  int64_t pos;
+
+  /**
+   * @brief The size of the packet, unit: byte.
+   */
+  int size;
+
+  /**
+   * @brief `POLLUX_PACKET_FLAG_*`.
+   */
+  int flags;
+
+  /**
+   * @brief The picture type found by the parser of the codec: 'I', 'P', 'B',
+   * or '?' if unknown.
+   */
+  char pict_type;
+
+  /**
+   * @brief The packet is much larger than the recent packets of the same
+   * picture type, which usually indicates a scene change.
+   */
+  bool scene_hint;
+} pollux_demux_frame_info_t;
+
+/**
+ * @brief Analysis parameter.
+ */
+typedef struct {
+  /**
+   * @brief The width of the buckets of `bitrate_cb`, unit: us. The default
+   * value is 1 second.
+   */
+  int64_t bucket_us;
+
+  /**
+   * @brief The ratio of the size of a packet to the average size of the recent
+   * packets of the same picture type, above which `scene_hint` is set. The
+   * default value is 2.5.
+   */
+  double scene_threshold;
+
+  /**
+   * @brief Called for each packet in decoding order, can be nullptr.
+   */
+  void (*frame_cb)(const pollux_demux_frame_info_t *info, void *opaque);
+
+  /**
+   * @brief Called for each bucket of the bit rate over time, can be nullptr.
+   *
+   * @param[in] start_us The start of the bucket, by the decoding timestamps.
+   * @param[in] bytes The size of the packets in the bucket.
+   * @param[in] bit_rate The bit rate of the bucket, unit: bps.
+   */
+  void (*bitrate_cb)(int64_t start_us, int64_t bytes, int64_t bit_rate,
+                     void *opaque);
+
+  /**
+   * @brief User data of the callbacks.
+   */
+  void *opaque;
+} pollux_demux_analyze_args_t;
+
+/**
+ * @brief Analysis result, see `analyze`.
+ */
+typedef struct {
+  /**
+   * @brief The number of packets, of the key frames, and of the pictures of
+   * each type.
+   */
+  int64_t frames;
+  int64_t key_frames;
+  int64_t frames_i, frames_p, frames_b;
+
+  /**
+   * @brief The total size of the packets, unit: byte.
+   */
+  int64_t bytes;
+
+  /**
+   * @brief The span of the presentation timestamps, unit: us.
+   */
+  int64_t duration;
+
+  /**
+   * @brief The average bit rate, unit: bps.
+   */
+  int64_t bit_rate;
+
+  /**
+   * @brief The number of packets between two key frames. The last GOP, which
+   * may be cut by the end of the url, is not counted.
+   */
+  int gop_min, gop_max;
+  double gop_avg;
+
+  /**
+   * @brief The number of packets with `scene_hint` set.
+   */
+  int64_t scene_hints;
+} pollux_demux_analysis_t;
+
+typedef struct pollux_demux_t {
+  /**
+   * @brief Private data.
+   */
+  void *priv_data;
+
+  /**
+   * @brief Stream information, this member will be populated after the
+   * `param_set` function is called.
+   */
+  pollux_stream_info_t stream;
+
+  /**
+   * @brief Release the resource of the demuxer, this function must be used
+   * before `pollux_demux_deinit`. It is repeatable; if not called explicitly,
+   * it will also be called in the `pollux_demux_deinit`.
+   *
+   * @param[in] h Demuxer handle.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note All the packets must be released by `packet_free` before.
+   */
+  int (*release)(struct pollux_demux_t *h);
+
+  /**
+   * @brief Open the url; this function will request some resources, which must
+   * be released through the `release` function.
+   *
+   * @param[in] h Demuxer handle.
+   * @param[in] url Source stream url.
+   * @param[in] args Configuration. When this parameter is configured to
+   * nullptr, the default value is used.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*param_set)(struct pollux_demux_t *h, const char *url,
+                   const pollux_demux_args_t *args);
+
+  /**
+   * @brief Read the next packet of the video stream, which needs to be released
+   * by calling the `packet_free` function. The packet data is reference
+   * counted and is not copied from the demuxer.
+   *
+   * @param[in] h Demuxer handle.
+   * @param[out] packet Packet.
+   * @param[in] milliseconds The time to wait for a free packet cache when all
+   * of them are held by the caller, unit: ms. Setting the value to `0` means no
+   * wait, and setting it to `(~0U)` means infinite wait.
+   *
+   * @return
+   * - (1) 0 on success;
+   *
+   * - (2) `pollux_err_stream_end` indicates the url has been read to the end.
+   * At this point, the `seek_file` function can be called to read again;
+   *
+   * - (3) `pollux_err_timeout` indicates that no packet cache was released in
+   * time;
+   *
+   * - (4) Error code otherwise.
+   */
+  int (*read_packet)(struct pollux_demux_t *h, pollux_packet_t **packet,
+                     uint64_t milliseconds);
+
+  /**
+   * @brief Release a packet returned by `read_packet`. It is thread-safe, the
+   * packets may be released on another thread.
+   *
+   * @param[in] h Demuxer handle.
+   * @param[in] packet Packet.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*packet_free)(struct pollux_demux_t *h, pollux_packet_t *packet);
+
+  /**
+   * @brief Seek to the key frame at or before timestamp ts, the next
+   * `read_packet` returns the packets from there.
+   *
+   * @param[in] h Demuxer handle.
+   * @param[in] min_ts Smallest acceptable timestamp.
+   * @param[in] ts Target timestamp.
+   * @param[in] max_ts Largest acceptable timestamp.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note The timestamps are in units of `stream.time_base`.
+   */
+  int (*seek_file)(struct pollux_demux_t *h, int64_t min_ts, int64_t ts,
+                   int64_t max_ts);
+
+  /**
+   * @brief Read the packets from the current position to the end of the url,
+   * and collect statistics of the stream without decoding: bit rate over
+   * time, GOP structure, key frame positions, picture types and scene change
+   * hints. The picture types come from the parser of the codec.
+   *
+   * @param[in] h Demuxer handle.
+   * @param[in] args Configuration. When this parameter is configured to
+   * nullptr, the default value is used.
+   * @param[out] result Statistics of the packets that are read.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note The url is read to the end, call `seek_file` to read it again.
+   */
+  int (*analyze)(struct pollux_demux_t *h,
+                 const pollux_demux_analyze_args_t *args,
+                 pollux_demux_analysis_t *result);
+} pollux_demux_t;
+
+/**
+ * @brief Deinit the demux module, this function will release all demuxing
+ * resources under the current handle. It is repeatable but thread-unsafe.
+ *
+ * @param[in] handle: Demuxer handle.
+ */
+pollux_api void pollux_demux_deinit(pollux_demux_t *handle);
+
+/**
+ * @brief Init the demux module.
+ *
+ * @param[out] handle Demuxer handle.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+pollux_api int pollux_demux_init(pollux_demux_t **handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POLLUX_DEMUX_H
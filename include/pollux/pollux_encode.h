@@ -12,6 +12,7 @@
 #include "pollux/pollux_codec_id.h"
 #include "pollux/pollux_container_fmt.h"
 #include "pollux/pollux_frame.h"
+#include "pollux/pollux_packet.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -25,14 +26,30 @@ extern "C" {
  * (1) Call the `pollux_encode_init` function to get the encoder handle.
  * (2) Call the `param_set` function to set parameters.
  * (3) Call the `pollux_encode_priv_set` function to set private options of the
- * encoder. (Optional)
+ * encoder, and the `output_add` or `output_add_sink` function to add outputs.
+ * (Optional)
  * (4) Call the `start` function to start encoding.
- * (5) Call the `send_frame` function to send the frame into the encoder.
+ * (5) Call the `send_frame` function to send the frame into the encoder, or
+ * the `send_frame_async` function to queue it.
  * (6) Call the `stop` function to stop encoding.
  * (7) Call the `release` function to release the encoding resource.
  * (8) Call the `pollux_encode_deinit` function to release the encoder handle.
  */
 
+/**
+ * @brief The maximum number of the outputs added to the one of `param_set`.
+ */
+#define POLLUX_ENCODE_OUTPUT_MAX (4)
+
+/**
+ * @brief Sink callback, see `output_add_sink`.
+ *
+ * @param[in] packet The encoded packet, which is only valid during the call.
+ * @param[in] opaque The `opaque` passed to `output_add_sink`.
+ */
+typedef void (*pollux_encode_sink_cb_t)(const pollux_packet_t *packet,
+                                        void *opaque);
+
 typedef struct {
   /**
    * @brief Container format. When set to `pollux_cont_fmt_none` or the
@@ -47,7 +64,8 @@ typedef struct {
 
   /**
    * @brief Information of the encoded image settings. Among them, the `align`
-   * value does not take effect here.
+   * value only takes effect on the frames of `get_input_frame`, the default
+   * value is 32 when it is not positive.
    */
   pollux_img_t img;
 
@@ -75,6 +93,91 @@ typedef struct {
    * @brief Encoder id.
    */
   pollux_codec_id_t codec_id;
+
+  /**
+   * @brief The maximum number of encoded packets waiting to be written. The
+   * packets are written to the output on a dedicated thread, so that a slow
+   * disk or network only backs up this queue instead of `send_frame`, until
+   * it is full. The default value is 64 when it is not positive, and the
+   * maximum is 1024.
+   */
+  int packet_cache_count;
+
+  /**
+   * @brief The maximum number of frames queued by `send_frame_async`. The
+   * default value is 8 when it is not positive, and the maximum is 1024.
+   */
+  int frame_queue_count;
+
+  /**
+   * @brief Called once a frame of `send_frame_async` has been consumed, from
+   * then on the data of the frame can be reused. It is also called for the
+   * frames discarded by a failure, by `stop` or by `release`. It must not call
+   * back into the encoder. (Optional)
+   *
+   * @note It is called on the feeding thread of the encoder, and for the
+   * discarded frames on the thread calling `stop` or `release`, so it must
+   * tolerate being called from either.
+   *
+   * @param[in] frame The frame passed to `send_frame_async`.
+   * @param[in] opaque The `opaque` passed to `send_frame_async`.
+   */
+  void (*frame_release_cb)(const pollux_frame_t *frame, void *opaque);
+
+  /**
+   * @brief The maximum number of frames of `get_input_frame` which are held
+   * by the caller at the same time. The default value is 4 when it is not
+   * positive, and the maximum is 64.
+   */
+  int input_frame_count;
+
+  /**
+   * @brief Use the `pts` and `time_base` of the sent frames instead of a
+   * constant frame rate, so that the variable frame rate sources and the
+   * sources with dropped frames are encoded as they are. The `pts` is shifted
+   * so that the stream starts at 0; a missing `pts` follows the last one at
+   * `frame_rate`, and a `pts` which does not increase is forced to. When the
+   * `time_base` is invalid, the `pts` is in units of 1 / `frame_rate`, with
+   * a warning. The frames of `pollux_decode_t` carry a valid `time_base`.
+   */
+  bool custom_pts;
+
+  /**
+   * @brief Accept the frames of any size and format in `send_frame` and
+   * `send_frame_async`, which are converted to `img` into the buffers of the
+   * encoder. The conversion is threaded with `thread_count`, and rebuilt only
+   * when the source image changes.
+   */
+  bool auto_convert;
+
+  /**
+   * @brief Split the output into files of about `segment_seconds` each, e.g.
+   * for HLS, without restarting the encoder. A key frame is forced at each
+   * boundary, and the output is rotated to a new file on it, whose url is the
+   * one of `param_set` formatted with the index of the segment, starting at
+   * 0, e.g. "seg_%05d.ts". Only `pollux_cont_fmt_mpegts` is supported.
+   * Disabled when it is not positive.
+   */
+  int segment_seconds;
+
+  /**
+   * @brief The local path of an `m3u8` playlist of the segments, which is
+   * rewritten each time a segment is complete and ended by `stop`. The
+   * segments are listed by their file names, so they must be next to it.
+   * (Optional)
+   */
+  const char *playlist_url;
+
+  /**
+   * @brief Keep the last `ring_seconds` of the encoded packets in memory,
+   * whole GOPs from a key frame, instead of writing them, e.g. for the event
+   * recording of surveillance. Nothing is written until `trigger`, and each
+   * event is written to a new file, whose url is the one of `param_set`
+   * formatted with the index of the event, starting at 0. The memory held is
+   * about `bit_rate` * (`ring_seconds` + the duration of a GOP). It cannot be
+   * used with `segment_seconds`. Disabled when it is not positive.
+   */
+  int ring_seconds;
 } pollux_encode_args_t;
 
 typedef struct pollux_encode_t {
@@ -100,7 +203,8 @@ typedef struct pollux_encode_t {
    *
    * @param[in] h Encoder handle.
    * @param[in] url The output path or network url (e.g., "./output.mp4" or
-   * "tcp://192.168.1.100:1234").
+   * "tcp://192.168.1.100:1234"). With `segment_seconds` or `ring_seconds`, a
+   * path with one integer conversion instead (e.g., "./segment_%03d.ts").
    * @param[in] args Configuration.
    *
    * @return 0 on success, error code otherwise.
@@ -135,6 +239,110 @@ typedef struct pollux_encode_t {
    * @return 0 on success, error code otherwise.
    */
   int (*send_frame)(struct pollux_encode_t *h, const pollux_frame_t *frame);
+
+  /**
+   * @brief Queue the frame to the encoder and return immediately, so that one
+   * thread can feed several encoders without waiting for the slowest one. The
+   * frame and its data must be kept until `frame_release_cb` is called for
+   * it. It must not be mixed with `send_frame` between `start` and `stop`,
+   * and `stop` waits for the queued frames to be encoded.
+   *
+   * @param[in] h Encoder handle.
+   * @param[in] frame Frame information.
+   * @param[in] opaque Passed to `frame_release_cb`.
+   *
+   * @return 0 on success, `pollux_err_cache_overflow` if the queue is full,
+   * error code otherwise.
+   */
+  int (*send_frame_async)(struct pollux_encode_t *h,
+                          const pollux_frame_t *frame, void *opaque);
+
+  /**
+   * @brief Get a frame from the pool of the encoder, whose image is allocated
+   * with the size, format and alignment of `img`. Rendering into it and
+   * passing it to `submit_input_frame` avoids both the allocation and the
+   * copy of the image, the buffer returns to the pool once the encoder has
+   * consumed it.
+   *
+   * @param[in] h Encoder handle.
+   * @param[out] frame The frame, which is owned by the encoder and must not be
+   * freed by `pollux_frame_free`.
+   *
+   * @return 0 on success, `pollux_err_cache_overflow` if all the frames are
+   * held, error code otherwise.
+   */
+  int (*get_input_frame)(struct pollux_encode_t *h, pollux_frame_t **frame);
+
+  /**
+   * @brief Send the frame of `get_input_frame` to the encoder, the same as
+   * `send_frame`. The frame cannot be used after this call, even on failure.
+   *
+   * @param[in] h Encoder handle.
+   * @param[in] frame The frame of `get_input_frame`.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*submit_input_frame)(struct pollux_encode_t *h, pollux_frame_t *frame);
+
+  /**
+   * @brief Encode the next sent frame as a key frame, e.g. for a new viewer or
+   * to align the key frames of several encoders. It is thread-safe.
+   *
+   * @param[in] h Encoder handle.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*key_frame_request)(struct pollux_encode_t *h);
+
+  /**
+   * @brief Record an event with `ring_seconds`: the packets in memory and the
+   * ones of the next `post_seconds` are written to a new file. A trigger
+   * during an event extends it instead. It is thread-safe, and `post_seconds`
+   * is counted from the last frame sent, regardless of the encoder delay.
+   *
+   * @param[in] h Encoder handle.
+   * @param[in] post_seconds The duration recorded after the trigger, unit: s.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*trigger)(struct pollux_encode_t *h, int post_seconds);
+
+  /**
+   * @brief Add an output, which is written with the same encoded packets as the
+   * one of `param_set`, e.g. to record a file and stream it at the same time
+   * with one encoding. It is called after `param_set` and before `start`, and
+   * the outputs are cleared by `param_set` and `release`.
+   *
+   * Each output has its own muxer, queue of `packet_cache_count` packets and
+   * writing thread. When its queue is full, its packets are dropped up to the
+   * next key frame instead of blocking the encoder; when it fails, it is
+   * closed and the other outputs go on. Its failures are only logged.
+   *
+   * @param[in] h Encoder handle.
+   * @param[in] url The output path or network url.
+   * @param[in] cont_fmt Container format, guessed from the url when it is
+   * `pollux_cont_fmt_none`.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note The codec parameters are the ones of the output of `param_set`, e.g.
+   * the global headers of `mp4`, which the other containers may need.
+   */
+  int (*output_add)(struct pollux_encode_t *h, const char *url,
+                    pollux_cont_fmt_t cont_fmt);
+
+  /**
+   * @brief Add an output to memory, whose packets are passed to `cb` on its
+   * writing thread, see `output_add`.
+   *
+   * @param[in] h Encoder handle.
+   * @param[in] cb Sink callback, which must not call back into the encoder.
+   * @param[in] opaque User data passed to `cb`.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*output_add_sink)(struct pollux_encode_t *h, pollux_encode_sink_cb_t cb,
+                         void *opaque);
 } pollux_encode_t;
 
 /**
@@ -166,6 +374,14 @@ pollux_api int pollux_encode_init(pollux_encode_t **handle);
 #endif
 
 #ifdef __cplusplus
+static inline int _pollux_encode_priv_set_impl(pollux_encode_t *handle,
+                                               h264_encode_args_t *args) {
+  return _pollux_encode_priv_set(handle, pollux_codec_id_h264, args);
+}
+static inline int _pollux_encode_priv_set_impl(pollux_encode_t *handle,
+                                               const h264_encode_args_t *args) {
+  return _pollux_encode_priv_set(handle, pollux_codec_id_h264, args);
+}
 static inline int _pollux_encode_priv_set_impl(pollux_encode_t *handle,
                                                hevc_encode_args_t *args) {
   return _pollux_encode_priv_set(handle, pollux_codec_id_hevc, args);
@@ -186,6 +402,8 @@ static inline int _pollux_encode_priv_set_impl(pollux_encode_t *handle,
 #  if defined(__GNUC__) || defined(__clang__)
 #    define ENCODE_EXPECT_ID_FOR_ARGS(args) \
       _Generic((args), \
+        h264_encode_args_t *: pollux_codec_id_h264, \
+        const h264_encode_args_t *: pollux_codec_id_h264, \
         hevc_encode_args_t *: pollux_codec_id_hevc, \
         const hevc_encode_args_t *: pollux_codec_id_hevc, \
         av1_encode_args_t *: pollux_codec_id_av1, \
@@ -61,7 +61,8 @@ typedef struct {
   int64_t pkt_dts;
 
   /**
-   * @brief Time base for the timestamps in this frame.
+   * @brief Time base for the timestamps in this frame. The decoder sets the one
+   * of the stream.
    */
   pollux_rational time_base;
 
@@ -83,6 +84,62 @@ typedef struct {
   unsigned char *data[POLLUX_DECODE_DATA_NR];
 } pollux_frame_t;
 
+/**
+ * @brief Motion vector of a block, exported by the decoder, see
+ * `pollux_decode_args_t.export_side_data`. The layout is the same as
+ * `AVMotionVector` of ffmpeg.
+ */
+typedef struct {
+  /**
+   * @brief Where the reference is: negative for a past frame, positive for a
+   * future frame.
+   */
+  int32_t source;
+
+  /**
+   * @brief Width and height of the block.
+   */
+  uint8_t w, h;
+
+  /**
+   * @brief Absolute source position, can be outside the frame area.
+   */
+  int16_t src_x, src_y;
+
+  /**
+   * @brief Absolute destination position, can be outside the frame area.
+   */
+  int16_t dst_x, dst_y;
+
+  /**
+   * @brief Extra flag information, currently unused.
+   */
+  uint64_t flags;
+
+  /**
+   * @brief Motion vector, src_x = dst_x + motion_x / motion_scale, and the same
+   * for y.
+   */
+  int32_t motion_x, motion_y;
+  uint16_t motion_scale;
+} pollux_motion_vector_t;
+
+/**
+ * @brief Quantization parameter of a block, exported by the decoder, see
+ * `pollux_decode_args_t.export_side_data`.
+ */
+typedef struct {
+  /**
+   * @brief Position and size of the block, in pixels.
+   */
+  int x, y, w, h;
+
+  /**
+   * @brief Quantization parameter of the block, in the scale of the codec.
+   */
+  int qp;
+} pollux_block_qp_t;
+
 /**
  * @brief Free the `pollux_frame_t` cache.
  */
@@ -107,6 +164,41 @@ pollux_api void pollux_frame_free(pollux_frame_t **res);
 pollux_api int pollux_frame_alloc(const pollux_img_t *img,
                                   pollux_frame_t **res);
 
+/**
+ * @brief Get the motion vectors of a decoded frame. The vectors are not
+ * copied, they are valid until the frame is released.
+ *
+ * @param[in] frame Frame returned by the decoder.
+ * @param[out] mvs The motion vectors, nullptr if there is none.
+ * @param[out] count The number of motion vectors.
+ *
+ * @return 0 on success, `pollux_err_args` if the frame has no motion vector,
+ * e.g. an intra frame, or the export is not enabled.
+ */
+pollux_api int pollux_frame_mvs_get(const pollux_frame_t *frame,
+                                    const pollux_motion_vector_t **mvs,
+                                    int *count);
+
+/**
+ * @brief Get the quantization parameters of the blocks of a decoded frame.
+ *
+ * @param[in] frame Frame returned by the decoder.
+ * @param[out] frame_qp The base quantization parameter of the frame, can be
+ * nullptr.
+ * @param[out] blocks The buffer of the blocks, can be nullptr to query the
+ * number of blocks only.
+ * @param[in,out] count In: the capacity of `blocks`. Out: the number of the
+ * blocks of the frame; only the first `capacity` are written.
+ *
+ * @return 0 on success, `pollux_err_args` if the frame has no quantization
+ * parameter or the export is not enabled.
+ *
+ * @note A frame without blocks has a uniform quantization parameter, which is
+ * `frame_qp`.
+ */
+pollux_api int pollux_frame_qp_get(const pollux_frame_t *frame, int *frame_qp,
+                                   pollux_block_qp_t *blocks, int *count);
+
 #ifdef __cplusplus
 }
 #endif
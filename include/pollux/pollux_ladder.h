@@ -0,0 +1,155 @@
+/**
+ * @note Unless otherwise specified, ladder encoding `API` are unsafe in
+ * multi-threading.
+ */
+
+#ifndef POLLUX_LADDER_H
+#define POLLUX_LADDER_H
+
+#include "pollux/pollux_encode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Multi-rendition encoding interface for adaptive streaming, which is
+ * based on the encode module. One stream of frames is encoded into several
+ * renditions (rungs) of decreasing sizes, e.g. 1080p, 720p, 480p and 360p, so
+ * that the decoding and the conversion of the source are done once for all of
+ * them.
+ *
+ * @details
+ * flow:
+ * (1) Call the `pollux_ladder_init` function to get the ladder handle.
+ * (2) Call the `param_set` function to set the rungs.
+ * (3) Call the `start` function to start encoding.
+ * (4) Call the `send_frame` function to send the frame into all the rungs.
+ * (5) Call the `stop` function to stop encoding.
+ * (6) Call the `release` function to release the encoding resource.
+ * (7) Call the `pollux_ladder_deinit` function to release the ladder handle.
+ */
+
+/**
+ * @brief The maximum number of rungs.
+ */
+#define POLLUX_LADDER_RUNG_MAX (8)
+
+/**
+ * @brief A rendition.
+ */
+typedef struct {
+  /**
+   * @brief The output path or network url.
+   */
+  const char *url;
+
+  /**
+   * @brief Configuration of the encoder of the rung, see
+   * `pollux_encode_args_t`. The `frame_rate`, `gop_size` and `custom_pts` of
+   * the first rung are used by all the rungs, `gop_size` being the interval
+   * of the key frames requested by the ladder, and `auto_convert` is ignored.
+   */
+  pollux_encode_args_t args;
+} pollux_ladder_rung_t;
+
+/**
+ * @brief Ladder encoding parameter.
+ */
+typedef struct {
+  /**
+   * @brief The rungs, from the largest to the smallest. Each rung is scaled
+   * from the previous one, and the first one from the sent frames, so the
+   * width and the height must not increase.
+   */
+  const pollux_ladder_rung_t *rungs;
+  int rung_count;
+} pollux_ladder_args_t;
+
+typedef struct pollux_ladder_t {
+  /**
+   * @brief Private data.
+   */
+  void *priv_data;
+
+  /**
+   * @brief Release the resource of the ladder, this function must be used
+   * before `pollux_ladder_deinit`. It is repeatable; if not called explicitly,
+   * it will also be called in the `pollux_ladder_deinit`.
+   *
+   * @param[in] h Ladder handle.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*release)(struct pollux_ladder_t *h);
+
+  /**
+   * @brief Set the rungs; this function will request some resources, which
+   * must be released through the `release` function.
+   *
+   * @param[in] h Ladder handle.
+   * @param[in] args Configuration.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*param_set)(struct pollux_ladder_t *h, const pollux_ladder_args_t *args);
+
+  /**
+   * @brief Start encoding, write the headers of all the rungs.
+   *
+   * @param[in] h Ladder handle.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*start)(struct pollux_ladder_t *h);
+
+  /**
+   * @brief Stop encoding, write the tails of all the rungs.
+   *
+   * @param[in] h Ladder handle.
+   *
+   * @return 0 on success, error code otherwise. The tails of the other rungs
+   * are written even if one of them fails.
+   */
+  int (*stop)(struct pollux_ladder_t *h);
+
+  /**
+   * @brief Send the frame to all the rungs. The frame is scaled into the first
+   * rung, then each rung into the next one, directly in the input frames of the
+   * encoders (see `get_input_frame`). A key frame is requested from all the
+   * rungs every `gop_size` frames, so that their key frames are aligned.
+   *
+   * @param[in] h Ladder handle.
+   * @param[in] frame Frame information, of any size and format.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note The encoders do not insert key frames on their own: their interval
+   * is set above `gop_size`, and the scene cuts are disabled for H.264. For
+   * the other codecs, the key frames of the scene changes are not aligned.
+   */
+  int (*send_frame)(struct pollux_ladder_t *h, const pollux_frame_t *frame);
+} pollux_ladder_t;
+
+/**
+ * @brief Deinit the ladder module, this function will release all encoding
+ * resources under the current handle.
+ *
+ * @param[in] handle Ladder handle.
+ */
+pollux_api void pollux_ladder_deinit(pollux_ladder_t *handle);
+
+/**
+ * @brief Init the ladder module.
+ *
+ * @param[out] handle Ladder handle.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+pollux_api int pollux_ladder_init(pollux_ladder_t **handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POLLUX_LADDER_H
@@ -0,0 +1,58 @@
+#ifndef POLLUX_PACKET_H
+#define POLLUX_PACKET_H
+
+#include <stdint.h>
+
+#include "pollux/pollux_rational.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The packet is a key frame.
+ */
+#define POLLUX_PACKET_FLAG_KEY (1 << 0)
+
+/**
+ * @brief Compressed packet.
+ */
+typedef struct {
+  /**
+   * @brief Private data.
+   */
+  void *priv_data;
+
+  /**
+   * @brief Packet data and its size, the data is read-only.
+   */
+  const uint8_t *data;
+  int size;
+
+  /**
+   * @brief Presentation and decoding timestamps, in units of `time_base`,
+   * `INT64_MIN` if unknown.
+   */
+  int64_t pts, dts;
+
+  /**
+   * @brief Duration of the packet, in units of `time_base`, 0 if unknown.
+   */
+  int64_t duration;
+
+  /**
+   * @brief The time base of the timestamps.
+   */
+  pollux_rational time_base;
+
+  /**
+   * @brief `POLLUX_PACKET_FLAG_*`.
+   */
+  int flags;
+} pollux_packet_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POLLUX_PACKET_H
@@ -0,0 +1,229 @@
+/**
+ * @note Unless otherwise specified, remuxing `API` are unsafe in
+ * multi-threading.
+ */
+
+#ifndef POLLUX_REMUX_H
+#define POLLUX_REMUX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "pollux/pollux_attributes.h"
+#include "pollux/pollux_container_fmt.h"
+#include "pollux/pollux_encode.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Remuxing interface, which is based on ffmpeg. The compressed packets
+ * of the video stream of the inputs are copied into an output container
+ * without being decoded, e.g. to convert `mpegts` recordings to `mp4`.
+ *
+ * @details
+ * flow:
+ * (1) Call the `pollux_remux_init` function to get the remuxer handle.
+ * (2) Call the `param_set` function to open the output.
+ * (3) Call the `append` function to copy an input into the output, the `cut`
+ * function to copy a range of it, the `concat` function to copy several
+ * inputs, or the `transcode` function to encode an input again, one or more
+ * times.
+ * (4) Call the `finish` function to write the tail of the output.
+ * (5) Call the `release` function to release the remuxing resource.
+ * (6) Call the `pollux_remux_deinit` function to release the remuxer handle.
+ */
+
+/**
+ * @brief Remuxing parameter.
+ */
+typedef struct {
+  /**
+   * @brief Container format of the output. When set to `pollux_cont_fmt_none`
+   * or the configuration is invalid, it is guessed from the output url.
+   */
+  pollux_cont_fmt_t cont_fmt;
+
+  /**
+   * @brief Read local inputs through the memory-mapped input, see
+   * `pollux_decode_args_t.mmap_enable`.
+   */
+  bool mmap_enable;
+
+  /**
+   * @brief The size of the input readahead window, unit: MB. 0 to disable. See
+   * `pollux_decode_args_t.prefetch_size_mb`.
+   */
+  int prefetch_size_mb;
+} pollux_remux_args_t;
+
+/**
+ * @brief Chunked transcoding parameter, see `transcode`.
+ */
+typedef struct {
+  /**
+   * @brief Configuration of the encoder of each chunk. The `cont_fmt` is
+   * ignored; when the width, the height or the frame rate is 0, the one of the
+   * input is used. The `thread_count` is per chunk.
+   */
+  pollux_encode_args_t encode;
+
+  /**
+   * @brief The number of chunks, which are encoded at the same time. The
+   * default value is 4 when it is not positive, and the maximum is 64.
+   */
+  int chunk_count;
+
+  /**
+   * @brief The prefix of the temporary files of the chunks, which are named
+   * "<prefix>.chunk<N>.mp4" and removed once they are copied. When it is
+   * nullptr, the output url is used, which must be a local path then.
+   */
+  const char *chunk_prefix;
+} pollux_remux_transcode_args_t;
+
+typedef struct pollux_remux_t {
+  /**
+   * @brief Private data.
+   */
+  void *priv_data;
+
+  /**
+   * @brief Release the resource of the remuxer, this function must be used
+   * before `pollux_remux_deinit`. It is repeatable; if not called explicitly,
+   * it will also be called in the `pollux_remux_deinit`.
+   *
+   * @param[in] h Remuxer handle.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*release)(struct pollux_remux_t *h);
+
+  /**
+   * @brief Open the output; this function will request some resources, which
+   * must be released through the `release` function.
+   *
+   * @param[in] h Remuxer handle.
+   * @param[in] url The output path or network url.
+   * @param[in] args Configuration. When this parameter is configured to
+   * nullptr, the default value is used.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*param_set)(struct pollux_remux_t *h, const char *url,
+                   const pollux_remux_args_t *args);
+
+  /**
+   * @brief Copy all the packets of the video stream of an input into the
+   * output. The timestamps are rescaled to the output, and the inputs appended
+   * one after another are placed back to back on a continuous timeline.
+   *
+   * H.264/HEVC packets in the length-prefixed format of `mp4`/`mkv` are
+   * converted to Annex B, so that the parameter sets stay in-band across the
+   * inputs and the re-encoded sections of `cut`. The `mp4`/`mkv` muxers
+   * convert them back.
+   *
+   * @param[in] h Remuxer handle.
+   * @param[in] url The input url.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note The header of the output is written with the codec parameters of
+   * the first input, the following inputs must have the same codec.
+   */
+  int (*append)(struct pollux_remux_t *h, const char *url);
+
+  /**
+   * @brief Write the tail of the output, after which no input can be appended.
+   *
+   * @param[in] h Remuxer handle.
+   *
+   * @return 0 on success, error code otherwise.
+   */
+  int (*finish)(struct pollux_remux_t *h);
+
+  /**
+   * @brief Append the range [start_us, end_us) of the video stream of an
+   * input to the output, without a full transcode. The GOPs inside the range
+   * are copied, only the frames of the partial GOPs at the two edges are
+   * decoded and encoded again, with the codec parameters of the input. The
+   * range is placed on the timeline like `append`.
+   *
+   * @param[in] h Remuxer handle.
+   * @param[in] url The input url.
+   * @param[in] start_us The start of the range, relative to the start of the
+   * input, unit: us.
+   * @param[in] end_us The end of the range, exclusive, unit: us. A value past
+   * the end of the input cuts to the end.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note The input is expected to have closed GOPs, the leading pictures of
+   * an open GOP are dropped. An encoder of the codec of the input is required
+   * unless both edges fall on key frames.
+   */
+  int (*cut)(struct pollux_remux_t *h, const char *url, int64_t start_us,
+             int64_t end_us);
+
+  /**
+   * @brief Append inputs to the output one after another, see `append`, e.g.
+   * to merge the segments of a recorder. The codec parameters of each input
+   * are checked against the output, which takes those of the first input:
+   * codec, size, pixel format, profile, and the extradata of the codecs whose
+   * parameter sets are not in-band. The compatible inputs are copied, the
+   * others are decoded and encoded again with the parameters of the output.
+   *
+   * @param[in] h Remuxer handle.
+   * @param[in] urls The input urls.
+   * @param[in] count The number of inputs.
+   *
+   * @return 0 on success, error code otherwise. On failure, the inputs before
+   * the failed one are in the output.
+   */
+  int (*concat)(struct pollux_remux_t *h, const char *const *urls, int count);
+
+  /**
+   * @brief Encode the video stream of an input again and append it to the
+   * output, see `append`, e.g. for the offline transcoding of a long file on
+   * many cores. The input is split at the key frames into `chunk_count`
+   * chunks of about the same duration, which are encoded at the same time by
+   * separate encoders, each one starting with a key frame. The chunks are
+   * then copied into the output one after another, with continuous
+   * timestamps.
+   *
+   * @param[in] h Remuxer handle.
+   * @param[in] url The input url.
+   * @param[in] args Configuration.
+   *
+   * @return 0 on success, error code otherwise.
+   *
+   * @note The input is expected to have closed GOPs, see `cut`. The frames
+   * are encoded at the constant frame rate.
+   */
+  int (*transcode)(struct pollux_remux_t *h, const char *url,
+                   const pollux_remux_transcode_args_t *args);
+} pollux_remux_t;
+
+/**
+ * @brief Deinit the remux module, this function will release all remuxing
+ * resources under the current handle. It is repeatable but thread-unsafe.
+ *
+ * @param[in] handle: Remuxer handle.
+ */
+pollux_api void pollux_remux_deinit(pollux_remux_t *handle);
+
+/**
+ * @brief Init the remux module.
+ *
+ * @param[out] handle Remuxer handle.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+pollux_api int pollux_remux_init(pollux_remux_t **handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POLLUX_REMUX_H
@@ -0,0 +1,69 @@
+#ifndef POLLUX_STREAM_H
+#define POLLUX_STREAM_H
+
+#include <stdint.h>
+
+#include "pollux/pollux_codec_id.h"
+#include "pollux/pollux_pixel_fmt.h"
+#include "pollux/pollux_rational.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Video stream information, shared by the decoding and the demuxing
+ * interfaces.
+ */
+typedef struct {
+  /**
+   * @brief Video width and height.
+   */
+  int video_width, video_height;
+
+  /**
+   * @brief The average bitrate.
+   */
+  int64_t bit_rate;
+
+  /**
+   * @brief Video frame rate. In general, frame rate = num / den.
+   */
+  pollux_rational video_frame_rate;
+
+  /**
+   * @brief Maximum number of B-frames between non-B-frames.
+   */
+  int max_b_frames;
+
+  /**
+   * @brief The number of pictures in a group of pictures.
+   */
+  int gop_size;
+
+  /**
+   * @brief Video frame format.
+   */
+  pollux_pix_fmt_t video_img_fmt;
+
+  /**
+   * @brief Video encoding format.
+   */
+  pollux_codec_id_t video_codec_id;
+
+  /**
+   * @brief Stream duration, unit: us, 0 if unrecognized.
+   */
+  int64_t duration;
+
+  /**
+   * @brief The time base of the timestamps of the stream.
+   */
+  pollux_rational time_base;
+} pollux_stream_info_t;
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POLLUX_STREAM_H
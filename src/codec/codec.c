@@ -4,7 +4,7 @@ void codec_priv_set(void *cc_priv, pollux_codec_id_t codec_id,
                     const void *args) {
   switch (codec_id) {
   case pollux_codec_id_h264:
-    sirius_warnsp("Not yet: h264\n");
+    h264_priv_set(cc_priv, args);
     break;
   case pollux_codec_id_hevc:
     hevc_priv_set(cc_priv, args);
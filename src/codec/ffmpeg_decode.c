@@ -3,7 +3,42 @@
 #include "pollux/internal/codec/codec.h"
 #include "pollux/pollux_erron.h"
 
-ffmpeg_decode_t *ffmpeg_decoder_create(const char *url) {
+/**
+ * @brief The probing limits of the low-delay mode. They are enough for the
+ * parameter sets of a raw or `mpegts` stream, without waiting for the
+ * following frames.
+ */
+#define LOW_DELAY_PROBESIZE (32 * 1024)
+#define LOW_DELAY_ANALYZE_DURATION (100 * 1000)
+
+/**
+ * @brief Attach the custom input backend to the format context. When the
+ * backend is not available, the protocol of the url is used instead.
+ */
+static void input_io_attach(ffmpeg_decode_t *d, const char *url,
+                            const ffmpeg_decode_args_t *args) {
+  if (!args)
+    return;
+
+  if (args->prefetch_size > 0) {
+    if (ffmpeg_io_prefetch_open(&d->io, url, args->prefetch_size))
+      sirius_warnsp("Fall back to the default protocol: %s\n", url);
+  } else if (args->mmap_enable) {
+    if (!ffmpeg_io_url_is_local(url)) {
+      sirius_warnsp("Not a local file, `mmap` is ignored: %s\n", url);
+    } else if (ffmpeg_io_mmap_open(&d->io, url)) {
+      sirius_warnsp("Fall back to the default protocol: %s\n", url);
+    }
+  }
+
+  if (d->io) {
+    d->fmt_ctx->pb = d->io->avio;
+    d->fmt_ctx->flags |= AVFMT_FLAG_CUSTOM_IO;
+  }
+}
+
+ffmpeg_decode_t *ffmpeg_decoder_create(const char *url,
+                                       const ffmpeg_decode_args_t *args) {
   ffmpeg_decode_t *d = calloc(1, sizeof(ffmpeg_decode_t));
   if (!d) {
     sirius_error("calloc -> 'ffmpeg_decode_t'\n");
@@ -22,6 +57,19 @@ ffmpeg_decode_t *ffmpeg_decoder_create(const char *url) {
     goto label_free1;
   }
 
+  input_io_attach(d, url, args);
+
+  if (args && args->low_delay) {
+    d->fmt_ctx->flags |= AVFMT_FLAG_NOBUFFER;
+    d->fmt_ctx->probesize = LOW_DELAY_PROBESIZE;
+    d->fmt_ctx->max_analyze_duration = LOW_DELAY_ANALYZE_DURATION;
+    d->fmt_ctx->fps_probe_size = 0;
+    d->fmt_ctx->max_delay = 0;
+  }
+
+  /**
+   * @note On failure, `avformat_open_input` frees the format context.
+   */
   ret = avformat_open_input(&d->fmt_ctx, url, nullptr, nullptr);
   if (ret < 0) {
     ffmpeg_error(ret, "avformat_open_input");
@@ -43,7 +91,7 @@ ffmpeg_decode_t *ffmpeg_decoder_create(const char *url) {
 label_free3:
   avformat_close_input(&d->fmt_ctx);
 label_free2:
-  avformat_free_context(d->fmt_ctx);
+  ffmpeg_io_close(&d->io);
 label_free1:
   free(d);
 
@@ -61,6 +109,14 @@ void ffmpeg_decoder_destroy(ffmpeg_decode_t **d_ptr) {
   if (d->codec_ctx)
     avcodec_free_context(&d->codec_ctx);
 
+  av_bsf_free(&d->bsf);
+
+  if (d->parser) {
+    av_parser_close(d->parser);
+    d->parser = nullptr;
+  }
+  avcodec_free_context(&d->parser_ctx);
+
   if (d->fmt_ctx) {
     /**
      * @note `avformat_close_input` also frees the context, no need for
@@ -69,10 +125,63 @@ void ffmpeg_decoder_destroy(ffmpeg_decode_t **d_ptr) {
     avformat_close_input(&d->fmt_ctx);
   }
 
+  /**
+   * @note The custom input backend is not closed by `avformat_close_input`.
+   */
+  ffmpeg_io_close(&d->io);
+
   free(d);
   *d_ptr = nullptr;
 }
 
+/**
+ * @brief Apply the decoder configuration to the codec context, before
+ * `avcodec_open2`.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+static int codec_ctx_args_set(AVCodecContext *cc, const AVCodec *codec,
+                              const ffmpeg_decode_args_t *args) {
+  if (!args)
+    return pollux_err_ok;
+
+  cc->thread_count = args->thread_count;
+  cc->export_side_data |= args->export_side_data;
+
+  /**
+   * @note Frame threading delays the output by one frame per thread, slice
+   * threading does not.
+   */
+  if (args->low_delay) {
+    cc->flags |= AV_CODEC_FLAG_LOW_DELAY;
+    cc->thread_type = FF_THREAD_SLICE;
+  }
+
+  if (args->draw_horiz_band) {
+    /**
+     * @note Only a few software decoders (e.g. MPEG-1/2, MPEG-4 Part 2) have
+     * the capability, H.264 and HEVC do not.
+     */
+    if (!(codec->capabilities & AV_CODEC_CAP_DRAW_HORIZ_BAND)) {
+      sirius_error("The codec (%s) does not support band output\n",
+                   codec->name);
+      return pollux_err_args;
+    }
+    /**
+     * @note With slice threading, e.g. MPEG-1/2 calls `draw_horiz_band` from
+     * its slice threads, concurrently and out of order, so the decoding is
+     * single-threaded.
+     */
+    if (cc->thread_count != 1)
+      sirius_debgsp("Band output, thread count: %d -> 1\n", cc->thread_count);
+    cc->draw_horiz_band = args->draw_horiz_band;
+    cc->opaque = args->opaque;
+    cc->thread_count = 1;
+  }
+
+  return pollux_err_ok;
+}
+
 int ffmpeg_decoder_open_stream(ffmpeg_decode_t *d, enum AVMediaType media_type,
                                const ffmpeg_decode_args_t *args) {
   if (!d || !d->fmt_ctx)
@@ -104,9 +213,8 @@ int ffmpeg_decoder_open_stream(ffmpeg_decode_t *d, enum AVMediaType media_type,
     goto label_free1;
   }
 
-  if (args) {
-    d->codec_ctx->thread_count = args->thread_count;
-  }
+  if (codec_ctx_args_set(d->codec_ctx, codec, args))
+    goto label_free1;
 
   ret = avcodec_open2(d->codec_ctx, codec, nullptr);
   if (ret < 0) {
@@ -123,6 +231,269 @@ label_free1:
   return pollux_err_resource_alloc;
 }
 
+int ffmpeg_decoder_find_stream(ffmpeg_decode_t *d,
+                               enum AVMediaType media_type) {
+  if (!d || !d->fmt_ctx)
+    return pollux_err_entry;
+
+  int ret = av_find_best_stream(d->fmt_ctx, media_type, -1, -1, nullptr, 0);
+  if (ret < 0) {
+    ffmpeg_error(ret, "av_find_best_stream");
+    return pollux_err_args;
+  }
+  d->stream_index = ret;
+
+  /**
+   * @note The packets of the other streams are not read at all.
+   */
+  for (unsigned int i = 0; i < d->fmt_ctx->nb_streams; ++i) {
+    if ((int)i != d->stream_index)
+      d->fmt_ctx->streams[i]->discard = AVDISCARD_ALL;
+  }
+
+  sirius_infosp("Stream %d found for demuxing\n", d->stream_index);
+  return pollux_err_ok;
+}
+
+int ffmpeg_decoder_annexb_open(ffmpeg_decode_t *d) {
+  if (!d || !d->fmt_ctx || d->stream_index < 0)
+    return pollux_err_entry;
+
+  int ret;
+  AVStream *st = d->fmt_ctx->streams[d->stream_index];
+  AVCodecParameters *par = st->codecpar;
+  const char *name;
+
+  switch (par->codec_id) {
+  case AV_CODEC_ID_H264:
+    name = "h264_mp4toannexb";
+    break;
+  case AV_CODEC_ID_HEVC:
+    name = "hevc_mp4toannexb";
+    break;
+  default:
+    return pollux_err_ok;
+  }
+
+  /**
+   * @note The extradata of the length-prefixed format is an `avcC`/`hvcC`
+   * record, whose first byte is the version 1. That of Annex B starts with a
+   * start code.
+   */
+  if (par->extradata_size < 1 || par->extradata[0] != 1)
+    return pollux_err_ok;
+
+  const AVBitStreamFilter *filter = av_bsf_get_by_name(name);
+  if (!filter) {
+    sirius_error("av_bsf_get_by_name: %s\n", name);
+    return pollux_err_resource_alloc;
+  }
+
+  ret = av_bsf_alloc(filter, &d->bsf);
+  if (ret < 0) {
+    ffmpeg_error(ret, "av_bsf_alloc");
+    return pollux_err_resource_alloc;
+  }
+
+  ret = avcodec_parameters_copy(d->bsf->par_in, par);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avcodec_parameters_copy");
+    goto label_free1;
+  }
+  d->bsf->time_base_in = st->time_base;
+
+  ret = av_bsf_init(d->bsf);
+  if (ret < 0) {
+    ffmpeg_error(ret, "av_bsf_init");
+    goto label_free1;
+  }
+
+  sirius_infosp("Packets of stream %d are converted by: %s\n",
+                d->stream_index, name);
+  return pollux_err_ok;
+
+label_free1:
+  av_bsf_free(&d->bsf);
+
+  return pollux_err_resource_alloc;
+}
+
+int ffmpeg_decoder_parser_open(ffmpeg_decode_t *d) {
+  if (!d || !d->fmt_ctx || d->stream_index < 0)
+    return pollux_err_entry;
+
+  int ret;
+  AVStream *st = d->fmt_ctx->streams[d->stream_index];
+  const AVCodecParameters *par = d->bsf ? d->bsf->par_out : st->codecpar;
+
+  d->parser = av_parser_init(par->codec_id);
+  if (!d->parser) {
+    sirius_warnsp("No parser for the codec of stream %d\n", d->stream_index);
+    return pollux_err_ok;
+  }
+
+  /**
+   * @note Each packet is a complete frame, so the parser does not buffer.
+   */
+  d->parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+
+  /**
+   * @note The parser reads the extradata, e.g. the `avcC` record with the
+   * size of the length prefixes. The context is not opened.
+   */
+  d->parser_ctx = avcodec_alloc_context3(nullptr);
+  if (!d->parser_ctx) {
+    sirius_error("avcodec_alloc_context3 failed\n");
+    goto label_free1;
+  }
+
+  ret = avcodec_parameters_to_context(d->parser_ctx, par);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avcodec_parameters_to_context");
+    goto label_free2;
+  }
+
+  return pollux_err_ok;
+
+label_free2:
+  avcodec_free_context(&d->parser_ctx);
+label_free1:
+  av_parser_close(d->parser);
+  d->parser = nullptr;
+
+  return pollux_err_resource_alloc;
+}
+
+enum AVPictureType ffmpeg_decoder_parse(ffmpeg_decode_t *d,
+                                        const AVPacket *pkt) {
+  uint8_t *out;
+  int out_size;
+
+  if (!d->parser || pkt->size <= 0)
+    return AV_PICTURE_TYPE_NONE;
+
+  d->parser->pict_type = AV_PICTURE_TYPE_NONE;
+  av_parser_parse2(d->parser, d->parser_ctx, &out, &out_size, pkt->data,
+                   pkt->size, pkt->pts, pkt->dts, pkt->pos);
+
+  return (enum AVPictureType)d->parser->pict_type;
+}
+
+int ffmpeg_decoder_read_packet(ffmpeg_decode_t *d, AVPacket *pkt) {
+  int ret;
+
+  while (true) {
+    if (d->bsf) {
+      ret = av_bsf_receive_packet(d->bsf, pkt);
+      if (ret == 0)
+        return pollux_err_ok;
+      if (ret == AVERROR_EOF)
+        return pollux_err_stream_end;
+      if (ret != AVERROR(EAGAIN)) {
+        ffmpeg_error(ret, "av_bsf_receive_packet");
+        return pollux_err_file_read;
+      }
+    }
+
+    ret = av_read_frame(d->fmt_ctx, pkt);
+    if (ret == AVERROR_EOF) {
+      if (!d->bsf)
+        return pollux_err_stream_end;
+
+      /**
+       * @note Drain the conversion, `av_bsf_receive_packet` returns
+       * `AVERROR_EOF` once it is empty.
+       */
+      av_bsf_send_packet(d->bsf, nullptr);
+      continue;
+    } else if (ret < 0) {
+      ffmpeg_error(ret, "av_read_frame");
+      return pollux_err_file_read;
+    }
+
+    if (pkt->stream_index != d->stream_index) {
+      av_packet_unref(pkt);
+      continue;
+    }
+    if (!d->bsf)
+      return pollux_err_ok;
+
+    ret = av_bsf_send_packet(d->bsf, pkt);
+    if (ret < 0) {
+      av_packet_unref(pkt);
+      ffmpeg_error(ret, "av_bsf_send_packet");
+      return pollux_err_file_read;
+    }
+  }
+}
+
+static ffmpeg_decode_t *decoder_create(enum AVCodecID codec_id,
+                                       const AVCodecParameters *par,
+                                       const ffmpeg_decode_args_t *args) {
+  int ret;
+
+  const AVCodec *codec = avcodec_find_decoder(codec_id);
+  if (!codec) {
+    sirius_error("avcodec_find_decoder: %d\n", codec_id);
+    return nullptr;
+  }
+
+  ffmpeg_decode_t *d = calloc(1, sizeof(ffmpeg_decode_t));
+  if (!d) {
+    sirius_error("calloc -> 'ffmpeg_decode_t'\n");
+    return nullptr;
+  }
+  d->stream_index = AVERROR_STREAM_NOT_FOUND;
+
+  d->codec_ctx = avcodec_alloc_context3(codec);
+  if (!d->codec_ctx) {
+    sirius_error("avcodec_alloc_context3 failed\n");
+    goto label_free1;
+  }
+
+  if (par) {
+    ret = avcodec_parameters_to_context(d->codec_ctx, par);
+    if (ret < 0) {
+      ffmpeg_error(ret, "avcodec_parameters_to_context");
+      goto label_free2;
+    }
+  }
+
+  if (codec_ctx_args_set(d->codec_ctx, codec, args))
+    goto label_free2;
+  if (args)
+    d->codec_ctx->pkt_timebase = args->pkt_timebase;
+
+  ret = avcodec_open2(d->codec_ctx, codec, nullptr);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avcodec_open2");
+    goto label_free2;
+  }
+
+  sirius_infosp("Decoder (%s) opened for packet input\n", codec->name);
+  return d;
+
+label_free2:
+  avcodec_free_context(&d->codec_ctx);
+label_free1:
+  free(d);
+
+  return nullptr;
+}
+
+ffmpeg_decode_t *ffmpeg_decoder_create_codec(enum AVCodecID codec_id,
+                                             const ffmpeg_decode_args_t *args) {
+  return decoder_create(codec_id, nullptr, args);
+}
+
+ffmpeg_decode_t *ffmpeg_decoder_create_par(const AVCodecParameters *par,
+                                           const ffmpeg_decode_args_t *args) {
+  if (!par)
+    return nullptr;
+
+  return decoder_create(par->codec_id, par, args);
+}
+
 int ffmpeg_decoder_alloc_buffers(ffmpeg_decode_t *d) {
   if (!d)
     return pollux_err_entry;
@@ -26,6 +26,29 @@ void ffmpeg_encoder_deinit(ffmpeg_encode_t *e) {
   e->fmt_ctx = nullptr;
 }
 
+/**
+ * @brief Allocates the format context of a given output, without opening it.
+ *
+ * @param[out] e Internal encoder handle.
+ * @param[in] url The output path or network url.
+ * @param[in] cont_fmt The name of the container format, see
+ * `ffmpeg_encoder_init`.
+ *
+ * @return 0 on success, or an error code on failure.
+ */
+int ffmpeg_encoder_alloc(ffmpeg_encode_t *e, const char *url,
+                         const char *cont_fmt) {
+  int ret;
+
+  ret = avformat_alloc_output_context2(&e->fmt_ctx, nullptr, cont_fmt, url);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avformat_alloc_output_context2");
+    return pollux_err_resource_alloc;
+  }
+
+  return 0;
+}
+
 /**
  * @brief Initializes the ffmpeg encoder for a given output. The output can be
  * a local file or a network url.
@@ -42,11 +65,8 @@ int ffmpeg_encoder_init(ffmpeg_encode_t *e, const char *url,
                         const char *cont_fmt) {
   int ret;
 
-  ret = avformat_alloc_output_context2(&e->fmt_ctx, nullptr, cont_fmt, url);
-  if (ret < 0) {
-    ffmpeg_error(ret, "avformat_alloc_output_context2");
-    return pollux_err_resource_alloc;
-  }
+  if ((ret = ffmpeg_encoder_alloc(e, url, cont_fmt)) != 0)
+    return ret;
 
   AVFormatContext *fc = e->fmt_ctx;
 
@@ -86,21 +106,10 @@ void ffmpeg_encoder_ctx_free(ffmpeg_encode_t *e) {
   }
 }
 
-/**
- * @details
- * - (1) The result of `avformat_new_stream` should be freed by the function
- * `avformat_free_context`, which is called in the function
- * `ffmpeg_encode_deinit`.
- */
-int ffmpeg_encoder_ctx_alloc(ffmpeg_encode_t *e, ffmpeg_encode_args_t *args,
-                             enum AVCodecID codec_id) {
+int ffmpeg_encoder_codec_alloc(ffmpeg_encode_t *e, ffmpeg_encode_args_t *args,
+                               enum AVCodecID codec_id) {
   AVFormatContext *fc = e->fmt_ctx;
 
-  if (!fc) {
-    sirius_error("Null pointer: [fmt_ctx]\n");
-    return pollux_err_not_init;
-  }
-
   const AVCodec **c = &e->codec;
   *c = avcodec_find_encoder(codec_id);
   if (!*c) {
@@ -108,13 +117,6 @@ int ffmpeg_encoder_ctx_alloc(ffmpeg_encode_t *e, ffmpeg_encode_args_t *args,
     return pollux_err_resource_alloc;
   }
 
-  AVStream **s = &e->stream;
-  *s = avformat_new_stream(fc, *c);
-  if (!*s) {
-    sirius_error("avformat_new_stream\n");
-    return pollux_err_resource_alloc;
-  }
-
   AVCodecContext **cc = &e->codec_ctx;
   *cc = avcodec_alloc_context3(*c);
   if (!*cc) {
@@ -133,29 +135,64 @@ int ffmpeg_encoder_ctx_alloc(ffmpeg_encode_t *e, ffmpeg_encode_args_t *args,
   (*cc)->pix_fmt = args->pix_fmt;
   (*cc)->thread_count = args->thread_count;
 
-  if (fc->oformat->flags & AVFMT_GLOBALHEADER) {
+  if (fc && (fc->oformat->flags & AVFMT_GLOBALHEADER)) {
     (*cc)->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
   }
 
   return 0;
 }
 
+/**
+ * @details
+ * - (1) The result of `avformat_new_stream` should be freed by the function
+ * `avformat_free_context`, which is called in the function
+ * `ffmpeg_encode_deinit`.
+ */
+int ffmpeg_encoder_ctx_alloc(ffmpeg_encode_t *e, ffmpeg_encode_args_t *args,
+                             enum AVCodecID codec_id) {
+  int ret;
+  AVFormatContext *fc = e->fmt_ctx;
+
+  if (!fc) {
+    sirius_error("Null pointer: [fmt_ctx]\n");
+    return pollux_err_not_init;
+  }
+
+  if ((ret = ffmpeg_encoder_codec_alloc(e, args, codec_id)) != 0)
+    return ret;
+
+  AVStream **s = &e->stream;
+  *s = avformat_new_stream(fc, e->codec);
+  if (!*s) {
+    sirius_error("avformat_new_stream\n");
+    return pollux_err_resource_alloc;
+  }
+
+  return 0;
+}
+
 void ffmpeg_encoder_close(ffmpeg_encode_t *e) {
   // ...
 }
 
+int ffmpeg_encoder_codec_open(ffmpeg_encode_t *e) {
+  int ret = avcodec_open2(e->codec_ctx, e->codec, nullptr);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avcodec_open2");
+    return pollux_err_resource_alloc;
+  }
+
+  return 0;
+}
+
 int ffmpeg_encoder_open(ffmpeg_encode_t *e) {
   int ret;
   AVFormatContext *fc = e->fmt_ctx;
   AVCodecContext **cc = &e->codec_ctx;
   AVStream **s = &e->stream;
-  const AVCodec *c = e->codec;
 
-  ret = avcodec_open2(*cc, c, nullptr);
-  if (ret < 0) {
-    ffmpeg_error(ret, "avcodec_open2");
-    return pollux_err_resource_alloc;
-  }
+  if ((ret = ffmpeg_encoder_codec_open(e)) != 0)
+    return ret;
 
   AVCodecParameters *cp = (*s)->codecpar;
   ret = avcodec_parameters_from_context(cp, *cc);
@@ -0,0 +1,66 @@
+#include "pollux/internal/codec/ffmpeg_io.h"
+
+#include <libavutil/mem.h>
+
+#include "pollux/internal/util.h"
+#include "pollux/pollux_erron.h"
+
+int ffmpeg_io_alloc(ffmpeg_io_t **io_ptr, void *priv_data, int buffer_size,
+                    int (*read_packet)(void *opaque, uint8_t *buf,
+                                       int buf_size),
+                    int64_t (*seek)(void *opaque, int64_t offset, int whence),
+                    void (*close)(ffmpeg_io_t *io)) {
+  ffmpeg_io_t *io = calloc(1, sizeof(ffmpeg_io_t));
+  if (!io) {
+    sirius_error("calloc -> 'ffmpeg_io_t'\n");
+    return pollux_err_memory_alloc;
+  }
+
+  /**
+   * @note The buffer may be reallocated by `AVIO`, it is released through the
+   * `buffer` member of the `AVIOContext`.
+   */
+  unsigned char *buffer = av_malloc(buffer_size);
+  if (!buffer) {
+    sirius_error("av_malloc\n");
+    goto label_free1;
+  }
+
+  io->avio = avio_alloc_context(buffer, buffer_size, 0, priv_data, read_packet,
+                                nullptr, seek);
+  if (!io->avio) {
+    sirius_error("avio_alloc_context\n");
+    goto label_free2;
+  }
+
+  io->priv_data = priv_data;
+  io->close = close;
+  *io_ptr = io;
+
+  return 0;
+
+label_free2:
+  av_free(buffer);
+label_free1:
+  free(io);
+
+  return pollux_err_resource_alloc;
+}
+
+void ffmpeg_io_close(ffmpeg_io_t **io_ptr) {
+  if (!io_ptr || !*io_ptr)
+    return;
+
+  ffmpeg_io_t *io = *io_ptr;
+
+  if (io->avio) {
+    av_freep(&io->avio->buffer);
+    avio_context_free(&io->avio);
+  }
+
+  if (io->close)
+    io->close(io);
+
+  free(io);
+  *io_ptr = nullptr;
+}
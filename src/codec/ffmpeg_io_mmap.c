@@ -0,0 +1,182 @@
+#include "pollux/internal/codec/ffmpeg_io.h"
+
+#include "pollux/internal/util.h"
+#include "pollux/pollux_erron.h"
+
+#ifndef _WIN32
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+
+/**
+ * @brief The size of the `AVIO` buffer. The copy from the mapping is cheap, a
+ * larger buffer mainly reduces the number of callbacks.
+ */
+#  define IO_BUFFER_SIZE (256 * 1024)
+
+/**
+ * @brief The kernel is advised to page in this many bytes ahead of the read
+ * position.
+ */
+#  define IO_READAHEAD_SIZE (32 * 1024 * 1024)
+
+typedef struct {
+  uint8_t *base;
+  int64_t size;
+
+  /**
+   * @brief Current read position.
+   */
+  int64_t pos;
+
+  /**
+   * @brief The end of the region that has been advised with `MADV_WILLNEED`.
+   */
+  int64_t advise_end;
+
+  int64_t page_size;
+} io_mmap_s;
+
+/**
+ * @brief Keep the `MADV_WILLNEED` window ahead of the read position. The
+ * advice is refreshed once half of the window has been consumed, so there is
+ * one `madvise` call per `IO_READAHEAD_SIZE / 2` bytes read.
+ */
+static inline void mmap_readahead(io_mmap_s *m) {
+  if (m->advise_end - m->pos > IO_READAHEAD_SIZE / 2 ||
+      m->advise_end >= m->size)
+    return;
+
+  int64_t start = sirius_max(m->pos, m->advise_end);
+  start -= start % m->page_size;
+  int64_t len = sirius_min((int64_t)IO_READAHEAD_SIZE, m->size - start);
+
+  if (madvise(m->base + start, len, MADV_WILLNEED))
+    sirius_debgsp("madvise (MADV_WILLNEED) failed\n");
+  m->advise_end = start + len;
+}
+
+static int mmap_read(void *opaque, uint8_t *buf, int buf_size) {
+  io_mmap_s *m = (io_mmap_s *)opaque;
+  int64_t left = m->size - m->pos;
+
+  if (left <= 0)
+    return AVERROR_EOF;
+
+  mmap_readahead(m);
+
+  int n = (int)sirius_min((int64_t)buf_size, left);
+  memcpy(buf, m->base + m->pos, n);
+  m->pos += n;
+
+  return n;
+}
+
+static int64_t mmap_seek(void *opaque, int64_t offset, int whence) {
+  io_mmap_s *m = (io_mmap_s *)opaque;
+  int64_t pos;
+
+  switch (whence & ~AVSEEK_FORCE) {
+  case AVSEEK_SIZE:
+    return m->size;
+  case SEEK_SET:
+    pos = offset;
+    break;
+  case SEEK_CUR:
+    pos = m->pos + offset;
+    break;
+  case SEEK_END:
+    pos = m->size + offset;
+    break;
+  default:
+    return AVERROR(EINVAL);
+  }
+
+  if (pos < 0 || pos > m->size)
+    return AVERROR(EINVAL);
+
+  /**
+   * @note Restart the readahead window from the new position.
+   */
+  if (pos < m->advise_end - IO_READAHEAD_SIZE || pos > m->advise_end)
+    m->advise_end = pos;
+  m->pos = pos;
+
+  return pos;
+}
+
+static void mmap_close(ffmpeg_io_t *io) {
+  io_mmap_s *m = (io_mmap_s *)io->priv_data;
+
+  if (m) {
+    munmap(m->base, m->size);
+    free(m);
+    io->priv_data = nullptr;
+  }
+}
+
+int ffmpeg_io_mmap_open(ffmpeg_io_t **io_ptr, const char *url) {
+  const char *path = ffmpeg_io_url_to_path(url);
+  struct stat st;
+
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    sirius_warnsp("Fail to open the file for `mmap`: %s\n", path);
+    return pollux_err_file_open;
+  }
+
+  if (fstat(fd, &st) || st.st_size <= 0) {
+    sirius_warnsp("Invalid file for `mmap`: %s\n", path);
+    close(fd);
+    return pollux_err_file_read;
+  }
+
+  /**
+   * @note The mapping holds its own reference of the file, the descriptor is
+   * not needed any more.
+   */
+  void *base = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    sirius_warnsp("mmap failed: %s\n", path);
+    return pollux_err_resource_alloc;
+  }
+
+  if (madvise(base, st.st_size, MADV_SEQUENTIAL))
+    sirius_debgsp("madvise (MADV_SEQUENTIAL) failed\n");
+
+  io_mmap_s *m = calloc(1, sizeof(io_mmap_s));
+  if (!m) {
+    sirius_error("calloc -> 'io_mmap_s'\n");
+    munmap(base, st.st_size);
+    return pollux_err_memory_alloc;
+  }
+  m->base = (uint8_t *)base;
+  m->size = st.st_size;
+  m->page_size = sysconf(_SC_PAGESIZE);
+  if (m->page_size <= 0)
+    m->page_size = 4096;
+  mmap_readahead(m);
+
+  int ret = ffmpeg_io_alloc(io_ptr, m, IO_BUFFER_SIZE, mmap_read, mmap_seek,
+                            mmap_close);
+  if (ret) {
+    munmap(base, st.st_size);
+    free(m);
+    return ret;
+  }
+
+  sirius_infosp("Memory-mapped input: %s, size: %" PRId64 "\n", path,
+                m->size);
+  return 0;
+}
+
+#else
+
+int ffmpeg_io_mmap_open(ffmpeg_io_t **io_ptr, const char *url) {
+  sirius_warnsp("Memory-mapped input is not supported on this platform\n");
+  return pollux_err_entry;
+}
+
+#endif
@@ -0,0 +1,327 @@
+#include <sirius/sirius_cond.h>
+#include <sirius/sirius_mutex.h>
+#include <sirius/sirius_thread.h>
+
+#include "pollux/internal/codec/ffmpeg_io.h"
+#include "pollux/internal/util.h"
+#include "pollux/pollux_erron.h"
+
+/**
+ * @brief The size of the `AVIO` buffer of the demuxer side.
+ */
+#define IO_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @brief The size of a single read of the readahead thread.
+ */
+#define IO_CHUNK_SIZE (256 * 1024)
+
+#define IO_WINDOW_MIN (1024 * 1024)
+
+typedef struct {
+  /**
+   * @brief The inner `AVIO` context, which is only used by the readahead
+   * thread after the input is opened.
+   */
+  AVIOContext *inner;
+  uint8_t *chunk;
+
+  /**
+   * @brief Ring buffer, `fill` bytes are available from the index `rd`.
+   */
+  uint8_t *ring;
+  int64_t cap, rd, fill;
+
+  /**
+   * @brief The stream position of the byte at the index `rd`.
+   */
+  int64_t pos;
+
+  /**
+   * @brief The stream size, cached when the input is opened.
+   */
+  int64_t size;
+
+  /**
+   * @brief The generation of the window, which is increased by every seek that
+   * invalidates the buffer. The data read for a stale generation is dropped.
+   */
+  uint64_t gen;
+
+  bool seek_req;
+  int64_t seek_pos;
+
+  bool eof;
+  int error;
+
+  atomic_bool exit_flag;
+  bool thread_flag;
+  sirius_thread_handle thread;
+
+  sirius_mutex_handle mtx;
+  sirius_cond_handle cond_data, cond_space;
+} io_prefetch_s;
+
+static int prefetch_interrupt(void *opaque) {
+  io_prefetch_s *p = (io_prefetch_s *)opaque;
+
+  return p->exit_flag ? 1 : 0;
+}
+
+static void ring_write(io_prefetch_s *p, const uint8_t *src, int64_t n) {
+  int64_t wr = (p->rd + p->fill) % p->cap;
+  int64_t n1 = sirius_min(n, p->cap - wr);
+
+  memcpy(p->ring + wr, src, n1);
+  if (n > n1)
+    memcpy(p->ring, src + n1, n - n1);
+  p->fill += n;
+}
+
+static void ring_read(io_prefetch_s *p, uint8_t *dst, int64_t n) {
+  int64_t n1 = sirius_min(n, p->cap - p->rd);
+
+  if (dst) {
+    memcpy(dst, p->ring + p->rd, n1);
+    if (n > n1)
+      memcpy(dst + n1, p->ring, n - n1);
+  }
+  p->rd = (p->rd + n) % p->cap;
+  p->fill -= n;
+  p->pos += n;
+}
+
+static void thread_prefetch(void *args) {
+  io_prefetch_s *p = (io_prefetch_s *)args;
+  int ret;
+
+  sirius_mutex_lock(&p->mtx);
+  while (!p->exit_flag) {
+    if (p->seek_req) {
+      uint64_t gen = p->gen;
+      int64_t pos = p->seek_pos;
+      p->seek_req = false;
+      sirius_mutex_unlock(&p->mtx);
+
+      int64_t r = avio_seek(p->inner, pos, SEEK_SET);
+
+      sirius_mutex_lock(&p->mtx);
+      if (r < 0 && gen == p->gen) {
+        ffmpeg_error((int)r, "avio_seek (prefetch)");
+        p->error = (int)r;
+        sirius_cond_broadcast(&p->cond_data);
+      }
+      continue;
+    }
+
+    if (p->fill == p->cap || p->eof || p->error) {
+      sirius_cond_wait(&p->cond_space, &p->mtx);
+      continue;
+    }
+
+    uint64_t gen = p->gen;
+    int n = (int)sirius_min((int64_t)IO_CHUNK_SIZE, p->cap - p->fill);
+    sirius_mutex_unlock(&p->mtx);
+
+    /**
+     * @note The storage is read without the lock, so that the demuxer can
+     * consume the buffered data meanwhile.
+     */
+    ret = avio_read(p->inner, p->chunk, n);
+
+    sirius_mutex_lock(&p->mtx);
+    if (gen != p->gen)
+      continue;
+
+    if (ret > 0) {
+      ring_write(p, p->chunk, ret);
+    } else if (ret == 0 || ret == AVERROR_EOF) {
+      p->eof = true;
+    } else {
+      if (!p->exit_flag)
+        ffmpeg_error(ret, "avio_read (prefetch)");
+      p->error = ret;
+    }
+    sirius_cond_broadcast(&p->cond_data);
+  }
+  sirius_mutex_unlock(&p->mtx);
+}
+
+static int prefetch_read(void *opaque, uint8_t *buf, int buf_size) {
+  io_prefetch_s *p = (io_prefetch_s *)opaque;
+  int ret;
+
+  sirius_mutex_lock(&p->mtx);
+  while (!p->fill && !p->eof && !p->error && !p->exit_flag)
+    sirius_cond_wait(&p->cond_data, &p->mtx);
+
+  if (p->fill) {
+    ret = (int)sirius_min((int64_t)buf_size, p->fill);
+    ring_read(p, buf, ret);
+    sirius_cond_signal(&p->cond_space);
+  } else if (p->error) {
+    ret = p->error;
+  } else {
+    ret = AVERROR_EOF;
+  }
+  sirius_mutex_unlock(&p->mtx);
+
+  return ret;
+}
+
+static int64_t prefetch_seek(void *opaque, int64_t offset, int whence) {
+  io_prefetch_s *p = (io_prefetch_s *)opaque;
+  int64_t pos;
+
+  sirius_mutex_lock(&p->mtx);
+  switch (whence & ~AVSEEK_FORCE) {
+  case AVSEEK_SIZE:
+    pos = p->size >= 0 ? p->size : AVERROR(ENOSYS);
+    goto label_unlock;
+  case SEEK_SET:
+    pos = offset;
+    break;
+  case SEEK_CUR:
+    pos = p->pos + offset;
+    break;
+  case SEEK_END:
+    if (p->size < 0) {
+      pos = AVERROR(ENOSYS);
+      goto label_unlock;
+    }
+    pos = p->size + offset;
+    break;
+  default:
+    pos = AVERROR(EINVAL);
+    goto label_unlock;
+  }
+
+  if (pos < 0) {
+    pos = AVERROR(EINVAL);
+    goto label_unlock;
+  }
+
+  if (pos >= p->pos && pos <= p->pos + p->fill) {
+    /**
+     * @brief A short forward seek inside the window, skip the buffered data.
+     */
+    ring_read(p, nullptr, pos - p->pos);
+  } else {
+    /**
+     * @brief Invalidate the window and restart the readahead from the new
+     * position.
+     */
+    p->gen++;
+    p->rd = 0;
+    p->fill = 0;
+    p->pos = pos;
+    p->eof = false;
+    p->error = 0;
+    p->seek_req = true;
+    p->seek_pos = pos;
+  }
+  sirius_cond_signal(&p->cond_space);
+
+label_unlock:
+  sirius_mutex_unlock(&p->mtx);
+  return pos;
+}
+
+static void prefetch_free(io_prefetch_s *p) {
+  if (p->thread_flag) {
+    sirius_mutex_lock(&p->mtx);
+    p->exit_flag = true;
+    sirius_cond_broadcast(&p->cond_space);
+    sirius_cond_broadcast(&p->cond_data);
+    sirius_mutex_unlock(&p->mtx);
+
+    sirius_thread_join(p->thread, nullptr);
+    p->thread_flag = false;
+  }
+
+  sirius_cond_destroy(&p->cond_space);
+  sirius_cond_destroy(&p->cond_data);
+  sirius_mutex_destroy(&p->mtx);
+
+  if (p->inner)
+    avio_closep(&p->inner);
+  av_freep(&p->chunk);
+  av_freep(&p->ring);
+  free(p);
+}
+
+static void prefetch_close(ffmpeg_io_t *io) {
+  io_prefetch_s *p = (io_prefetch_s *)io->priv_data;
+
+  if (p) {
+    prefetch_free(p);
+    io->priv_data = nullptr;
+  }
+}
+
+int ffmpeg_io_prefetch_open(ffmpeg_io_t **io_ptr, const char *url,
+                            int64_t size) {
+  int ret;
+
+  io_prefetch_s *p = calloc(1, sizeof(io_prefetch_s));
+  if (!p) {
+    sirius_error("calloc -> 'io_prefetch_s'\n");
+    return pollux_err_memory_alloc;
+  }
+
+  if (sirius_mutex_init(&p->mtx, nullptr))
+    goto label_free1;
+  if (sirius_cond_init(&p->cond_data, nullptr))
+    goto label_free2;
+  if (sirius_cond_init(&p->cond_space, nullptr))
+    goto label_free3;
+
+  p->cap = sirius_max(size, (int64_t)IO_WINDOW_MIN);
+  p->ring = av_malloc(p->cap);
+  p->chunk = av_malloc(IO_CHUNK_SIZE);
+  if (!p->ring || !p->chunk) {
+    sirius_error("av_malloc\n");
+    ret = pollux_err_memory_alloc;
+    goto label_free;
+  }
+
+  AVIOInterruptCB int_cb = {.callback = prefetch_interrupt, .opaque = p};
+  ret = avio_open2(&p->inner, url, AVIO_FLAG_READ, &int_cb, nullptr);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avio_open2 (prefetch)");
+    ret = pollux_err_file_open;
+    goto label_free;
+  }
+  p->size = avio_size(p->inner);
+
+  if (sirius_thread_create(&p->thread, nullptr, (void *)thread_prefetch,
+                           (void *)p)) {
+    sirius_error("sirius_thread_create\n");
+    ret = pollux_err_resource_alloc;
+    goto label_free;
+  }
+  p->thread_flag = true;
+
+  ret = ffmpeg_io_alloc(io_ptr, p, IO_BUFFER_SIZE, prefetch_read,
+                        p->inner->seekable ? prefetch_seek : nullptr,
+                        prefetch_close);
+  if (ret)
+    goto label_free;
+
+  sirius_infosp("Prefetch input: %s, window: %" PRId64 " bytes\n", url,
+                p->cap);
+  return 0;
+
+label_free:
+  prefetch_free(p);
+  return ret;
+
+label_free3:
+  sirius_cond_destroy(&p->cond_data);
+label_free2:
+  sirius_mutex_destroy(&p->mtx);
+label_free1:
+  free(p);
+
+  return pollux_err_resource_alloc;
+}
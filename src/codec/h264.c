@@ -0,0 +1,97 @@
+#include "pollux/codec/h264.h"
+
+#include "pollux/internal/codec/codec.h"
+
+static inline const char *map_speed_to_libx264_preset(int speed_level) {
+  codec_range_check_or_set(&speed_level);
+
+  if (speed_level >= codec_range_max)
+    return "ultrafast";
+  if (speed_level >= 14)
+    return "superfast";
+  if (speed_level >= 12)
+    return "veryfast";
+  if (speed_level >= 10)
+    return "faster";
+  if (speed_level >= 8)
+    return "fast";
+  if (speed_level >= 6)
+    return "medium";
+  if (speed_level >= 4)
+    return "slow";
+  if (speed_level >= 3)
+    return "slower";
+
+  return "veryslow";
+}
+
+static inline int map_quality_to_libx264_crf(int quality_level) {
+  codec_range_check_or_set(&quality_level);
+
+  /**
+   * @brief `libx264` `CRF` range is 0-51, lower is better.
+   * A common range is 18 (high quality) to 28 (lower quality).
+   * Map `quality_level` where higher is better to the `CRF` range.
+   *
+   * CRF 18 <---> quality_level codec_range_max
+   * CRF 33 <---> quality_level codec_range_min
+   */
+  int crf_value =
+    33 + (quality_level - 1) * (18 - 33) / (codec_range_max - codec_range_min);
+
+  return crf_value;
+}
+
+static void h264_priv_set_libx264(void *cc_priv,
+                                  const h264_encode_args_t *args) {
+  int ret;
+
+  if (args->speed_level != 0) {
+    const char *preset = map_speed_to_libx264_preset(args->speed_level);
+    sirius_infosp("`libx264`, preset: %s\n", preset);
+    ret = av_opt_set(cc_priv, "preset", preset, 0);
+    if (ret)
+      ffmpeg_warn(ret, "av_opt_set");
+  }
+
+  if (args->rc_mode == h264_rc_crf && args->quality_level != 0) {
+    int crf = map_quality_to_libx264_crf(args->quality_level);
+    sirius_infosp("`libx264`, crf: %d\n", crf);
+    ret = av_opt_set(cc_priv, "crf", int_to_str(crf), 0);
+    if (ret)
+      ffmpeg_warn(ret, "av_opt_set");
+  }
+
+  switch (args->tune_mode) {
+  case h264_tune_zerolatency:
+    sirius_infosp("`libx264`, tune: zerolatency\n");
+    ret = av_opt_set(cc_priv, "tune", "zerolatency", 0);
+    if (ret)
+      ffmpeg_warn(ret, "av_opt_set");
+    break;
+  case h264_tune_fast_codec:
+    sirius_infosp("`libx264`, tune: fastdecode\n");
+    ret = av_opt_set(cc_priv, "tune", "fastdecode", 0);
+    if (ret)
+      ffmpeg_warn(ret, "av_opt_set");
+    break;
+  default:
+    break;
+  }
+
+  if (args->advanced_options) {
+    sirius_infosp("`libx264`, advanced_options: %s\n", args->advanced_options);
+    ret = av_opt_set(cc_priv, "x264-params", args->advanced_options, 0);
+    if (ret)
+      ffmpeg_warn(ret, "av_opt_set");
+  }
+}
+
+void h264_priv_set(void *cc_priv, const h264_encode_args_t *args) {
+  if (!cc_priv || !args)
+    return;
+
+#ifdef codec_h264_libx264
+  h264_priv_set_libx264(cc_priv, args);
+#endif
+}
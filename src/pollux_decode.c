@@ -15,6 +15,7 @@
 #include "pollux/internal/ffmpeg_cvt/frame.h"
 #include "pollux/internal/ffmpeg_cvt/pixel.h"
 #include "pollux/internal/frame.h"
+#include "pollux/internal/stream.h"
 #include "pollux/internal/thread.h"
 #include "pollux/internal/util.h"
 #include "pollux/pollux_erron.h"
@@ -22,6 +23,12 @@
 
 #define FRAME_CACHE_MAX (1024)
 
+/**
+ * @brief The minimum number of frames between two changes of the catch-up
+ * level, so that the level does not oscillate.
+ */
+#define CATCH_UP_DWELL (8)
+
 typedef enum {
   uf_state_null,
   uf_state_end_url,
@@ -29,6 +36,11 @@ typedef enum {
 
 typedef struct {
   user_frame_state_s state;
+
+  /**
+   * @brief The seek generation in which the frame was decoded.
+   */
+  uint64_t gen;
 } frame_priv_s;
 
 typedef struct {
@@ -38,6 +50,107 @@ typedef struct {
   sirius_mutex_handle mtx;
 } thread_s;
 
+/**
+ * @brief Seek command, which is posted by `seek_file` and executed on the
+ * decoding thread. The timestamps are protected by `thread_s.mtx`.
+ */
+typedef struct {
+  atomic_bool pending;
+  int64_t min_ts, ts, max_ts;
+
+  /**
+   * @brief Increased by every `seek_file` call. The frames stamped with an
+   * older generation are discarded by `result_get`.
+   */
+  atomic_uint_fast64_t gen;
+} seek_s;
+
+/**
+ * @brief Auto-loop state, only accessed by the decoding thread.
+ */
+typedef struct {
+  /**
+   * @brief The remaining number of loops, negative for infinite.
+   */
+  int remaining;
+
+  /**
+   * @brief The timestamps of the current pass, before the offset is applied.
+   */
+  int64_t first_pts, last_pts, last_delta;
+
+  /**
+   * @brief The offset added to the timestamps of the current pass.
+   */
+  int64_t pts_offset;
+} loop_s;
+
+/**
+ * @brief Band output state, only accessed by the decoding thread.
+ */
+typedef struct {
+  /**
+   * @brief The conversion of the bands, separate from the conversion of the
+   * complete frames since the slice state is kept in the context.
+   */
+  struct SwsContext *sws_ctx;
+  pollux_frame_t *frame;
+
+  /**
+   * @brief The view of the source frame, when the conversion is disabled.
+   */
+  pollux_frame_t view;
+
+  /**
+   * @brief The next source row expected by the conversion, and the number of
+   * rows converted for the current frame.
+   */
+  int next_y, out_y;
+} band_s;
+
+/**
+ * @brief Packet input state, see `packet_param_set`.
+ */
+typedef struct {
+  /**
+   * @brief Serializes the access to the codec between `send_packet` and the
+   * decoding thread.
+   */
+  sirius_mutex_handle mtx;
+
+  /**
+   * @brief The number of packets sent and the number of receiving passes of
+   * the decoding thread, protected by `thread_s.mtx`.
+   */
+  uint64_t seq, pass;
+
+  /**
+   * @brief Set once the flush packet has been sent.
+   */
+  atomic_bool drain;
+} packet_s;
+
+/**
+ * @brief Catch-up state, the levels are:
+ * - (0) Full decoding.
+ *
+ * - (1) The non-reference frames are skipped by the decoder.
+ *
+ * - (2) Only the key frames are decoded, and a decoded frame is discarded
+ * before the image conversion unless the result cache is empty.
+ */
+typedef struct {
+  atomic_int level;
+  int dwell;
+
+  /**
+   * @brief The frame that was the least behind the wall clock, the lag of the
+   * following frames is measured relative to it.
+   */
+  int64_t anchor_wall_us, anchor_pts;
+  AVRational time_base;
+} catch_up_s;
+
 typedef struct {
   sirius_que_handle que_free, que_rst;
   pollux_frame_t *result[FRAME_CACHE_MAX];
@@ -51,9 +164,46 @@ typedef struct {
   bool cvt_enable;
   struct SwsContext *sws_ctx;
 
+  /**
+   * @brief The target pixel format of the image conversion.
+   */
+  enum AVPixelFormat cvt_fmt;
+
   ffmpeg_decode_t *decode;
 
+  /**
+   * @brief The time base of the stream, set to the results because the decoded
+   * frames of ffmpeg do not carry it.
+   */
+  AVRational time_base;
+
   thread_s thread;
+
+  seek_s seek;
+  /**
+   * @brief The generation stamped on the decoded frames, only accessed by the
+   * decoding thread.
+   */
+  uint64_t decode_gen;
+
+  loop_s loop;
+  catch_up_s catch_up;
+  band_s band;
+
+  /**
+   * @brief Whether the packets are fed by `send_packet` instead of a demuxer.
+   */
+  bool packet_mode;
+  packet_s packet;
+
+  /**
+   * @brief The number of frames in `que_rst`.
+   */
+  atomic_int rst_depth;
+
+  atomic_uint_fast64_t frames_decoded;
+  atomic_uint_fast64_t frames_dropped;
+  atomic_uint_fast64_t frames_skipped;
 } decode_ctx_s;
 
 static force_inline frame_t *get_pxf_ptr(pollux_frame_t *r) {
@@ -78,17 +228,66 @@ static force_inline int frame_put(sirius_que_handle q, pollux_frame_t *r) {
   return 0;
 }
 
-static inline pollux_frame_t *frame_get(sirius_que_handle q, thread_s *thread) {
+static force_inline int rst_put(decode_ctx_s *ctx, pollux_frame_t *r) {
+  ctx->rst_depth++;
+
+  int ret = frame_put(ctx->que_rst, r);
+  if (unlikely(ret))
+    ctx->rst_depth--;
+
+  return ret;
+}
+
+static force_inline int rst_get(decode_ctx_s *ctx, pollux_frame_t **r,
+                                uint64_t milliseconds) {
+  int ret = sirius_que_get(ctx->que_rst, (size_t *)r, milliseconds);
+  if (!ret)
+    ctx->rst_depth--;
+
+  return ret;
+}
+
+/**
+ * @brief Take the oldest unfetched result back for reuse, on behalf of the
+ * `pollux_decode_drop_oldest` policy.
+ */
+static inline bool frame_recycle_oldest(decode_ctx_s *ctx,
+                                        pollux_frame_t **r) {
+  if (rst_get(ctx, r, 0) || unlikely(!*r))
+    return false;
+
+  frame_priv_s *pxf_priv = get_pxf_priv_ptr2(*r);
+  if (pxf_priv->state == uf_state_null && pxf_priv->gen == ctx->seek.gen)
+    ctx->frames_dropped++;
+  pxf_priv->state = uf_state_null;
+
+  return true;
+}
+
+/**
+ * @brief Get a free frame on the decoding thread. Waiting is aborted when the
+ * thread exits or a seek command is posted.
+ */
+static inline pollux_frame_t *frame_get(decode_ctx_s *ctx) {
   int ret;
   pollux_frame_t *r;
-  thread_t *threadt = &thread->thread;
+  thread_t *threadt = &ctx->thread.thread;
 
   do {
-    ret = sirius_que_get(q, (size_t *)&r, 1);
+    ret = sirius_que_get(ctx->que_free, (size_t *)&r, 1);
     if (threadt->exit_flag) {
       sirius_infosp("The decoding thread has exited\n");
+      if (!ret && r)
+        frame_put(ctx->que_free, r);
       return nullptr;
     }
+    if (ret == sirius_err_timeout) {
+      if (ctx->seek.pending)
+        return nullptr;
+      if (ctx->args.drop_policy == pollux_decode_drop_oldest &&
+          frame_recycle_oldest(ctx, &r))
+        return r;
+    }
   } while (ret == sirius_err_timeout);
 
   if (ret || unlikely(!r)) {
@@ -98,28 +297,230 @@ static inline pollux_frame_t *frame_get(sirius_que_handle q, thread_s *thread) {
   return r;
 }
 
-static inline bool stream_seek(decode_ctx_s *ctx) {
+static inline void loop_reset(loop_s *loop) {
+  loop->first_pts = AV_NOPTS_VALUE;
+  loop->last_pts = AV_NOPTS_VALUE;
+  loop->last_delta = 0;
+  loop->pts_offset = 0;
+}
+
+static inline void catch_up_reset(catch_up_s *c) {
+  c->anchor_pts = AV_NOPTS_VALUE;
+}
+
+/**
+ * @brief Track the timestamps of the current pass and shift the frame by the
+ * offset of the previous passes.
+ */
+static force_inline void loop_pts_apply(loop_s *loop, AVFrame *avf) {
+  if (avf->pts == AV_NOPTS_VALUE)
+    return;
+
+  if (loop->first_pts == AV_NOPTS_VALUE)
+    loop->first_pts = avf->pts;
+  if (loop->last_pts != AV_NOPTS_VALUE && avf->pts > loop->last_pts)
+    loop->last_delta = avf->pts - loop->last_pts;
+  if (loop->last_pts == AV_NOPTS_VALUE || avf->pts > loop->last_pts)
+    loop->last_pts = avf->pts;
+
+  avf->pts += loop->pts_offset;
+  if (avf->best_effort_timestamp != AV_NOPTS_VALUE)
+    avf->best_effort_timestamp += loop->pts_offset;
+}
+
+/**
+ * @brief Seek back to the start of the url on the decoding thread, without
+ * queueing the end-of-url sentinel.
+ *
+ * @return false indicates the loop cannot be performed.
+ */
+static bool stream_loop(decode_ctx_s *ctx) {
+  int ret;
+  loop_s *loop = &ctx->loop;
+  ffmpeg_decode_t *d = ctx->decode;
+  AVStream *st = d->fmt_ctx->streams[d->stream_index];
+  int64_t start = st->start_time != AV_NOPTS_VALUE ? st->start_time : 0;
+
+  ret = avformat_seek_file(d->fmt_ctx, d->stream_index, INT64_MIN, start,
+                           start, AVSEEK_FLAG_BACKWARD);
+  avcodec_flush_buffers(d->codec_ctx);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avformat_seek_file (loop)");
+    return false;
+  }
+
+  /**
+   * @note The next pass starts one frame interval after the last frame.
+   */
+  if (loop->first_pts != AV_NOPTS_VALUE) {
+    loop->pts_offset += loop->last_pts + loop->last_delta - loop->first_pts;
+    loop->first_pts = AV_NOPTS_VALUE;
+    loop->last_pts = AV_NOPTS_VALUE;
+  }
+
+  if (loop->remaining > 0)
+    loop->remaining--;
+
+  sirius_debgsp("Loop to the start, pts offset: %" PRId64 "\n",
+                loop->pts_offset);
+  return true;
+}
+
+/**
+ * @brief Queue the end-of-url sentinel.
+ *
+ * @return false indicates the sentinel is not queued.
+ */
+static inline bool stream_end_put(decode_ctx_s *ctx) {
   pollux_frame_t *r;
   frame_priv_s *pxf_priv;
-  thread_s *thread = &ctx->thread;
-  thread_t *threadt = &thread->thread;
 
-  if (!(r = frame_get(ctx->que_free, thread)))
+  if (!(r = frame_get(ctx)))
     return false;
 
   pxf_priv = get_pxf_priv_ptr2(r);
   pxf_priv->state = uf_state_end_url;
+  pxf_priv->gen = ctx->decode_gen;
 
-  if (frame_put(ctx->que_rst, r))
-    return false;
+  return rst_put(ctx, r) ? false : true;
+}
+
+/**
+ * @brief Queue the end-of-url sentinel and park the decoding thread until a
+ * seek command is posted.
+ *
+ * @return false indicates the thread needs to exit.
+ */
+static inline bool stream_seek(decode_ctx_s *ctx) {
+  thread_s *thread = &ctx->thread;
+  thread_t *threadt = &thread->thread;
+
+  if (!stream_end_put(ctx))
+    return ctx->seek.pending && !threadt->exit_flag;
 
   sirius_mutex_lock(&thread->mtx);
-  sirius_cond_wait(&thread->cond, &thread->mtx);
+  while (!ctx->seek.pending && !threadt->exit_flag)
+    sirius_cond_wait(&thread->cond, &thread->mtx);
   sirius_mutex_unlock(&thread->mtx);
 
   return threadt->exit_flag ? false : true;
 }
 
+/**
+ * @brief Return the stale frames of the result queue to the free queue, so
+ * that the decoding thread does not stall on a full cache after a seek.
+ */
+static inline void stale_frames_recycle(decode_ctx_s *ctx) {
+  pollux_frame_t *r;
+
+  while (!rst_get(ctx, &r, 0) && r) {
+    get_pxf_priv_ptr2(r)->state = uf_state_null;
+    frame_put(ctx->que_free, r);
+  }
+}
+
+/**
+ * @brief Execute the pending seek command on the decoding thread.
+ *
+ * @return false indicates the seek failed.
+ */
+static bool seek_apply(decode_ctx_s *ctx) {
+  int ret;
+  int64_t min_ts, ts, max_ts;
+  seek_s *seek = &ctx->seek;
+  thread_s *thread = &ctx->thread;
+  ffmpeg_decode_t *d = ctx->decode;
+
+  /**
+   * @note Several commands posted in a row are collapsed into the latest one.
+   */
+  sirius_mutex_lock(&thread->mtx);
+  min_ts = seek->min_ts;
+  ts = seek->ts;
+  max_ts = seek->max_ts;
+  ctx->decode_gen = seek->gen;
+  seek->pending = false;
+  sirius_mutex_unlock(&thread->mtx);
+
+  stale_frames_recycle(ctx);
+  loop_reset(&ctx->loop);
+  catch_up_reset(&ctx->catch_up);
+
+  ret = avformat_seek_file(d->fmt_ctx, d->stream_index, min_ts, ts, max_ts,
+                           AVSEEK_FLAG_BACKWARD);
+  avcodec_flush_buffers(d->codec_ctx);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avformat_seek_file");
+    return false;
+  }
+
+  sirius_debgsp("Seek to: %" PRId64 ", generation: %" PRIu64 "\n", ts,
+                ctx->decode_gen);
+  return true;
+}
+
+static void catch_up_level_set(decode_ctx_s *ctx, int level) {
+  static const enum AVDiscard skip[] = {
+    AVDISCARD_DEFAULT,
+    AVDISCARD_NONREF,
+    AVDISCARD_NONKEY,
+  };
+  catch_up_s *c = &ctx->catch_up;
+
+  if (level == c->level)
+    return;
+
+  sirius_debgsp("Catch-up level: %d -> %d\n", (int)c->level, level);
+  c->level = level;
+  c->dwell = 0;
+  ctx->decode->codec_ctx->skip_frame = skip[level];
+}
+
+/**
+ * @brief Update the catch-up level with the pressure observed at a decoded
+ * frame. The pipeline is under pressure when the result cache is full or the
+ * output falls behind the wall clock by more than `catch_up_lag_ms`; it is
+ * relieved when both are back under half of the limits.
+ *
+ * @return Whether the frame should be discarded before the image conversion.
+ */
+static bool catch_up_update(decode_ctx_s *ctx, const AVFrame *frame) {
+  catch_up_s *c = &ctx->catch_up;
+  int64_t max_lag_us = (int64_t)ctx->args.catch_up_lag_ms * 1000;
+  int64_t lag_us = 0;
+  int depth = ctx->rst_depth;
+  int cache_count = sirius_max(1, ctx->args.cache_count);
+
+  if (frame->pts != AV_NOPTS_VALUE) {
+    int64_t now = (int64_t)sirius_get_time_us();
+
+    if (c->anchor_pts == AV_NOPTS_VALUE || frame->pts < c->anchor_pts) {
+      c->anchor_pts = frame->pts;
+      c->anchor_wall_us = now;
+    }
+
+    lag_us = now - c->anchor_wall_us -
+      av_rescale_q(frame->pts - c->anchor_pts, c->time_base, AV_TIME_BASE_Q);
+    if (lag_us < 0) {
+      c->anchor_pts = frame->pts;
+      c->anchor_wall_us = now;
+      lag_us = 0;
+    }
+  }
+
+  if (c->dwell < CATCH_UP_DWELL) {
+    c->dwell++;
+  } else if (lag_us > max_lag_us || depth >= cache_count) {
+    if (c->level < 2)
+      catch_up_level_set(ctx, c->level + 1);
+  } else if (lag_us < max_lag_us / 2 && depth <= cache_count / 2) {
+    if (c->level > 0)
+      catch_up_level_set(ctx, c->level - 1);
+  }
+
+  return c->level == 2 && depth > 0;
+}
+
 /**
  * @return
  * - (1) 0 indicates Zero or more frames were successfully received.
@@ -134,9 +535,34 @@ static int receive_and_queue_frames(decode_ctx_s *ctx) {
   thread_t *threadt = &thread->thread;
 
   while (!threadt->exit_flag) {
-    pollux_frame_t *r = frame_get(ctx->que_free, thread);
-    if (!r)
-      return -1;
+    /**
+     * @note The frames still buffered in the decoder are dropped by the seek.
+     */
+    if (ctx->seek.pending)
+      return 0;
+
+    pollux_frame_t *r;
+    if (ctx->args.drop_policy == pollux_decode_drop_newest) {
+      if (sirius_que_get(ctx->que_free, (size_t *)&r, 0) || unlikely(!r)) {
+        /**
+         * @note The cache is full, the new frame is received into the scratch
+         * frame and discarded.
+         */
+        ret = avcodec_receive_frame(cc, d->frame);
+        if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF)
+          return 0;
+        if (ret < 0) {
+          ffmpeg_error(ret, "avcodec_receive_frame");
+          return -1;
+        }
+        av_frame_unref(d->frame);
+        ctx->frames_decoded++;
+        ctx->frames_dropped++;
+        continue;
+      }
+    } else if (!(r = frame_get(ctx))) {
+      return ctx->seek.pending && !threadt->exit_flag ? 0 : -1;
+    }
 
     AVFrame *avf = get_pxf_ptr(r)->av_frame;
     AVFrame *rcv_frame = ctx->cvt_enable ? d->frame : avf;
@@ -156,15 +582,56 @@ static int receive_and_queue_frames(decode_ctx_s *ctx) {
       return -1;
     }
 
+    if (ctx->args.catch_up_lag_ms > 0 && catch_up_update(ctx, rcv_frame)) {
+      av_frame_unref(rcv_frame);
+      ctx->frames_decoded++;
+      ctx->frames_skipped++;
+      if (frame_put(ctx->que_free, r)) {
+        sirius_error("Failed to put unused frame back to free queue\n");
+        return -1;
+      }
+      continue;
+    }
+
     if (ctx->cvt_enable) {
-      avf->height =
-        sws_scale(ctx->sws_ctx, (const uint8_t *const *)rcv_frame->data,
-                  rcv_frame->linesize, 0, cc->height, avf->data, avf->linesize);
+      if (ctx->packet_mode) {
+        /**
+         * @note Without a demuxer, the source image is only known from the
+         * decoded frames.
+         */
+        pollux_img_t *img = ctx->args.fmt_cvt_img;
+
+        ctx->sws_ctx = sws_getCachedContext(
+          ctx->sws_ctx, rcv_frame->width, rcv_frame->height, rcv_frame->format,
+          img->width, img->height, ctx->cvt_fmt, SWS_BILINEAR, nullptr, nullptr,
+          nullptr);
+        if (unlikely(!ctx->sws_ctx)) {
+          sirius_error("sws_getCachedContext\n");
+          av_frame_unref(rcv_frame);
+          frame_put(ctx->que_free, r);
+          return -1;
+        }
+      }
+
+      avf->height = sws_scale(
+        ctx->sws_ctx, (const uint8_t *const *)rcv_frame->data,
+        rcv_frame->linesize, 0, rcv_frame->height, avf->data, avf->linesize);
+
+      /**
+       * @note The side data of the previous frame is replaced, not
+       * accumulated.
+       */
+      av_frame_remove_side_data(avf, AV_FRAME_DATA_MOTION_VECTORS);
+      av_frame_remove_side_data(avf, AV_FRAME_DATA_VIDEO_ENC_PARAMS);
       av_frame_copy_props(avf, rcv_frame);
     }
+    loop_pts_apply(&ctx->loop, avf);
+
+    get_pxf_priv_ptr2(r)->gen = ctx->decode_gen;
+    ctx->frames_decoded++;
 
     sirius_debgsp("Decode cur pts: %" PRId64 "\n", rcv_frame->pts);
-    if (frame_put(ctx->que_rst, r)) {
+    if (rst_put(ctx, r)) {
       sirius_error("Failed to put decoded frame into result queue\n");
       av_frame_unref(rcv_frame);
       return -1;
@@ -199,6 +666,9 @@ static int read_packet(decode_ctx_s *ctx) {
       receive_and_queue_frames(ctx);
     }
 
+    if (ctx->loop.remaining && !ctx->seek.pending && stream_loop(ctx))
+      return 1;
+
     return stream_seek(ctx) ? 1 : -1;
   }
 
@@ -215,6 +685,16 @@ static void thread_decode(void *args) {
   int ret;
   threadt->is_running = true;
   while (!threadt->exit_flag) {
+    if (unlikely(ctx->seek.pending)) {
+      /**
+       * @note A failed seek is reported as the end of the url, the caller may
+       * seek again.
+       */
+      if (!seek_apply(ctx) && !stream_seek(ctx))
+        break;
+      continue;
+    }
+
     ret = read_packet(ctx);
     if (unlikely(ret == 1))
       continue;
@@ -241,6 +721,98 @@ static void thread_decode(void *args) {
   threadt->is_running = false;
 }
 
+/**
+ * @brief The decoding thread of the packet mode. The codec is drained after
+ * every packet sent by `send_packet`; once the flush packet has been drained,
+ * the end-of-url sentinel is queued and the codec is reset for new packets.
+ */
+static void thread_packet(void *args) {
+  decode_ctx_s *ctx = (decode_ctx_s *)args;
+  packet_s *packet = &ctx->packet;
+  thread_s *thread = &ctx->thread;
+  thread_t *threadt = &thread->thread;
+  uint64_t seen = 0;
+
+  int ret;
+  threadt->is_running = true;
+  while (!threadt->exit_flag) {
+    sirius_mutex_lock(&thread->mtx);
+    seen = packet->seq;
+    sirius_mutex_unlock(&thread->mtx);
+
+    bool drain = packet->drain;
+
+    sirius_mutex_lock(&packet->mtx);
+    ret = receive_and_queue_frames(ctx);
+    if (ret == 0 && drain) {
+      avcodec_flush_buffers(ctx->decode->codec_ctx);
+      packet->drain = false;
+    }
+    sirius_mutex_unlock(&packet->mtx);
+
+    if (ret != 0)
+      break;
+    if (drain && !stream_end_put(ctx))
+      break;
+
+    sirius_mutex_lock(&thread->mtx);
+    packet->pass++;
+    sirius_cond_broadcast(&thread->cond);
+    while (packet->seq == seen && !threadt->exit_flag)
+      sirius_cond_wait(&thread->cond, &thread->mtx);
+    sirius_mutex_unlock(&thread->mtx);
+  }
+
+  threadt->is_running = false;
+  sirius_mutex_lock(&thread->mtx);
+  sirius_cond_broadcast(&thread->cond);
+  sirius_mutex_unlock(&thread->mtx);
+}
+
+/**
+ * @brief The `draw_horiz_band` callback of the decoder.
+ */
+static void band_draw(AVCodecContext *cc, const AVFrame *src,
+                      int offset[AV_NUM_DATA_POINTERS], int y, int type,
+                      int height) {
+  decode_ctx_s *ctx = (decode_ctx_s *)cc->opaque;
+  pollux_decode_args_t *args = &ctx->args;
+  band_s *band = &ctx->band;
+
+  if (unlikely(!args->band_cb))
+    return;
+
+  if (!band->sws_ctx) {
+    if (likely(cvt_frame_ff_to_plx(src, &band->view)))
+      args->band_cb(args->band_opaque, &band->view, y, height);
+    return;
+  }
+
+  if (y == 0) {
+    band->next_y = 0;
+    band->out_y = 0;
+  }
+  if (y != band->next_y) {
+    /**
+     * @note The slices of a conversion must be passed from top to bottom, an
+     * out-of-order band (e.g. of a field picture) is not converted.
+     */
+    sirius_debgsp("Skip the out-of-order band: %d, expected: %d\n", y,
+                  band->next_y);
+    return;
+  }
+
+  AVFrame *dst = get_pxf_ptr(band->frame)->av_frame;
+  int n = sws_scale(band->sws_ctx, (const uint8_t *const *)src->data,
+                    src->linesize, y, height, dst->data, dst->linesize);
+  band->next_y = y + height;
+  if (n > 0) {
+    band->frame->pts = src->pts;
+    args->band_cb(args->band_opaque, band->frame, band->out_y, n);
+    band->out_y += n;
+  }
+}
+
 static void decoder_ffmpeg_deinit(decode_ctx_s *ctx) {
   ffmpeg_decode_t *d = ctx->decode;
 
@@ -248,17 +820,65 @@ static void decoder_ffmpeg_deinit(decode_ctx_s *ctx) {
   ffmpeg_decoder_destroy(&d);
 }
 
+static void decoder_ffmpeg_args_fill(decode_ctx_s *ctx,
+                                     const pollux_decode_args_t *args,
+                                     ffmpeg_decode_args_t *ffmpeg_args) {
+  if (!args)
+    return;
+
+  ffmpeg_args->thread_count = args->thread_count;
+  ffmpeg_args->mmap_enable = args->mmap_enable;
+  ffmpeg_args->prefetch_size = (int64_t)args->prefetch_size_mb * 1024 * 1024;
+  ffmpeg_args->low_delay = args->low_delay;
+  if (args->export_side_data & POLLUX_DECODE_EXPORT_MVS)
+    ffmpeg_args->export_side_data |= AV_CODEC_EXPORT_DATA_MVS;
+  if (args->export_side_data & POLLUX_DECODE_EXPORT_QP)
+    ffmpeg_args->export_side_data |= AV_CODEC_EXPORT_DATA_VIDEO_ENC_PARAMS;
+  if (args->band_cb) {
+    ffmpeg_args->draw_horiz_band = band_draw;
+    ffmpeg_args->opaque = (void *)ctx;
+  }
+}
+
+static bool decoder_ffmpeg_packet_init(decode_ctx_s *ctx,
+                                       pollux_codec_id_t codec_id,
+                                       pollux_rational time_base,
+                                       const pollux_decode_args_t *args) {
+  ffmpeg_decode_t **d_ptr = &ctx->decode;
+  ffmpeg_decode_args_t ffmpeg_args = {0};
+  enum AVCodecID id;
+
+  if (!cvt_codec_id_plx_to_ff(codec_id, &id)) {
+    sirius_error("Invalid codec id: %d\n", codec_id);
+    return false;
+  }
+
+  decoder_ffmpeg_args_fill(ctx, args, &ffmpeg_args);
+  ffmpeg_args.pkt_timebase.num = time_base.num;
+  ffmpeg_args.pkt_timebase.den = time_base.den;
+
+  if (!(*d_ptr = ffmpeg_decoder_create_codec(id, &ffmpeg_args)))
+    return false;
+  if (ffmpeg_decoder_alloc_buffers(*d_ptr))
+    goto label_free1;
+
+  return true;
+
+label_free1:
+  ffmpeg_decoder_destroy(d_ptr);
+
+  return false;
+}
+
 static bool decoder_ffmpeg_init(decode_ctx_s *ctx, const char *url,
                                 const pollux_decode_args_t *args) {
   ffmpeg_decode_t **d_ptr = &ctx->decode;
   ffmpeg_decode_args_t ffmpeg_args = {0};
 
-  if (!(*d_ptr = ffmpeg_decoder_create(url)))
-    return false;
+  decoder_ffmpeg_args_fill(ctx, args, &ffmpeg_args);
 
-  if (args) {
-    ffmpeg_args.thread_count = args->thread_count;
-  }
+  if (!(*d_ptr = ffmpeg_decoder_create(url, &ffmpeg_args)))
+    return false;
 
   /**
    * @note `AVMEDIA_TYPE_VIDEO` default, Subsequent improvement.
@@ -299,6 +919,25 @@ static bool decoder_sws_init(decode_ctx_s *ctx, const ffmpeg_decode_t *d) {
     return true;
 
   enum AVPixelFormat fmt;
+  if (ctx->packet_mode) {
+    /**
+     * @note The source image is unknown before the first frame, the
+     * conversion context is created on the decoding thread.
+     */
+    if (!cvt_pix_plx_to_ff(img->fmt, &fmt) || img->width <= 0 ||
+        img->height <= 0) {
+      sirius_error("The decoding image configuration is required to be "
+                   "complete in the packet mode\n");
+      return false;
+    }
+    if (img->align <= 0)
+      img->align = align_get_alignment();
+
+    ctx->cvt_fmt = fmt;
+    ctx->cvt_enable = true;
+    return true;
+  }
+
   if (!cvt_pix_plx_to_ff(img->fmt, &fmt)) {
     sirius_warnsp("%s [Format: %d] %s\n", img->fmt, str_d);
     fmt = cc->pix_fmt;
@@ -341,13 +980,56 @@ static bool decoder_sws_init(decode_ctx_s *ctx, const ffmpeg_decode_t *d) {
     return false;
   }
 
+  ctx->cvt_fmt = fmt;
   ctx->cvt_enable = true;
   return true;
 }
 
+static void decoder_band_deinit(decode_ctx_s *ctx) {
+  band_s *band = &ctx->band;
+
+  if (band->sws_ctx) {
+    sws_freeContext(band->sws_ctx);
+    band->sws_ctx = nullptr;
+  }
+  if (band->frame)
+    pollux_frame_free(&band->frame);
+}
+
+static bool decoder_band_init(decode_ctx_s *ctx, const ffmpeg_decode_t *d) {
+  AVCodecContext *cc = d->codec_ctx;
+  pollux_img_t *img = ctx->args.fmt_cvt_img;
+  band_s *band = &ctx->band;
+  enum AVPixelFormat fmt;
+
+  memset(band, 0, sizeof(band_s));
+  if (!ctx->args.band_cb || !ctx->cvt_enable)
+    return true;
+  if (cc->width <= 0 || cc->height <= 0) {
+    sirius_warnsp("The source image is unknown, the bands are not converted\n");
+    return true;
+  }
+
+  if (pollux_frame_alloc(img, &band->frame))
+    return false;
+
+  cvt_pix_plx_to_ff(img->fmt, &fmt);
+  band->sws_ctx =
+    sws_getContext(cc->width, cc->height, cc->pix_fmt, img->width, img->height,
+                   fmt, SWS_BILINEAR, nullptr, nullptr, nullptr);
+  if (!band->sws_ctx) {
+    sirius_error("sws_getContext\n");
+    pollux_frame_free(&band->frame);
+    return false;
+  }
+
+  return true;
+}
+
 static void decoder_priv_args_free(decode_ctx_s *ctx) {
   pollux_decode_args_t *args = &ctx->args;
 
+  decoder_band_deinit(ctx);
   decoder_sws_deinit(ctx);
 
   if (args->fmt_cvt_img) {
@@ -372,13 +1054,22 @@ static bool decoder_priv_args_alloc(decode_ctx_s *ctx,
       }
       memcpy(dst->fmt_cvt_img, src->fmt_cvt_img, sizeof(pollux_img_t));
     }
+
+    if (dst->low_delay) {
+      dst->cache_count = 1;
+      dst->drop_policy = pollux_decode_drop_oldest;
+    }
   }
 
   if (!decoder_sws_init(ctx, ctx->decode))
     goto label_free1;
+  if (!decoder_band_init(ctx, ctx->decode))
+    goto label_free2;
 
   return true;
 
+label_free2:
+  decoder_sws_deinit(ctx);
 label_free1:
   if (dst->fmt_cvt_img) {
     free(dst->fmt_cvt_img);
@@ -468,6 +1159,7 @@ label_free:
 static void decoder_resource_free(decode_ctx_s *ctx) {
   thread_s *thread = &ctx->thread;
 
+  sirius_mutex_destroy(&ctx->packet.mtx);
   sirius_cond_destroy(&thread->cond);
   sirius_mutex_destroy(&thread->mtx);
 
@@ -485,9 +1177,13 @@ static bool decoder_resource_alloc(decode_ctx_s *ctx,
     goto label_free1;
   if (sirius_cond_init(&thread->cond, nullptr))
     goto label_free2;
+  if (sirius_mutex_init(&ctx->packet.mtx, nullptr))
+    goto label_free3;
 
   return true;
 
+label_free3:
+  sirius_cond_destroy(&thread->cond);
 label_free2:
   sirius_mutex_destroy(&thread->mtx);
 label_free1:
@@ -531,10 +1227,32 @@ static bool decoder_thread_start(decode_ctx_s *ctx) {
   thread_s *thread = &ctx->thread;
   thread_t *threadt = &thread->thread;
 
+  ctx->seek.pending = false;
+  ctx->seek.gen = 0;
+  ctx->decode_gen = 0;
+  ctx->frames_decoded = 0;
+  ctx->frames_dropped = 0;
+  ctx->frames_skipped = 0;
+  ctx->rst_depth = 0;
+  ctx->catch_up.level = 0;
+  ctx->catch_up.dwell = 0;
+  ctx->time_base = ctx->packet_mode
+    ? ctx->decode->codec_ctx->pkt_timebase
+    : ctx->decode->fmt_ctx->streams[ctx->decode->stream_index]->time_base;
+  ctx->catch_up.time_base = ctx->time_base;
+  catch_up_reset(&ctx->catch_up);
+  ctx->loop.remaining = ctx->packet_mode ? 0 : ctx->args.loop_count;
+  loop_reset(&ctx->loop);
+  ctx->packet.seq = 0;
+  ctx->packet.pass = 0;
+  ctx->packet.drain = false;
+
   threadt->exit_flag = false;
   threadt->is_running = true;
-  if (sirius_thread_create(&threadt->thread, nullptr, (void *)thread_decode,
-                           (void *)ctx)) {
+  if (sirius_thread_create(
+        &threadt->thread, nullptr,
+        ctx->packet_mode ? (void *)thread_packet : (void *)thread_decode,
+        (void *)ctx)) {
     threadt->is_running = false;
     return false;
   } else {
@@ -551,10 +1269,20 @@ static inline void decoder_deinit(decode_ctx_s *ctx) {
   decoder_ffmpeg_deinit(ctx);
 }
 
+/**
+ * @param[in] url The source url, nullptr for the packet mode.
+ */
 static inline bool decoder_init(decode_ctx_s *ctx, const char *url,
+                                pollux_codec_id_t codec_id,
+                                pollux_rational time_base,
                                 const pollux_decode_args_t *args) {
-  if (!decoder_ffmpeg_init(ctx, url, args))
+  ctx->packet_mode = !url;
+  if (ctx->packet_mode) {
+    if (!decoder_ffmpeg_packet_init(ctx, codec_id, time_base, args))
+      return false;
+  } else if (!decoder_ffmpeg_init(ctx, url, args)) {
     return false;
+  }
   if (!decoder_priv_args_alloc(ctx, args))
     goto label_free1;
   if (!decoder_resource_alloc(ctx, &ctx->args))
@@ -576,21 +1304,11 @@ label_free1:
 
 static inline void stream_fill(pollux_decode_stream_info_t *s,
                                const ffmpeg_decode_t *d) {
-  AVCodecContext *cc = d->codec_ctx;
-
-  s->video_width = cc->width;
-  s->video_height = cc->height;
-  s->bit_rate = cc->bit_rate;
-  s->video_frame_rate.num = cc->framerate.num;
-  s->video_frame_rate.den = cc->framerate.den;
-  s->max_b_frames = cc->max_b_frames;
-  s->gop_size = cc->gop_size;
-
-  cvt_pix_ff_to_plx(cc->pix_fmt, &s->video_img_fmt);
-  cvt_codec_id_ff_to_plx(cc->codec_id, &s->video_codec_id);
-
   AVFormatContext *fc = d->fmt_ctx;
-  s->duration = fc->duration;
+  AVRational tb = fc ? fc->streams[d->stream_index]->time_base
+                     : d->codec_ctx->pkt_timebase;
+
+  stream_fill_codec(s, d->codec_ctx, fc, tb);
 }
 
 static force_inline void result_ret_debg(int ret) {
@@ -632,7 +1350,30 @@ static inline int decoder_param_set(decode_ctx_s *ctx, const char *url,
 
   ctx->param_set_flag = false;
 
-  if (!decoder_init(ctx, url, args))
+  if (!decoder_init(ctx, url, pollux_codec_id_none, (pollux_rational){0, 1},
+                    args))
+    return pollux_err_resource_alloc;
+
+  ctx->param_set_flag = true;
+
+  return 0;
+}
+
+static inline int decoder_packet_param_set(decode_ctx_s *ctx,
+                                           pollux_codec_id_t codec_id,
+                                           pollux_rational time_base,
+                                           const pollux_decode_args_t *args) {
+  if (ctx->param_set_flag)
+    decoder_deinit(ctx);
+
+  ctx->param_set_flag = false;
+
+  if (time_base.num <= 0 || time_base.den <= 0) {
+    sirius_error("Invalid time base: %d/%d\n", time_base.num, time_base.den);
+    return pollux_err_args;
+  }
+
+  if (!decoder_init(ctx, nullptr, codec_id, time_base, args))
     return pollux_err_resource_alloc;
 
   ctx->param_set_flag = true;
@@ -640,6 +1381,120 @@ static inline int decoder_param_set(decode_ctx_s *ctx, const char *url,
   return 0;
 }
 
+/**
+ * @brief The free callback of the wrapped packet buffer, which is called once
+ * libavcodec no longer references the data of the caller.
+ */
+static void packet_buffer_release(void *opaque, uint8_t *data) {
+  decode_ctx_s *ctx = (decode_ctx_s *)opaque;
+  pollux_decode_args_t *args = &ctx->args;
+
+  args->packet_release_cb(args->packet_opaque, data);
+}
+
+/**
+ * @brief Wake the decoding thread and wait for its next receiving pass, with
+ * `packet_s.mtx` held by the caller, which is released during the wait.
+ */
+static void packet_pass_wait(decode_ctx_s *ctx) {
+  packet_s *packet = &ctx->packet;
+  thread_s *thread = &ctx->thread;
+  thread_t *threadt = &thread->thread;
+
+  sirius_mutex_unlock(&packet->mtx);
+  sirius_mutex_lock(&thread->mtx);
+  uint64_t pass = packet->pass;
+  packet->seq++;
+  sirius_cond_broadcast(&thread->cond);
+  while (packet->pass == pass && threadt->is_running)
+    sirius_cond_wait(&thread->cond, &thread->mtx);
+  sirius_mutex_unlock(&thread->mtx);
+  sirius_mutex_lock(&packet->mtx);
+}
+
+static inline int decoder_send_packet(decode_ctx_s *ctx, const uint8_t *data,
+                                      int size, int64_t pts, int64_t dts,
+                                      int flags) {
+  int ret;
+  packet_s *packet = &ctx->packet;
+  thread_s *thread = &ctx->thread;
+  thread_t *threadt = &thread->thread;
+  AVPacket *pkt = ctx->decode->pkt;
+  bool drain = !data || size <= 0;
+
+  if (unlikely(!ctx->param_set_flag || !ctx->packet_mode)) {
+    sirius_error("The packet mode is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  sirius_mutex_lock(&packet->mtx);
+  if (!drain) {
+    /**
+     * @note Without the release callback, `pkt->buf` is nullptr and the data
+     * is copied by `avcodec_send_packet`.
+     */
+    if (ctx->args.packet_release_cb) {
+      pkt->buf = av_buffer_create((uint8_t *)data, size, packet_buffer_release,
+                                  (void *)ctx, AV_BUFFER_FLAG_READONLY);
+      if (unlikely(!pkt->buf)) {
+        sirius_mutex_unlock(&packet->mtx);
+        sirius_error("av_buffer_create\n");
+        return pollux_err_memory_alloc;
+      }
+    }
+    pkt->data = (uint8_t *)data;
+    pkt->size = size;
+    pkt->pts = pts;
+    pkt->dts = dts;
+    pkt->flags = flags & POLLUX_DECODE_PACKET_FLAG_KEY ? AV_PKT_FLAG_KEY : 0;
+  }
+
+  while (true) {
+    if (unlikely(!threadt->is_running)) {
+      ret = pollux_err_not_init;
+      break;
+    }
+
+    /**
+     * @note Until the decoding thread has drained the codec of the previous
+     * flush packet, the codec rejects the packets with `AVERROR_EOF`.
+     */
+    if (packet->drain) {
+      packet_pass_wait(ctx);
+      continue;
+    }
+
+    ret = avcodec_send_packet(ctx->decode->codec_ctx, drain ? nullptr : pkt);
+    if (ret != AVERROR(EAGAIN))
+      break;
+
+    /**
+     * @note The output of the codec is full, wait for a receiving pass of the
+     * decoding thread.
+     */
+    packet_pass_wait(ctx);
+  }
+  av_packet_unref(pkt);
+  if (ret == 0 && drain)
+    packet->drain = true;
+  sirius_mutex_unlock(&packet->mtx);
+
+  if (ret < 0) {
+    if (ret != pollux_err_not_init) {
+      ffmpeg_error(ret, "avcodec_send_packet");
+      ret = ret == AVERROR_EOF ? pollux_err_stream_end : pollux_err_args;
+    }
+    return ret;
+  }
+
+  sirius_mutex_lock(&thread->mtx);
+  packet->seq++;
+  sirius_cond_broadcast(&thread->cond);
+  sirius_mutex_unlock(&thread->mtx);
+
+  return 0;
+}
+
 static inline int decoder_result_free(decode_ctx_s *ctx, pollux_frame_t *rst) {
   if (likely(ctx->param_set_flag))
     return frame_put(ctx->que_free, rst);
@@ -655,19 +1510,33 @@ static inline int decoder_result_get(decode_ctx_s *ctx, pollux_frame_t **rst,
   *rst = nullptr;
 
   pollux_frame_t *r = nullptr;
-  ret = sirius_que_get(ctx->que_rst, (size_t *)&r, milliseconds);
-  if (ret || unlikely(!r)) {
-    if (likely(ctx->thread.thread.is_running)) {
-      ret = likely(ret == sirius_err_timeout) ? pollux_err_timeout
-                                              : pollux_err_resource_alloc;
-    } else {
-      ret = pollux_err_not_init;
+  frame_t *pxf;
+  frame_priv_s *pxf_priv;
+
+  while (true) {
+    ret = rst_get(ctx, &r, milliseconds);
+    if (ret || unlikely(!r)) {
+      if (likely(ctx->thread.thread.is_running)) {
+        ret = likely(ret == sirius_err_timeout) ? pollux_err_timeout
+                                                : pollux_err_resource_alloc;
+      } else {
+        ret = pollux_err_not_init;
+      }
+      goto label_free;
     }
-    goto label_free;
+
+    pxf = get_pxf_ptr(r);
+    pxf_priv = get_pxf_priv_ptr1(pxf);
+    if (likely(pxf_priv->gen == ctx->seek.gen))
+      break;
+
+    /**
+     * @brief Decoded before the latest seek, discard it.
+     */
+    pxf_priv->state = uf_state_null;
+    frame_put(ctx->que_free, r);
   }
 
-  frame_t *pxf = get_pxf_ptr(r);
-  frame_priv_s *pxf_priv = get_pxf_priv_ptr1(pxf);
   if (unlikely(pxf_priv->state != uf_state_null)) {
     ret = pxf_priv->state == uf_state_end_url ? pollux_err_stream_end : -1;
     pxf_priv->state = uf_state_null;
@@ -680,6 +1549,8 @@ static inline int decoder_result_get(decode_ctx_s *ctx, pollux_frame_t **rst,
     ret = pollux_err_args;
     goto label_free;
   }
+  r->time_base.num = ctx->time_base.num;
+  r->time_base.den = ctx->time_base.den;
   *rst = r;
 
 label_free:
@@ -689,30 +1560,47 @@ label_free:
 
 static inline int decoder_seek_file(decode_ctx_s *ctx, int64_t min_ts,
                                     int64_t ts, int64_t max_ts) {
-  int ret = 0;
   thread_s *thread = &ctx->thread;
-  thread_t *threadt = &thread->thread;
-  ffmpeg_decode_t *d = ctx->decode;
+  seek_s *seek = &ctx->seek;
 
   if (unlikely(!ctx->param_set_flag)) {
     sirius_error("The resource is uninitialized\n");
     return pollux_err_not_init;
   }
-
-  ret = avformat_seek_file(d->fmt_ctx, d->stream_index, min_ts, ts, max_ts,
-                           AVSEEK_FLAG_BACKWARD);
-  avcodec_flush_buffers(d->codec_ctx);
-  if (ret < 0) {
-    ffmpeg_error(ret, "avformat_seek_file");
-    threadt->exit_flag = true;
-    return -1;
+  if (unlikely(ctx->packet_mode)) {
+    sirius_error("Seeking is not available in the packet mode\n");
+    return pollux_err_args;
+  }
+  if (unlikely(!thread->thread.is_running)) {
+    sirius_error("The decoding thread has exited\n");
+    return pollux_err_not_init;
   }
 
   sirius_mutex_lock(&thread->mtx);
+  seek->min_ts = min_ts;
+  seek->ts = ts;
+  seek->max_ts = max_ts;
+  seek->gen++;
+  seek->pending = true;
   sirius_cond_signal(&thread->cond);
   sirius_mutex_unlock(&thread->mtx);
 
-  return ret;
+  return 0;
+}
+
+static inline int decoder_stats_get(decode_ctx_s *ctx,
+                                    pollux_decode_stats_t *stats) {
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  stats->frames_decoded = ctx->frames_decoded;
+  stats->frames_dropped = ctx->frames_dropped;
+  stats->frames_skipped = ctx->frames_skipped;
+  stats->catch_up_level = ctx->catch_up.level;
+
+  return 0;
 }
 
 static int ptr_release(pollux_decode_t *h) {
@@ -739,6 +1627,30 @@ static int ptr_param_set(pollux_decode_t *h, const char *url,
   return 0;
 }
 
+static int ptr_packet_param_set(pollux_decode_t *h, pollux_codec_id_t codec_id,
+                                pollux_rational time_base,
+                                const pollux_decode_args_t *args) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  int ret;
+  decode_ctx_s *ctx = (decode_ctx_s *)h->priv_data;
+  if ((ret = decoder_packet_param_set(ctx, codec_id, time_base, args)) != 0)
+    return ret;
+
+  stream_fill(&h->stream, ctx->decode);
+  return 0;
+}
+
+static int ptr_send_packet_ptr(pollux_decode_t *h, const uint8_t *data,
+                               int size, int64_t pts, int64_t dts, int flags) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  decode_ctx_s *ctx = (decode_ctx_s *)h->priv_data;
+  return decoder_send_packet(ctx, data, size, pts, dts, flags);
+}
+
 static int ptr_result_free_ptr(pollux_decode_t *h, pollux_frame_t *rst) {
   if (unlikely(!h || !h->priv_data || !rst))
     return pollux_err_entry;
@@ -765,6 +1677,14 @@ static int ptr_seek_file_ptr(pollux_decode_t *h, int64_t min_ts, int64_t ts,
   return decoder_seek_file(ctx, min_ts, ts, max_ts);
 }
 
+static int ptr_stats_get_ptr(pollux_decode_t *h, pollux_decode_stats_t *stats) {
+  if (unlikely(!h || !h->priv_data || !stats))
+    return pollux_err_entry;
+
+  decode_ctx_s *ctx = (decode_ctx_s *)h->priv_data;
+  return decoder_stats_get(ctx, stats);
+}
+
 static inline void ptr_copy(pollux_decode_t *h, decode_ctx_s *ctx) {
   h->priv_data = (void *)ctx;
 
@@ -773,6 +1693,9 @@ static inline void ptr_copy(pollux_decode_t *h, decode_ctx_s *ctx) {
   h->result_free = ptr_result_free_ptr;
   h->result_get = ptr_result_get_ptr;
   h->seek_file = ptr_seek_file_ptr;
+  h->stats_get = ptr_stats_get_ptr;
+  h->packet_param_set = ptr_packet_param_set;
+  h->send_packet = ptr_send_packet_ptr;
 }
 
 pollux_api void pollux_decode_deinit(pollux_decode_t *handle) {
@@ -0,0 +1,608 @@
+#include "pollux/pollux_demux.h"
+
+#include <sirius/sirius_errno.h>
+#include <sirius/sirius_queue.h>
+
+#include "pollux/internal/codec/ffmpeg_decode.h"
+#include "pollux/internal/stream.h"
+#include "pollux/internal/util.h"
+#include "pollux/pollux_erron.h"
+
+#define PACKET_CACHE_MAX (1024)
+
+#define ANALYZE_BUCKET_US (1000000)
+#define ANALYZE_SCENE_THRESHOLD (2.5)
+
+/**
+ * @brief The running average of the packet sizes of a picture type moves by
+ * 1 / ANALYZE_SIZE_WEIGHT of the difference for each packet.
+ */
+#define ANALYZE_SIZE_WEIGHT (8)
+
+typedef struct {
+  bool param_set_flag;
+
+  ffmpeg_decode_t *decode;
+
+  /**
+   * @brief The packet caches, each one holds an `AVPacket` in `priv_data`.
+   * The free caches are in `que_free`.
+   */
+  int packet_count;
+  pollux_packet_t *packets[PACKET_CACHE_MAX];
+  sirius_que_handle que_free;
+} demux_ctx_s;
+
+static force_inline int packet_put(sirius_que_handle q, pollux_packet_t *p) {
+  int ret = sirius_que_put(q, (size_t)p, sirius_timeout_none);
+  if (unlikely(ret)) {
+    sirius_error("sirius_que_put: %d, the queue is illegally occupied\n", ret);
+    return pollux_err_cache_overflow;
+  }
+
+  return 0;
+}
+
+static void demuxer_packet_free(demux_ctx_s *ctx) {
+  for (int i = 0; i < ctx->packet_count; ++i) {
+    pollux_packet_t **p = ctx->packets + i;
+
+    if (*p) {
+      AVPacket *pkt = (AVPacket *)(*p)->priv_data;
+
+      av_packet_free(&pkt);
+      free(*p);
+      *p = nullptr;
+    }
+  }
+  ctx->packet_count = 0;
+
+  if (ctx->que_free) {
+    if (sirius_que_free(ctx->que_free)) {
+      sirius_error("sirius_que_free\n");
+    } else {
+      ctx->que_free = nullptr;
+    }
+  }
+}
+
+static bool demuxer_packet_alloc(demux_ctx_s *ctx, int cache_count) {
+  int count = sirius_min(cache_count, PACKET_CACHE_MAX);
+  count = sirius_max(1, count);
+
+  sirius_que_t c = {.elem_nr = count, .que_type = sirius_que_type_mtx};
+  if (sirius_que_alloc(&c, &ctx->que_free)) {
+    sirius_error("sirius_que_alloc\n");
+    return false;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    pollux_packet_t *p = calloc(1, sizeof(pollux_packet_t));
+    if (!p) {
+      sirius_error("calloc -> 'pollux_packet_t'\n");
+      goto label_free;
+    }
+    ctx->packets[ctx->packet_count++] = p;
+
+    if (!(p->priv_data = (void *)av_packet_alloc())) {
+      sirius_error("av_packet_alloc failed\n");
+      goto label_free;
+    }
+
+    if (packet_put(ctx->que_free, p))
+      goto label_free;
+  }
+
+  return true;
+
+label_free:
+  demuxer_packet_free(ctx);
+
+  return false;
+}
+
+static void demuxer_ffmpeg_deinit(demux_ctx_s *ctx) {
+  ffmpeg_decoder_destroy(&ctx->decode);
+}
+
+static bool demuxer_ffmpeg_init(demux_ctx_s *ctx, const char *url,
+                                const pollux_demux_args_t *args) {
+  ffmpeg_decode_t **d_ptr = &ctx->decode;
+  ffmpeg_decode_args_t ffmpeg_args = {0};
+
+  if (args) {
+    ffmpeg_args.mmap_enable = args->mmap_enable;
+    ffmpeg_args.prefetch_size = (int64_t)args->prefetch_size_mb * 1024 * 1024;
+  }
+
+  if (!(*d_ptr = ffmpeg_decoder_create(url, &ffmpeg_args)))
+    return false;
+
+  /**
+   * @note `AVMEDIA_TYPE_VIDEO` default, Subsequent improvement.
+   */
+  if (ffmpeg_decoder_find_stream(*d_ptr, AVMEDIA_TYPE_VIDEO))
+    goto label_free;
+  if (args && args->annexb && ffmpeg_decoder_annexb_open(*d_ptr))
+    goto label_free;
+
+  return true;
+
+label_free:
+  ffmpeg_decoder_destroy(d_ptr);
+
+  return false;
+}
+
+static inline void demuxer_deinit(demux_ctx_s *ctx) {
+  demuxer_packet_free(ctx);
+  demuxer_ffmpeg_deinit(ctx);
+}
+
+static inline bool demuxer_init(demux_ctx_s *ctx, const char *url,
+                                const pollux_demux_args_t *args) {
+  if (!demuxer_ffmpeg_init(ctx, url, args))
+    return false;
+  if (!demuxer_packet_alloc(ctx, args ? args->cache_count : 1))
+    goto label_free1;
+
+  return true;
+
+label_free1:
+  demuxer_ffmpeg_deinit(ctx);
+
+  return false;
+}
+
+static inline void demuxer_release(demux_ctx_s *ctx) {
+  if (!ctx->param_set_flag)
+    return;
+
+  demuxer_deinit(ctx);
+
+  ctx->param_set_flag = false;
+}
+
+static inline int demuxer_param_set(demux_ctx_s *ctx, const char *url,
+                                    const pollux_demux_args_t *args) {
+  if (ctx->param_set_flag)
+    demuxer_deinit(ctx);
+
+  ctx->param_set_flag = false;
+
+  if (!demuxer_init(ctx, url, args))
+    return pollux_err_resource_alloc;
+
+  ctx->param_set_flag = true;
+
+  return 0;
+}
+
+static inline int demuxer_packet_free_one(demux_ctx_s *ctx,
+                                          pollux_packet_t *p) {
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  av_packet_unref((AVPacket *)p->priv_data);
+  p->data = nullptr;
+  p->size = 0;
+
+  return packet_put(ctx->que_free, p);
+}
+
+static inline int demuxer_read_packet(demux_ctx_s *ctx, pollux_packet_t **p,
+                                      uint64_t milliseconds) {
+  int ret;
+  pollux_packet_t *r = nullptr;
+
+  *p = nullptr;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  ret = sirius_que_get(ctx->que_free, (size_t *)&r, milliseconds);
+  if (ret || unlikely(!r)) {
+    if (likely(ret == sirius_err_timeout)) {
+      sirius_debgsp("No packet cache is released in time\n");
+      return pollux_err_timeout;
+    }
+    sirius_error("Failed to get the packet cache\n");
+    return pollux_err_resource_alloc;
+  }
+
+  AVPacket *pkt = (AVPacket *)r->priv_data;
+  if ((ret = ffmpeg_decoder_read_packet(ctx->decode, pkt)) != 0)
+    goto label_free;
+
+  /**
+   * @note The packet data is shared with the caller, keep a reference instead
+   * of the buffer of the demuxer.
+   */
+  if (unlikely(av_packet_make_refcounted(pkt) < 0)) {
+    av_packet_unref(pkt);
+    sirius_error("av_packet_make_refcounted failed\n");
+    ret = pollux_err_memory_alloc;
+    goto label_free;
+  }
+
+  AVStream *st = ctx->decode->fmt_ctx->streams[ctx->decode->stream_index];
+  r->data = pkt->data;
+  r->size = pkt->size;
+  r->pts = pkt->pts;
+  r->dts = pkt->dts;
+  r->duration = pkt->duration;
+  r->time_base.num = st->time_base.num;
+  r->time_base.den = st->time_base.den;
+  r->flags = pkt->flags & AV_PKT_FLAG_KEY ? POLLUX_PACKET_FLAG_KEY : 0;
+  *p = r;
+
+  return 0;
+
+label_free:
+  packet_put(ctx->que_free, r);
+  if (ret == pollux_err_stream_end)
+    sirius_infosp("Demuxed to end of the url\n");
+
+  return ret;
+}
+
+static inline int demuxer_seek_file(demux_ctx_s *ctx, int64_t min_ts,
+                                    int64_t ts, int64_t max_ts) {
+  int ret;
+  ffmpeg_decode_t *d = ctx->decode;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  ret = avformat_seek_file(d->fmt_ctx, d->stream_index, min_ts, ts, max_ts,
+                           AVSEEK_FLAG_BACKWARD);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avformat_seek_file");
+    return pollux_err_args;
+  }
+  if (d->bsf)
+    av_bsf_flush(d->bsf);
+
+  return 0;
+}
+
+/**
+ * @brief The state of `analyze`.
+ */
+typedef struct {
+  pollux_demux_analyze_args_t args;
+  pollux_demux_analysis_t *r;
+
+  const AVStream *st;
+  int64_t start_time;
+
+  int64_t min_pts, max_end;
+
+  bool gop_started;
+  int gop_len;
+  int64_t gop_sum, gops;
+
+  /**
+   * @brief The running averages of the packet sizes of I, P and B pictures.
+   */
+  double size_avg[3];
+
+  bool bucket_valid;
+  int64_t bucket_start, bucket_bytes;
+} analyze_s;
+
+static force_inline int64_t analyze_ts_us(const analyze_s *a, int64_t ts) {
+  if (ts == AV_NOPTS_VALUE)
+    return INT64_MIN;
+
+  return av_rescale_q(ts - a->start_time, a->st->time_base, AV_TIME_BASE_Q);
+}
+
+static void analyze_bucket_flush(analyze_s *a) {
+  int64_t bit_rate = a->bucket_bytes * 8 * 1000000 / a->args.bucket_us;
+
+  if (a->args.bitrate_cb)
+    a->args.bitrate_cb(a->bucket_start, a->bucket_bytes, bit_rate,
+                       a->args.opaque);
+  a->bucket_start += a->args.bucket_us;
+  a->bucket_bytes = 0;
+}
+
+/**
+ * @brief Put a packet into the bucket of its decoding timestamp. The buckets
+ * without packets are reported as empty.
+ */
+static void analyze_bucket_put(analyze_s *a, int64_t ts, int size) {
+  if (ts == INT64_MIN)
+    ts = a->bucket_valid ? a->bucket_start : 0;
+
+  int64_t start = ts - ts % a->args.bucket_us;
+  if (ts < 0 && ts % a->args.bucket_us)
+    start -= a->args.bucket_us;
+
+  if (!a->bucket_valid) {
+    a->bucket_valid = true;
+    a->bucket_start = start;
+  }
+  while (a->bucket_start < start)
+    analyze_bucket_flush(a);
+
+  a->bucket_bytes += size;
+}
+
+static void analyze_packet(analyze_s *a, const AVPacket *pkt,
+                           enum AVPictureType type) {
+  pollux_demux_analysis_t *r = a->r;
+  pollux_demux_frame_info_t info;
+  bool key = pkt->flags & AV_PKT_FLAG_KEY;
+  int cls;
+
+  info.pts = analyze_ts_us(a, pkt->pts);
+  info.dts = analyze_ts_us(a, pkt->dts);
+  info.pos = pkt->pos;
+  info.size = pkt->size;
+  info.flags = key ? POLLUX_PACKET_FLAG_KEY : 0;
+  info.pict_type = '?';
+
+  switch (type) {
+  case AV_PICTURE_TYPE_I:
+  case AV_PICTURE_TYPE_SI:
+    info.pict_type = 'I';
+    r->frames_i++;
+    cls = 0;
+    break;
+  case AV_PICTURE_TYPE_P:
+  case AV_PICTURE_TYPE_SP:
+    info.pict_type = 'P';
+    r->frames_p++;
+    cls = 1;
+    break;
+  case AV_PICTURE_TYPE_B:
+  case AV_PICTURE_TYPE_BI:
+    info.pict_type = 'B';
+    r->frames_b++;
+    cls = 2;
+    break;
+  default:
+    /**
+     * @note Without a parser, only the key frames are known to be intra.
+     */
+    if (key)
+      info.pict_type = 'I';
+    cls = key ? 0 : 1;
+    break;
+  }
+
+  r->frames++;
+  r->bytes += pkt->size;
+  if (key)
+    r->key_frames++;
+
+  /**
+   * @brief GOP structure, the packets before the first key frame are not a
+   * GOP.
+   */
+  if (key) {
+    if (a->gop_started) {
+      r->gop_min = a->gops ? sirius_min(r->gop_min, a->gop_len) : a->gop_len;
+      r->gop_max = sirius_max(r->gop_max, a->gop_len);
+      a->gop_sum += a->gop_len;
+      a->gops++;
+    }
+    a->gop_started = true;
+    a->gop_len = 0;
+  }
+  a->gop_len++;
+
+  /**
+   * @brief A scene change is coded with many intra blocks, even in P and B
+   * pictures, so the packet is much larger than the recent ones of the same
+   * type.
+   */
+  double *avg = a->size_avg + cls;
+  info.scene_hint = *avg > 0 && pkt->size > a->args.scene_threshold * *avg;
+  if (info.scene_hint)
+    r->scene_hints++;
+  *avg = *avg > 0 ? *avg + (pkt->size - *avg) / ANALYZE_SIZE_WEIGHT
+                  : (double)pkt->size;
+
+  if (info.pts != INT64_MIN) {
+    int64_t end =
+      info.pts + av_rescale_q(pkt->duration, a->st->time_base, AV_TIME_BASE_Q);
+    a->min_pts = sirius_min(a->min_pts, info.pts);
+    a->max_end = sirius_max(a->max_end, end);
+  }
+
+  analyze_bucket_put(a, info.dts != INT64_MIN ? info.dts : info.pts,
+                     pkt->size);
+
+  if (a->args.frame_cb)
+    a->args.frame_cb(&info, a->args.opaque);
+}
+
+static void analyze_finish(analyze_s *a) {
+  pollux_demux_analysis_t *r = a->r;
+
+  if (a->bucket_valid)
+    analyze_bucket_flush(a);
+
+  if (a->gops)
+    r->gop_avg = (double)a->gop_sum / a->gops;
+  if (a->max_end > a->min_pts)
+    r->duration = a->max_end - a->min_pts;
+  if (r->duration > 0)
+    r->bit_rate = r->bytes * 8 * 1000000 / r->duration;
+}
+
+static inline int demuxer_analyze(demux_ctx_s *ctx,
+                                  const pollux_demux_analyze_args_t *args,
+                                  pollux_demux_analysis_t *result) {
+  int ret;
+  ffmpeg_decode_t *d = ctx->decode;
+  analyze_s a = {0};
+  AVPacket *pkt;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  if (args)
+    memcpy(&a.args, args, sizeof(pollux_demux_analyze_args_t));
+  if (a.args.bucket_us <= 0)
+    a.args.bucket_us = ANALYZE_BUCKET_US;
+  if (a.args.scene_threshold <= 0)
+    a.args.scene_threshold = ANALYZE_SCENE_THRESHOLD;
+
+  memset(result, 0, sizeof(pollux_demux_analysis_t));
+  a.r = result;
+  a.st = d->fmt_ctx->streams[d->stream_index];
+  a.start_time = a.st->start_time != AV_NOPTS_VALUE ? a.st->start_time : 0;
+  a.min_pts = INT64_MAX;
+  a.max_end = INT64_MIN;
+
+  if (!d->parser && (ret = ffmpeg_decoder_parser_open(d)) != 0)
+    return ret;
+
+  if (!(pkt = av_packet_alloc())) {
+    sirius_error("av_packet_alloc failed\n");
+    return pollux_err_memory_alloc;
+  }
+
+  while ((ret = ffmpeg_decoder_read_packet(d, pkt)) == 0) {
+    analyze_packet(&a, pkt, ffmpeg_decoder_parse(d, pkt));
+    av_packet_unref(pkt);
+  }
+  av_packet_free(&pkt);
+  if (ret != pollux_err_stream_end)
+    return ret;
+
+  analyze_finish(&a);
+
+  sirius_infosp("Analyzed %" PRId64 " packets, %" PRId64 " key frames, %" PRId64
+                " bps\n",
+                result->frames, result->key_frames, result->bit_rate);
+  return 0;
+}
+
+static int ptr_release(pollux_demux_t *h) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  demux_ctx_s *ctx = (demux_ctx_s *)h->priv_data;
+  demuxer_release(ctx);
+
+  return 0;
+}
+
+static int ptr_param_set(pollux_demux_t *h, const char *url,
+                         const pollux_demux_args_t *args) {
+  if (unlikely(!h || !h->priv_data || !url))
+    return pollux_err_entry;
+
+  int ret;
+  demux_ctx_s *ctx = (demux_ctx_s *)h->priv_data;
+  if ((ret = demuxer_param_set(ctx, url, args)) != 0)
+    return ret;
+
+  ffmpeg_decode_t *d = ctx->decode;
+  stream_fill_par(&h->stream, d->fmt_ctx, d->fmt_ctx->streams[d->stream_index]);
+  return 0;
+}
+
+static int ptr_read_packet_ptr(pollux_demux_t *h, pollux_packet_t **packet,
+                               uint64_t milliseconds) {
+  if (unlikely(!h || !h->priv_data || !packet))
+    return pollux_err_entry;
+
+  demux_ctx_s *ctx = (demux_ctx_s *)h->priv_data;
+  return demuxer_read_packet(ctx, packet, milliseconds);
+}
+
+static int ptr_packet_free_ptr(pollux_demux_t *h, pollux_packet_t *packet) {
+  if (unlikely(!h || !h->priv_data || !packet))
+    return pollux_err_entry;
+
+  demux_ctx_s *ctx = (demux_ctx_s *)h->priv_data;
+  return demuxer_packet_free_one(ctx, packet);
+}
+
+static int ptr_seek_file_ptr(pollux_demux_t *h, int64_t min_ts, int64_t ts,
+                             int64_t max_ts) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  demux_ctx_s *ctx = (demux_ctx_s *)h->priv_data;
+  return demuxer_seek_file(ctx, min_ts, ts, max_ts);
+}
+
+static int ptr_analyze(pollux_demux_t *h,
+                       const pollux_demux_analyze_args_t *args,
+                       pollux_demux_analysis_t *result) {
+  if (unlikely(!h || !h->priv_data || !result))
+    return pollux_err_entry;
+
+  demux_ctx_s *ctx = (demux_ctx_s *)h->priv_data;
+  return demuxer_analyze(ctx, args, result);
+}
+
+static inline void ptr_copy(pollux_demux_t *h, demux_ctx_s *ctx) {
+  h->priv_data = (void *)ctx;
+
+  h->release = ptr_release;
+  h->param_set = ptr_param_set;
+  h->read_packet = ptr_read_packet_ptr;
+  h->packet_free = ptr_packet_free_ptr;
+  h->seek_file = ptr_seek_file_ptr;
+  h->analyze = ptr_analyze;
+}
+
+pollux_api void pollux_demux_deinit(pollux_demux_t *handle) {
+  if (!handle)
+    return;
+  if (!handle->priv_data)
+    goto label_free;
+
+  demux_ctx_s **ctx = (demux_ctx_s **)(&handle->priv_data);
+
+  demuxer_release(*ctx);
+
+  free(*ctx);
+  *ctx = nullptr;
+
+label_free:
+  free(handle);
+}
+
+pollux_api int pollux_demux_init(pollux_demux_t **handle) {
+  int ret = 0;
+
+  pollux_demux_t *h = (pollux_demux_t *)calloc(1, sizeof(pollux_demux_t));
+  if (!h) {
+    sirius_error("calloc -> 'pollux_demux_t'\n");
+    return pollux_err_memory_alloc;
+  }
+
+  demux_ctx_s *ctx = (demux_ctx_s *)calloc(1, sizeof(demux_ctx_s));
+  if (!ctx) {
+    sirius_error("calloc -> 'demux_ctx_s'\n");
+    ret = pollux_err_memory_alloc;
+    goto label_free1;
+  }
+
+  ptr_copy(h, ctx);
+  *handle = h;
+
+  return 0;
+
+label_free1:
+  free(h);
+
+  return ret;
+}
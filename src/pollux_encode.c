@@ -1,6 +1,9 @@
 #include "pollux/pollux_encode.h"
 
+#include <ctype.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/opt.h>
+#include <libswscale/swscale.h>
 #include <sirius/sirius_cond.h>
 #include <sirius/sirius_errno.h>
 #include <sirius/sirius_math.h>
@@ -13,10 +16,33 @@
 #include "pollux/internal/ffmpeg_cvt/codec_id.h"
 #include "pollux/internal/ffmpeg_cvt/frame.h"
 #include "pollux/internal/ffmpeg_cvt/pixel.h"
+#include "pollux/internal/frame.h"
 #include "pollux/internal/thread.h"
 #include "pollux/internal/util.h"
 #include "pollux/pollux_erron.h"
 
+#define PACKET_CACHE_DEFAULT (64)
+#define PACKET_CACHE_MAX (1024)
+#define FRAME_QUEUE_DEFAULT (8)
+#define FRAME_QUEUE_MAX (1024)
+#define INPUT_FRAME_DEFAULT (4)
+#define INPUT_FRAME_MAX (64)
+#define INPUT_FRAME_ALIGN (32)
+#define URL_MAX (1024)
+
+/**
+ * @brief The width of the index of a segment url is limited, so that a
+ * formatted url always fits in `SEGMENT_URL_MAX`.
+ */
+#define SEGMENT_WIDTH_MAX (16)
+#define SEGMENT_URL_MAX (URL_MAX + SEGMENT_WIDTH_MAX)
+
+/**
+ * @brief The time to wait on the packet queues before the exit flags are
+ * checked again, unit: ms.
+ */
+#define PACKET_WAIT_MS (100)
+
 typedef struct {
   thread_t thread;
 
@@ -24,6 +50,151 @@ typedef struct {
   sirius_mutex_handle mtx;
 } thread_s;
 
+typedef struct {
+  const pollux_frame_t *frame;
+  void *opaque;
+} frame_item_s;
+
+/**
+ * @brief The conversion of `auto_convert`, which is rebuilt only when the
+ * source image changes.
+ */
+typedef struct {
+  struct SwsContext *sws_ctx;
+  int width, height;
+  enum AVPixelFormat fmt;
+
+  AVFrame *src;
+} scaler_s;
+
+/**
+ * @brief A frame of `get_input_frame`, the `frame` must be the first member.
+ */
+typedef struct {
+  pollux_frame_t frame;
+  frame_t priv;
+} input_frame_s;
+
+/**
+ * @brief The state of `segment_seconds`. The timestamps are in the `time_base`
+ * of the stream.
+ */
+typedef struct {
+  /**
+   * @brief The url of `param_set` split at its integer conversion, whose flag
+   * and width are `zero` and `width`.
+   */
+  char prefix[URL_MAX];
+  char suffix[URL_MAX];
+  bool zero;
+  int width;
+
+  char playlist[URL_MAX];
+
+  /**
+   * @brief The length of a segment, 0 when the output is not segmented.
+   */
+  int64_t len;
+
+  /**
+   * @brief The pts from which the next frame is forced to be a key frame,
+   * which is only used by the sending thread.
+   */
+  int64_t force_pts;
+
+  /**
+   * @brief The current segment, which is only used by the writing thread. Its
+   * output is the one of `encode` for the first segment.
+   */
+  int index;
+  AVFormatContext *fmt_ctx;
+  int64_t start_pts;
+  int64_t end_pts;
+  int64_t last_pts;
+
+  /**
+   * @brief The durations of the complete segments, unit: s.
+   */
+  double *durations;
+  int count;
+  int cap;
+} segment_s;
+
+/**
+ * @brief The state of `ring_seconds`, which is only used by the writing thread
+ * except `trigger` and `frame_pts`. The timestamps are in the `time_base` of
+ * the stream. The events are written to the output of `segment`, whose index
+ * is the one of the event.
+ */
+typedef struct {
+  /**
+   * @brief The length of the ring, 0 when the output is not a ring.
+   */
+  int64_t len;
+
+  /**
+   * @brief A circular array of packets, from the oldest one, which is a key
+   * frame. The packets are allocated on demand and reused.
+   */
+  AVPacket **pkts;
+  int cap;
+  int head;
+  int count;
+
+  AVPacket *tmp;
+
+  /**
+   * @brief The end of the event of the last `trigger`, `AV_NOPTS_VALUE` when
+   * there is none.
+   */
+  atomic_int_fast64_t trigger;
+
+  /**
+   * @brief The pts of the last frame sent to the encoder, which the triggers
+   * are anchored to, because the packets lag behind it by the encoder delay.
+   */
+  atomic_int_fast64_t frame_pts;
+
+  /**
+   * @brief The event being written, which ends before the packet at
+   * `end_pts`. Its timestamps are shifted by `offset`, so that it starts at 0.
+   */
+  bool recording;
+  int64_t end_pts;
+  int64_t offset;
+} ring_s;
+
+/**
+ * @brief An output of `output_add`, whose packets are references of the ones
+ * of the encoder. The free caches are in `que_free`, and the packets to write
+ * in `que_write`.
+ */
+typedef struct {
+  char url[URL_MAX];
+  pollux_cont_fmt_t cont_fmt;
+  pollux_encode_sink_cb_t sink_cb;
+  void *opaque;
+
+  AVFormatContext *fmt_ctx;
+  AVRational time_base;
+
+  int packet_count;
+  AVPacket *packets[PACKET_CACHE_MAX];
+  sirius_que_handle que_free;
+  sirius_que_handle que_write;
+
+  thread_t writer;
+
+  /**
+   * @brief The packets are dropped up to the next key frame, which is only
+   * used by the encoding thread.
+   */
+  bool key_wait;
+  int64_t dropped;
+
+  atomic_bool failed;
+} output_s;
+
 typedef struct {
   sirius_mutex_handle mtx;
 
@@ -34,12 +205,82 @@ typedef struct {
   int64_t frame_index;
   int64_t base_pts;
 
+  /**
+   * @brief With `custom_pts`, the pts of the first frame, which is subtracted
+   * so that the stream starts at 0, and the pts of the last frame, both in the
+   * `time_base` of the stream.
+   */
+  int64_t first_pts;
+  int64_t last_pts;
+
+  /**
+   * @brief The next frame is encoded as a key frame.
+   */
+  atomic_bool key_frame_flag;
+
   pollux_encode_args_t args;
   atomic_bool param_set_flag;
 
   ffmpeg_encode_t encode;
 
+  /**
+   * @brief The packet caches. The encoded packets are handed to the writer
+   * thread through `que_write`, so that the output is written outside of
+   * `mtx` and a slow output only backs up the queue. The free caches are in
+   * `que_free`.
+   */
+  int packet_count;
+  AVPacket *packets[PACKET_CACHE_MAX];
+  sirius_que_handle que_free;
+  sirius_que_handle que_write;
+
+  thread_t writer;
+
+  /**
+   * @brief All the packets have been received from the encoder, and all of
+   * them have been written.
+   */
+  atomic_bool receive_eof_flag;
   atomic_bool encoder_eof_flag;
+
+  /**
+   * @brief The frames of `send_frame_async`, which are sent to the encoder by
+   * the feeding thread through `que_feed`. The free items are in
+   * `que_item_free`.
+   */
+  int item_count;
+  frame_item_s *items;
+  sirius_que_handle que_item_free;
+  sirius_que_handle que_feed;
+  AVFrame *feed_frame;
+
+  thread_t feeder;
+
+  /**
+   * @brief No more frames will be queued, the feeding thread exits once the
+   * queue is empty.
+   */
+  atomic_bool feed_eof_flag;
+  atomic_int feed_err;
+
+  /**
+   * @brief The frames of `get_input_frame`, the free ones are in
+   * `que_input_free`. Their images are the refcounted buffers of `buf_pool`,
+   * which are referenced by the encoder instead of being copied.
+   */
+  int input_count;
+  input_frame_s *inputs;
+  sirius_que_handle que_input_free;
+  AVBufferPool *buf_pool;
+  int buf_align;
+
+  scaler_s scaler;
+
+  segment_s segment;
+  ring_s ring;
+
+  output_s outputs[POLLUX_ENCODE_OUTPUT_MAX];
+  int output_count;
 } encode_ctx_s;
 
 /**
@@ -68,30 +309,142 @@ static inline void encoder_pts_init(encode_ctx_s *ctx) {
 
   ctx->frame_index = 0;
   ctx->base_pts = r.den / r.num / cc->framerate.num * cc->framerate.den;
+  ctx->first_pts = AV_NOPTS_VALUE;
+  ctx->last_pts = AV_NOPTS_VALUE;
+  ctx->key_frame_flag = false;
+}
+
+/**
+ * @note The pts of the caller is rescaled to the `time_base` of the stream.
+ * When it is missing, the pts follows the last one at the frame rate; when it
+ * does not increase, it is forced to, because the encoder rejects it.
+ */
+static force_inline int64_t frame_custom_pts(encode_ctx_s *ctx,
+                                             const pollux_frame_t *src) {
+  ffmpeg_encode_t *e = &ctx->encode;
+  int64_t pts;
+
+  if (src->pts != AV_NOPTS_VALUE) {
+    AVRational tb = {src->time_base.num, src->time_base.den};
+    if (tb.num <= 0 || tb.den <= 0) {
+      if (ctx->first_pts == AV_NOPTS_VALUE)
+        sirius_warnsp("The frame has no time base, the pts is taken in units "
+                      "of 1 / frame_rate\n");
+      tb = av_inv_q(e->codec_ctx->framerate);
+    }
+
+    pts = av_rescale_q(src->pts, tb, e->stream->time_base);
+    if (ctx->first_pts == AV_NOPTS_VALUE)
+      ctx->first_pts = pts;
+    pts -= ctx->first_pts;
+  } else {
+    pts = ctx->last_pts == AV_NOPTS_VALUE ? 0 : ctx->last_pts + ctx->base_pts;
+  }
+
+  if (unlikely(ctx->last_pts != AV_NOPTS_VALUE && pts <= ctx->last_pts)) {
+    sirius_debgsp("Non-monotonic pts: %lld, last: %lld\n", (long long)pts,
+                  (long long)ctx->last_pts);
+    pts = ctx->last_pts + 1;
+  }
+  ctx->last_pts = pts;
+
+  return pts;
 }
 
 static force_inline void frame_pts_set(encode_ctx_s *ctx, AVFrame *dst,
                                        const pollux_frame_t *src) {
-  // if (ctx->args.custom_pts) {
-  //   dst->pts = ...;
-  // }
-
-  dst->pts = ctx->frame_index * ctx->base_pts;
+  if (ctx->args.custom_pts) {
+    dst->pts = frame_custom_pts(ctx, src);
+  } else {
+    dst->pts = ctx->frame_index * ctx->base_pts;
+  }
   ctx->frame_index++;
+  if (ctx->ring.len > 0)
+    ctx->ring.frame_pts = dst->pts;
+
+  segment_s *seg = &ctx->segment;
+  if (seg->len > 0 && dst->pts >= seg->force_pts) {
+    ctx->key_frame_flag = true;
+    seg->force_pts = (dst->pts / seg->len + 1) * seg->len;
+  }
+
+  dst->pict_type = atomic_exchange(&ctx->key_frame_flag, false)
+                     ? AV_PICTURE_TYPE_I
+                     : AV_PICTURE_TYPE_NONE;
+}
+
+static force_inline int cache_put(sirius_que_handle q, void *cache) {
+  int ret = sirius_que_put(q, (size_t)cache, sirius_timeout_none);
+  if (unlikely(ret)) {
+    sirius_error("sirius_que_put: %d, the queue is illegally occupied\n", ret);
+    return pollux_err_cache_overflow;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Hand a reference of the packet to each output, without waiting for
+ * them. A stalled output drops its packets up to the next key frame, so that
+ * it can be decoded again from there.
+ */
+static void outputs_put(encode_ctx_s *ctx, const AVPacket *pkt) {
+  for (int i = 0; i < ctx->output_count; ++i) {
+    output_s *o = ctx->outputs + i;
+    AVPacket *c = nullptr;
+
+    if (o->failed || !o->writer.is_running)
+      continue;
+    if (o->key_wait && !(pkt->flags & AV_PKT_FLAG_KEY)) {
+      o->dropped++;
+      continue;
+    }
+
+    if (sirius_que_get(o->que_free, (size_t *)&c, sirius_timeout_none) ||
+        !c) {
+      if (!o->key_wait)
+        sirius_warnsp("The output %d is stalled, the packets are dropped\n", i);
+      o->key_wait = true;
+      o->dropped++;
+      continue;
+    }
+
+    if (unlikely(av_packet_ref(c, pkt) < 0)) {
+      sirius_error("av_packet_ref\n");
+      cache_put(o->que_free, c);
+      o->key_wait = true;
+      o->dropped++;
+      continue;
+    }
+    o->key_wait = false;
+    cache_put(o->que_write, c);
+  }
 }
 
-static void thread_receive_and_write(void *args) {
+static void thread_receive(void *args) {
   encode_ctx_s *ctx = (encode_ctx_s *)args;
   ffmpeg_encode_t *e = &ctx->encode;
   thread_s *thread = &ctx->thread;
   thread_t *threadt = &thread->thread;
-  AVPacket *pkt = av_packet_alloc();
+  AVPacket *pkt = nullptr;
 
   int ret;
-  threadt->is_running = true;
-  ctx->encoder_eof_flag = false;
   while (!threadt->exit_flag) {
-    av_packet_unref(pkt);
+    if (!pkt) {
+      /**
+       * @note All the caches are queued for writing, the output is stalled.
+       */
+      ret = sirius_que_get(ctx->que_free, (size_t *)&pkt, PACKET_WAIT_MS);
+      if (ret == sirius_err_timeout) {
+        if (unlikely(!ctx->writer.is_running))
+          break;
+        continue;
+      } else if (unlikely(ret || !pkt)) {
+        sirius_error("Failed to get the packet cache\n");
+        pkt = nullptr;
+        break;
+      }
+    }
 
     sirius_mutex_lock(&ctx->mtx);
     ret = avcodec_receive_packet(e->codec_ctx, pkt);
@@ -103,7 +456,7 @@ static void thread_receive_and_write(void *args) {
       sirius_mutex_unlock(&thread->mtx);
       continue;
     } else if (unlikely(ret == AVERROR_EOF)) {
-      ctx->encoder_eof_flag = true;
+      ctx->receive_eof_flag = true;
       break;
     } else if (unlikely(ret < 0)) {
       ffmpeg_error(ret, "avcodec_receive_packet");
@@ -111,18 +464,19 @@ static void thread_receive_and_write(void *args) {
     }
 
     pkt->stream_index = e->stream->index;
+    outputs_put(ctx, pkt);
 
     sirius_debgsp("Packer pts: %lld\n", pkt->pts);
-    sirius_mutex_lock(&ctx->mtx);
-    ret = av_interleaved_write_frame(e->fmt_ctx, pkt);
-    sirius_mutex_unlock(&ctx->mtx);
-    if (unlikely(ret < 0)) {
-      ffmpeg_error(ret, "av_interleaved_write_frame");
+    if (cache_put(ctx->que_write, pkt)) {
+      av_packet_unref(pkt);
       break;
     }
+    pkt = nullptr;
   }
 
-  av_packet_free(&pkt);
+  if (pkt)
+    cache_put(ctx->que_free, pkt);
+
   sirius_infosp("Encoding thread has exited\n");
   threadt->is_running = false;
   sirius_mutex_lock(&thread->mtx);
@@ -130,97 +484,889 @@ static void thread_receive_and_write(void *args) {
   sirius_mutex_unlock(&thread->mtx);
 }
 
-static inline void encoder_ffmpeg_deinit(encode_ctx_s *ctx) {
-  ffmpeg_encode_t *e = &ctx->encode;
-
-  ffmpeg_encoder_ctx_free(e);
-  ffmpeg_encoder_deinit(e);
+/**
+ * @brief Format the url of a segment into a buffer of `SEGMENT_URL_MAX`.
+ */
+static void segment_url(const segment_s *seg, int index, char *url) {
+  snprintf(url, SEGMENT_URL_MAX, seg->zero ? "%s%0*d%s" : "%s%*d%s",
+           seg->prefix, seg->width, index, seg->suffix);
 }
 
-static inline bool encoder_ffmpeg_init(encode_ctx_s *ctx, const char *url,
-                                       const char *cont_fmt,
-                                       const pollux_encode_args_t *args) {
-  ffmpeg_encode_t *e = &ctx->encode;
-  ffmpeg_encode_args_t ep = {0};
-  const pollux_img_t img = args->img;
-  enum AVCodecID id;
+/**
+ * @brief Split the url of `segment_seconds` at its integer conversion, e.g.
+ * "%d" or "%05d", which must be the only one. "%%" is unescaped.
+ */
+static bool segment_url_parse(segment_s *seg, const char *url) {
+  char *dst = seg->prefix;
+  int count = 0, i = 0;
 
-  if (ffmpeg_encoder_init(e, url, cont_fmt))
-    return false;
+  for (const char *p = url; *p; ++p) {
+    if (*p != '%' || *++p == '%') {
+      dst[i++] = *p;
+      continue;
+    }
+    if (count++ > 0)
+      return false;
+
+    seg->zero = *p == '0';
+    seg->width = 0;
+    while (isdigit((unsigned char)*p)) {
+      seg->width = seg->width * 10 + *p++ - '0';
+      if (seg->width > SEGMENT_WIDTH_MAX)
+        return false;
+    }
+    if (*p != 'd')
+      return false;
 
-  ep.bit_rate = args->bit_rate;
-  ep.width = img.width;
-  ep.height = img.height;
-  ep.frame_rate.num = args->frame_rate.num;
-  ep.frame_rate.den = args->frame_rate.den;
-  ep.gop_size = args->gop_size;
-  ep.max_b_frames = args->max_b_frames;
-  ep.thread_count = args->thread_count;
+    dst[i] = '\0';
+    dst = seg->suffix;
+    i = 0;
+  }
+  dst[i] = '\0';
 
-  if (!cvt_pix_plx_to_ff(img.fmt, &ep.pix_fmt) ||
-      !cvt_codec_id_plx_to_ff(args->codec_id, &id) ||
-      ffmpeg_encoder_ctx_alloc(e, &ep, id)) {
-    goto label_free1;
+  return count == 1;
+}
+
+/**
+ * @brief Rewrite the playlist, through a temporary file so that a reader never
+ * sees a partial one.
+ *
+ * @return `pollux_err_t`.
+ */
+static int playlist_write(const segment_s *seg, bool end) {
+  char tmp[URL_MAX + 8];
+  char url[SEGMENT_URL_MAX];
+  double max_duration = 0;
+  FILE *fp;
+
+  if (!seg->playlist[0])
+    return 0;
+
+  snprintf(tmp, sizeof(tmp), "%s.tmp", seg->playlist);
+  if (!(fp = fopen(tmp, "w"))) {
+    sirius_error("Failed to open the playlist: %s\n", tmp);
+    return pollux_err_file_open;
   }
 
-  return true;
+  for (int i = 0; i < seg->count; ++i)
+    max_duration = sirius_max(max_duration, seg->durations[i]);
+  int target = (int)max_duration;
+  target += target < max_duration;
+
+  fprintf(fp,
+          "#EXTM3U\n"
+          "#EXT-X-VERSION:3\n"
+          "#EXT-X-TARGETDURATION:%d\n"
+          "#EXT-X-MEDIA-SEQUENCE:0\n",
+          target);
+  for (int i = 0; i < seg->count; ++i) {
+    segment_url(seg, i, url);
+    const char *name = strrchr(url, '/');
+    fprintf(fp, "#EXTINF:%.3f,\n%s\n", seg->durations[i],
+            name ? name + 1 : url);
+  }
+  if (end)
+    fprintf(fp, "#EXT-X-ENDLIST\n");
 
-label_free1:
-  ffmpeg_encoder_deinit(e);
+  if (fclose(fp) || rename(tmp, seg->playlist)) {
+    sirius_error("Failed to write the playlist: %s\n", seg->playlist);
+    return pollux_err_file_write;
+  }
 
-  return false;
+  return 0;
 }
 
-static inline void ffmpeg_resource_free(encode_ctx_s *ctx) {
-  AVFrame **f = &ctx->av_frame;
-  if (*f)
-    av_frame_free(f);
-}
+/**
+ * @brief Write the tail of the current segment and close it, then add it to
+ * the playlist.
+ *
+ * @return `pollux_err_t`.
+ */
+static int segment_close(encode_ctx_s *ctx, bool end) {
+  int ret;
+  segment_s *seg = &ctx->segment;
+  ffmpeg_encode_t *e = &ctx->encode;
+  AVFormatContext *fc = seg->fmt_ctx;
 
-static inline bool ffmpeg_resource_alloc(encode_ctx_s *ctx) {
-  AVFrame **f = &ctx->av_frame;
-  *f = av_frame_alloc();
-  if (!*f) {
-    sirius_error("av_frame_alloc\n");
-    return false;
+  if (!fc)
+    return 0;
+  seg->fmt_ctx = nullptr;
+
+  ret = av_write_trailer(fc);
+  if (ret != 0)
+    ffmpeg_error(ret, "av_write_trailer");
+
+  if (fc == e->fmt_ctx) {
+    if (fc->pb && !(fc->oformat->flags & AVFMT_NOFILE))
+      avio_closep(&fc->pb);
+  } else {
+    ffmpeg_encoder_deinit(&(ffmpeg_encode_t) {.fmt_ctx = fc});
   }
+  if (ret != 0)
+    return pollux_err_file_write;
 
-  return true;
+  if (seg->count == seg->cap) {
+    int cap = seg->cap ? seg->cap * 2 : 64;
+    double *p = (double *)realloc(seg->durations, sizeof(double) * cap);
+    if (!p) {
+      sirius_error("realloc -> 'durations'\n");
+      return pollux_err_memory_alloc;
+    }
+    seg->durations = p;
+    seg->cap = cap;
+  }
+  seg->durations[seg->count++] =
+    (double)(seg->last_pts - seg->start_pts) * av_q2d(e->stream->time_base);
+
+  return playlist_write(seg, end);
 }
 
-static inline void sig_resource_free(encode_ctx_s *ctx) {
-  thread_s *thread = &ctx->thread;
+/**
+ * @brief Open an output with a copy of the stream of the encoder, and write
+ * its header. The encoder is not touched.
+ *
+ * @return `pollux_err_t`.
+ */
+static int output_open(encode_ctx_s *ctx, const char *url,
+                       const char *cont_fmt, AVFormatContext **fc) {
+  int ret;
+  ffmpeg_encode_t *e = &ctx->encode;
+  ffmpeg_encode_t out = {0};
+  AVStream *st;
 
-  sirius_cond_destroy(&thread->cond);
-  sirius_mutex_destroy(&thread->mtx);
-}
+  if ((ret = ffmpeg_encoder_init(&out, url, cont_fmt)) != 0)
+    return ret;
 
-static inline bool sig_resource_alloc(encode_ctx_s *ctx) {
-  thread_s *thread = &ctx->thread;
+  if (!(st = avformat_new_stream(out.fmt_ctx, nullptr))) {
+    sirius_error("avformat_new_stream\n");
+    ret = pollux_err_resource_alloc;
+    goto label_free;
+  }
+  if ((ret = avcodec_parameters_copy(st->codecpar, e->stream->codecpar)) < 0) {
+    ffmpeg_error(ret, "avcodec_parameters_copy");
+    ret = pollux_err_resource_alloc;
+    goto label_free;
+  }
+  st->time_base = e->stream->time_base;
 
-  if (sirius_mutex_init(&thread->mtx, nullptr))
-    return false;
-  if (sirius_cond_init(&thread->cond, nullptr))
-    goto label_free1;
+  if ((ret = avformat_write_header(out.fmt_ctx, nullptr)) < 0) {
+    ffmpeg_error(ret, "avformat_write_header");
+    ret = pollux_err_file_write;
+    goto label_free;
+  }
 
-  return true;
+  *fc = out.fmt_ctx;
 
-label_free1:
-  sirius_mutex_destroy(&thread->mtx);
+  return 0;
 
-  return false;
+label_free:
+  ffmpeg_encoder_deinit(&out);
+
+  return ret;
 }
 
-static inline void encoder_resource_free(encode_ctx_s *ctx) {
-  sirius_mutex_destroy(&ctx->mtx);
-  sig_resource_free(ctx);
-  ffmpeg_resource_free(ctx);
+/**
+ * @brief Open the output of the next segment, with the stream of the first
+ * one.
+ *
+ * @return `pollux_err_t`.
+ */
+static int segment_open(encode_ctx_s *ctx) {
+  segment_s *seg = &ctx->segment;
+  char url[SEGMENT_URL_MAX];
+
+  segment_url(seg, seg->index, url);
+  return output_open(ctx, url, ctx->encode.fmt_ctx->oformat->name,
+                     &seg->fmt_ctx);
 }
 
-static inline bool encoder_resource_alloc(encode_ctx_s *ctx) {
-  if (!ffmpeg_resource_alloc(ctx))
-    return false;
-  if (!sig_resource_alloc(ctx))
+/**
+ * @brief Rotate the output on the first key frame of the next segment.
+ *
+ * @return `pollux_err_t`.
+ */
+static int segment_update(encode_ctx_s *ctx, const AVPacket *pkt) {
+  int ret;
+  segment_s *seg = &ctx->segment;
+
+  if ((pkt->flags & AV_PKT_FLAG_KEY) && pkt->pts >= seg->end_pts) {
+    if ((ret = segment_close(ctx, false)) != 0)
+      return ret;
+
+    seg->index++;
+    if ((ret = segment_open(ctx)) != 0)
+      return ret;
+
+    sirius_debgsp("Segment %d starts at pts: %lld\n", seg->index,
+                  (long long)pkt->pts);
+    seg->start_pts = pkt->pts;
+    seg->end_pts = (pkt->pts / seg->len + 1) * seg->len;
+  }
+
+  int64_t end =
+    pkt->pts + (pkt->duration > 0 ? pkt->duration : ctx->base_pts);
+  seg->last_pts = sirius_max(seg->last_pts, end);
+
+  return 0;
+}
+
+static force_inline AVPacket *ring_at(const ring_s *ring, int i) {
+  return ring->pkts[(ring->head + i) % ring->cap];
+}
+
+/**
+ * @brief Drop the oldest GOPs, as long as the rest still covers the length of
+ * the ring before `pts`.
+ */
+static void ring_trim(ring_s *ring, int64_t pts) {
+  while (ring->count > 0) {
+    int next = 1;
+    while (next < ring->count &&
+           !(ring_at(ring, next)->flags & AV_PKT_FLAG_KEY)) {
+      next++;
+    }
+    if (next == ring->count || pts - ring_at(ring, next)->pts < ring->len)
+      break;
+
+    for (int i = 0; i < next; ++i)
+      av_packet_unref(ring_at(ring, i));
+    ring->head = (ring->head + next) % ring->cap;
+    ring->count -= next;
+  }
+}
+
+/**
+ * @brief Keep a reference of the packet, the oldest GOPs are dropped on each
+ * key frame.
+ *
+ * @return `pollux_err_t`.
+ */
+static int ring_push(ring_s *ring, const AVPacket *pkt) {
+  int ret;
+
+  if (pkt->flags & AV_PKT_FLAG_KEY)
+    ring_trim(ring, pkt->pts);
+
+  if (ring->count == ring->cap) {
+    int cap = ring->cap ? ring->cap * 2 : 256;
+    AVPacket **p = (AVPacket **)calloc(cap, sizeof(AVPacket *));
+    if (!p) {
+      sirius_error("calloc -> 'AVPacket *'\n");
+      return pollux_err_memory_alloc;
+    }
+    for (int i = 0; i < ring->count; ++i)
+      p[i] = ring_at(ring, i);
+
+    free(ring->pkts);
+    ring->pkts = p;
+    ring->cap = cap;
+    ring->head = 0;
+  }
+
+  AVPacket **slot = ring->pkts + (ring->head + ring->count) % ring->cap;
+  if (!*slot && !(*slot = av_packet_alloc())) {
+    sirius_error("av_packet_alloc failed\n");
+    return pollux_err_memory_alloc;
+  }
+  if ((ret = av_packet_ref(*slot, pkt)) < 0) {
+    ffmpeg_error(ret, "av_packet_ref");
+    return pollux_err_memory_alloc;
+  }
+  ring->count++;
+
+  return 0;
+}
+
+/**
+ * @brief Write a reference of the packet to the event.
+ *
+ * @return `pollux_err_t`.
+ */
+static int event_write(encode_ctx_s *ctx, const AVPacket *pkt) {
+  int ret;
+  ring_s *ring = &ctx->ring;
+  AVFormatContext *fc = ctx->segment.fmt_ctx;
+  AVPacket *tmp = ring->tmp;
+
+  if ((ret = av_packet_ref(tmp, pkt)) < 0) {
+    ffmpeg_error(ret, "av_packet_ref");
+    return pollux_err_memory_alloc;
+  }
+
+  if (tmp->pts != AV_NOPTS_VALUE)
+    tmp->pts -= ring->offset;
+  if (tmp->dts != AV_NOPTS_VALUE)
+    tmp->dts -= ring->offset;
+  av_packet_rescale_ts(tmp, ctx->encode.stream->time_base,
+                       fc->streams[0]->time_base);
+
+  ret = av_interleaved_write_frame(fc, tmp);
+  av_packet_unref(tmp);
+  if (unlikely(ret < 0)) {
+    ffmpeg_error(ret, "av_interleaved_write_frame");
+    return pollux_err_file_write;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Open the file of a new event, and write the packets of the ring.
+ *
+ * @return `pollux_err_t`.
+ */
+static int event_open(encode_ctx_s *ctx, const AVPacket *pkt) {
+  int ret;
+  ring_s *ring = &ctx->ring;
+
+  if (!ring->tmp && !(ring->tmp = av_packet_alloc())) {
+    sirius_error("av_packet_alloc failed\n");
+    return pollux_err_memory_alloc;
+  }
+
+  if ((ret = segment_open(ctx)) != 0)
+    return ret;
+  ring->recording = true;
+
+  const AVPacket *first = ring->count > 0 ? ring_at(ring, 0) : pkt;
+  ring->offset = first->dts != AV_NOPTS_VALUE ? first->dts : first->pts;
+
+  sirius_infosp("Event %d starts with %d packets in memory\n",
+                ctx->segment.index, ring->count);
+  for (int i = 0; i < ring->count; ++i) {
+    if ((ret = event_write(ctx, ring_at(ring, i))) != 0)
+      return ret;
+  }
+
+  return 0;
+}
+
+/**
+ * @return `pollux_err_t`.
+ */
+static int event_close(encode_ctx_s *ctx) {
+  int ret;
+  segment_s *seg = &ctx->segment;
+  AVFormatContext *fc = seg->fmt_ctx;
+
+  seg->fmt_ctx = nullptr;
+  seg->index++;
+  ctx->ring.recording = false;
+
+  ret = av_write_trailer(fc);
+  if (ret != 0)
+    ffmpeg_error(ret, "av_write_trailer");
+  ffmpeg_encoder_deinit(&(ffmpeg_encode_t) {.fmt_ctx = fc});
+
+  return ret != 0 ? pollux_err_file_write : 0;
+}
+
+/**
+ * @brief Keep the packet in the ring, and write it to the event if there is
+ * one, which is started or extended by a pending trigger.
+ *
+ * @return `pollux_err_t`.
+ */
+static int ring_write(encode_ctx_s *ctx, const AVPacket *pkt) {
+  int ret;
+  ring_s *ring = &ctx->ring;
+
+  int64_t end = atomic_exchange(&ring->trigger, AV_NOPTS_VALUE);
+  if (ring->recording) {
+    if (end != AV_NOPTS_VALUE) {
+      ring->end_pts = sirius_max(ring->end_pts, end);
+      end = AV_NOPTS_VALUE;
+    }
+    if (pkt->pts >= ring->end_pts && (ret = event_close(ctx)) != 0)
+      return ret;
+  }
+  if (end != AV_NOPTS_VALUE) {
+    ring->end_pts = end;
+    if ((ret = event_open(ctx, pkt)) != 0)
+      return ret;
+  }
+
+  if ((ret = ring_push(ring, pkt)) != 0)
+    return ret;
+
+  return ring->recording ? event_write(ctx, pkt) : 0;
+}
+
+/**
+ * @return `pollux_err_t`.
+ */
+static int packet_write(encode_ctx_s *ctx, AVPacket *pkt) {
+  int ret;
+  ffmpeg_encode_t *e = &ctx->encode;
+  AVFormatContext *fc = e->fmt_ctx;
+  segment_s *seg = &ctx->segment;
+
+  if (ctx->ring.len > 0)
+    return ring_write(ctx, pkt);
+
+  if (seg->len > 0) {
+    if ((ret = segment_update(ctx, pkt)) != 0)
+      return ret;
+
+    fc = seg->fmt_ctx;
+    av_packet_rescale_ts(pkt, e->stream->time_base, fc->streams[0]->time_base);
+  }
+
+  ret = av_interleaved_write_frame(fc, pkt);
+  if (unlikely(ret < 0)) {
+    ffmpeg_error(ret, "av_interleaved_write_frame");
+    return pollux_err_file_write;
+  }
+
+  return 0;
+}
+
+static void thread_write(void *args) {
+  encode_ctx_s *ctx = (encode_ctx_s *)args;
+  thread_t *threadt = &ctx->writer;
+
+  int ret;
+  while (!threadt->exit_flag) {
+    AVPacket *pkt = nullptr;
+
+    /**
+     * @note Once the encoding thread has exited, all of its packets are in the
+     * queue, which is drained without waiting.
+     */
+    bool receiving = ctx->thread.thread.is_running;
+    ret = sirius_que_get(ctx->que_write, (size_t *)&pkt,
+                         receiving ? PACKET_WAIT_MS : sirius_timeout_none);
+    if (ret == sirius_err_timeout) {
+      if (!receiving) {
+        ctx->encoder_eof_flag = ctx->receive_eof_flag;
+        break;
+      }
+      continue;
+    } else if (unlikely(ret || !pkt)) {
+      sirius_error("Failed to get the packet to write\n");
+      break;
+    }
+
+    ret = packet_write(ctx, pkt);
+    av_packet_unref(pkt);
+    cache_put(ctx->que_free, pkt);
+    if (unlikely(ret))
+      break;
+  }
+
+  sirius_infosp("Writing thread has exited\n");
+  threadt->is_running = false;
+}
+
+/**
+ * @return `pollux_err_t`.
+ */
+static int output_write(output_s *o, AVPacket *pkt) {
+  int ret;
+
+  if (o->sink_cb) {
+    pollux_packet_t p = {0};
+
+    p.priv_data = (void *)pkt;
+    p.data = pkt->data;
+    p.size = pkt->size;
+    p.pts = pkt->pts;
+    p.dts = pkt->dts;
+    p.duration = pkt->duration;
+    p.time_base.num = o->time_base.num;
+    p.time_base.den = o->time_base.den;
+    p.flags = pkt->flags & AV_PKT_FLAG_KEY ? POLLUX_PACKET_FLAG_KEY : 0;
+    o->sink_cb(&p, o->opaque);
+
+    return 0;
+  }
+
+  av_packet_rescale_ts(pkt, o->time_base, o->fmt_ctx->streams[0]->time_base);
+  ret = av_interleaved_write_frame(o->fmt_ctx, pkt);
+  if (unlikely(ret < 0)) {
+    ffmpeg_error(ret, "av_interleaved_write_frame");
+    return pollux_err_file_write;
+  }
+
+  return 0;
+}
+
+/**
+ * @note Once `exit_flag` is set, the queued packets are written without
+ * waiting for more, see `thread_stop`.
+ */
+static void thread_output(void *args) {
+  output_s *o = (output_s *)args;
+  thread_t *threadt = &o->writer;
+
+  int ret;
+  while (true) {
+    AVPacket *pkt = nullptr;
+
+    bool exiting = threadt->exit_flag;
+    ret = sirius_que_get(o->que_write, (size_t *)&pkt,
+                         exiting ? sirius_timeout_none : PACKET_WAIT_MS);
+    if (ret == sirius_err_timeout) {
+      if (exiting)
+        break;
+      continue;
+    } else if (unlikely(ret || !pkt)) {
+      sirius_error("Failed to get the packet to write\n");
+      o->failed = true;
+      break;
+    }
+
+    ret = output_write(o, pkt);
+    av_packet_unref(pkt);
+    cache_put(o->que_free, pkt);
+    if (unlikely(ret)) {
+      sirius_error("Failed to write the output, which is closed: %s\n",
+                   o->sink_cb ? "sink" : o->url);
+      o->failed = true;
+      break;
+    }
+  }
+
+  sirius_infosp("Output thread has exited\n");
+  threadt->is_running = false;
+}
+
+static inline void encoder_ffmpeg_deinit(encode_ctx_s *ctx) {
+  ffmpeg_encode_t *e = &ctx->encode;
+
+  ffmpeg_encoder_ctx_free(e);
+  ffmpeg_encoder_deinit(e);
+}
+
+static inline bool encoder_ffmpeg_init(encode_ctx_s *ctx, const char *url,
+                                       const char *cont_fmt,
+                                       const pollux_encode_args_t *args) {
+  ffmpeg_encode_t *e = &ctx->encode;
+  ffmpeg_encode_args_t ep = {0};
+  const pollux_img_t img = args->img;
+  enum AVCodecID id;
+
+  /**
+   * @note With `ring_seconds`, the output is only used for its stream, the
+   * events are written to their own files.
+   */
+  if (args->ring_seconds > 0 ? ffmpeg_encoder_alloc(e, url, cont_fmt)
+                             : ffmpeg_encoder_init(e, url, cont_fmt)) {
+    return false;
+  }
+
+  ep.bit_rate = args->bit_rate;
+  ep.width = img.width;
+  ep.height = img.height;
+  ep.frame_rate.num = args->frame_rate.num;
+  ep.frame_rate.den = args->frame_rate.den;
+  ep.gop_size = args->gop_size;
+  ep.max_b_frames = args->max_b_frames;
+  ep.thread_count = args->thread_count;
+
+  if (!cvt_pix_plx_to_ff(img.fmt, &ep.pix_fmt) ||
+      !cvt_codec_id_plx_to_ff(args->codec_id, &id) ||
+      ffmpeg_encoder_ctx_alloc(e, &ep, id)) {
+    goto label_free1;
+  }
+
+  return true;
+
+label_free1:
+  ffmpeg_encoder_deinit(e);
+
+  return false;
+}
+
+static void packet_cache_free(encode_ctx_s *ctx) {
+  for (int i = 0; i < ctx->packet_count; ++i)
+    av_packet_free(ctx->packets + i);
+  ctx->packet_count = 0;
+
+  sirius_que_handle *q[] = {&ctx->que_free, &ctx->que_write};
+  for (size_t i = 0; i < sizeof(q) / sizeof(q[0]); ++i) {
+    if (*q[i]) {
+      if (sirius_que_free(*q[i])) {
+        sirius_error("sirius_que_free\n");
+      } else {
+        *q[i] = nullptr;
+      }
+    }
+  }
+}
+
+static bool packet_cache_alloc(encode_ctx_s *ctx, int cache_count) {
+  int count = cache_count > 0 ? cache_count : PACKET_CACHE_DEFAULT;
+  count = sirius_min(count, PACKET_CACHE_MAX);
+
+  sirius_que_t c = {.elem_nr = count, .que_type = sirius_que_type_mtx};
+  if (sirius_que_alloc(&c, &ctx->que_free) ||
+      sirius_que_alloc(&c, &ctx->que_write)) {
+    sirius_error("sirius_que_alloc\n");
+    goto label_free;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    AVPacket *pkt = av_packet_alloc();
+    if (!pkt) {
+      sirius_error("av_packet_alloc failed\n");
+      goto label_free;
+    }
+    ctx->packets[ctx->packet_count++] = pkt;
+
+    if (cache_put(ctx->que_free, pkt))
+      goto label_free;
+  }
+
+  return true;
+
+label_free:
+  packet_cache_free(ctx);
+
+  return false;
+}
+
+static void frame_queue_free(encode_ctx_s *ctx) {
+  if (ctx->feed_frame)
+    av_frame_free(&ctx->feed_frame);
+  if (ctx->items) {
+    free(ctx->items);
+    ctx->items = nullptr;
+  }
+  ctx->item_count = 0;
+
+  sirius_que_handle *q[] = {&ctx->que_item_free, &ctx->que_feed};
+  for (size_t i = 0; i < sizeof(q) / sizeof(q[0]); ++i) {
+    if (*q[i]) {
+      if (sirius_que_free(*q[i])) {
+        sirius_error("sirius_que_free\n");
+      } else {
+        *q[i] = nullptr;
+      }
+    }
+  }
+}
+
+static bool frame_queue_alloc(encode_ctx_s *ctx, int queue_count) {
+  int count = queue_count > 0 ? queue_count : FRAME_QUEUE_DEFAULT;
+  count = sirius_min(count, FRAME_QUEUE_MAX);
+
+  sirius_que_t c = {.elem_nr = count, .que_type = sirius_que_type_mtx};
+  if (sirius_que_alloc(&c, &ctx->que_item_free) ||
+      sirius_que_alloc(&c, &ctx->que_feed)) {
+    sirius_error("sirius_que_alloc\n");
+    goto label_free;
+  }
+
+  ctx->feed_frame = av_frame_alloc();
+  if (!ctx->feed_frame) {
+    sirius_error("av_frame_alloc\n");
+    goto label_free;
+  }
+
+  ctx->items = (frame_item_s *)calloc(count, sizeof(frame_item_s));
+  if (!ctx->items) {
+    sirius_error("calloc -> 'frame_item_s'\n");
+    goto label_free;
+  }
+  ctx->item_count = count;
+
+  for (int i = 0; i < count; ++i) {
+    if (cache_put(ctx->que_item_free, ctx->items + i))
+      goto label_free;
+  }
+
+  return true;
+
+label_free:
+  frame_queue_free(ctx);
+
+  return false;
+}
+
+static void input_pool_free(encode_ctx_s *ctx) {
+  if (ctx->inputs) {
+    for (int i = 0; i < ctx->input_count; ++i) {
+      AVFrame **f = &ctx->inputs[i].priv.av_frame;
+      if (*f)
+        av_frame_free(f);
+    }
+    free(ctx->inputs);
+    ctx->inputs = nullptr;
+  }
+  ctx->input_count = 0;
+
+  if (ctx->que_input_free) {
+    if (sirius_que_free(ctx->que_input_free)) {
+      sirius_error("sirius_que_free\n");
+    } else {
+      ctx->que_input_free = nullptr;
+    }
+  }
+
+  /**
+   * @note The pool is freed once the encoder has released all its buffers.
+   */
+  av_buffer_pool_uninit(&ctx->buf_pool);
+}
+
+static bool input_pool_alloc(encode_ctx_s *ctx) {
+  const pollux_encode_args_t *args = &ctx->args;
+  const pollux_img_t *img = &args->img;
+  enum AVPixelFormat fmt;
+
+  int count =
+    args->input_frame_count > 0 ? args->input_frame_count : INPUT_FRAME_DEFAULT;
+  count = sirius_min(count, INPUT_FRAME_MAX);
+  ctx->buf_align = img->align > 0 ? img->align : INPUT_FRAME_ALIGN;
+
+  if (!cvt_pix_plx_to_ff(img->fmt, &fmt))
+    return false;
+  int size =
+    av_image_get_buffer_size(fmt, img->width, img->height, ctx->buf_align);
+  if (size < 0) {
+    ffmpeg_error(size, "av_image_get_buffer_size");
+    return false;
+  }
+
+  ctx->buf_pool = av_buffer_pool_init(size, av_buffer_alloc);
+  if (!ctx->buf_pool) {
+    sirius_error("av_buffer_pool_init\n");
+    return false;
+  }
+
+  sirius_que_t c = {.elem_nr = count, .que_type = sirius_que_type_mtx};
+  if (sirius_que_alloc(&c, &ctx->que_input_free)) {
+    sirius_error("sirius_que_alloc\n");
+    goto label_free;
+  }
+
+  ctx->inputs = (input_frame_s *)calloc(count, sizeof(input_frame_s));
+  if (!ctx->inputs) {
+    sirius_error("calloc -> 'input_frame_s'\n");
+    goto label_free;
+  }
+  ctx->input_count = count;
+
+  for (int i = 0; i < count; ++i) {
+    input_frame_s *in = ctx->inputs + i;
+
+    in->priv.av_frame = av_frame_alloc();
+    if (!in->priv.av_frame) {
+      sirius_error("av_frame_alloc\n");
+      goto label_free;
+    }
+    in->frame.priv_data = (void *)&in->priv;
+
+    if (cache_put(ctx->que_input_free, in))
+      goto label_free;
+  }
+
+  return true;
+
+label_free:
+  input_pool_free(ctx);
+
+  return false;
+}
+
+static void scaler_free(encode_ctx_s *ctx) {
+  scaler_s *sc = &ctx->scaler;
+
+  if (sc->sws_ctx)
+    sws_freeContext(sc->sws_ctx);
+  if (sc->src)
+    av_frame_free(&sc->src);
+  memset(sc, 0, sizeof(scaler_s));
+}
+
+static bool scaler_alloc(encode_ctx_s *ctx) {
+  scaler_s *sc = &ctx->scaler;
+
+  memset(sc, 0, sizeof(scaler_s));
+  sc->src = av_frame_alloc();
+  if (!sc->src) {
+    sirius_error("av_frame_alloc\n");
+    return false;
+  }
+
+  return true;
+}
+
+static inline void ffmpeg_resource_free(encode_ctx_s *ctx) {
+  AVFrame **f = &ctx->av_frame;
+  if (*f)
+    av_frame_free(f);
+  packet_cache_free(ctx);
+  frame_queue_free(ctx);
+  input_pool_free(ctx);
+  scaler_free(ctx);
+}
+
+static inline bool ffmpeg_resource_alloc(encode_ctx_s *ctx) {
+  AVFrame **f = &ctx->av_frame;
+  *f = av_frame_alloc();
+  if (!*f) {
+    sirius_error("av_frame_alloc\n");
+    return false;
+  }
+
+  if (!packet_cache_alloc(ctx, ctx->args.packet_cache_count))
+    goto label_free1;
+  if (!frame_queue_alloc(ctx, ctx->args.frame_queue_count))
+    goto label_free2;
+  if (!input_pool_alloc(ctx))
+    goto label_free3;
+  if (!scaler_alloc(ctx))
+    goto label_free4;
+
+  return true;
+
+label_free4:
+  input_pool_free(ctx);
+label_free3:
+  frame_queue_free(ctx);
+label_free2:
+  packet_cache_free(ctx);
+label_free1:
+  av_frame_free(f);
+
+  return false;
+}
+
+static inline void sig_resource_free(encode_ctx_s *ctx) {
+  thread_s *thread = &ctx->thread;
+
+  sirius_cond_destroy(&thread->cond);
+  sirius_mutex_destroy(&thread->mtx);
+}
+
+static inline bool sig_resource_alloc(encode_ctx_s *ctx) {
+  thread_s *thread = &ctx->thread;
+
+  if (sirius_mutex_init(&thread->mtx, nullptr))
+    return false;
+  if (sirius_cond_init(&thread->cond, nullptr))
+    goto label_free1;
+
+  return true;
+
+label_free1:
+  sirius_mutex_destroy(&thread->mtx);
+
+  return false;
+}
+
+static inline void encoder_resource_free(encode_ctx_s *ctx) {
+  sirius_mutex_destroy(&ctx->mtx);
+  sig_resource_free(ctx);
+  ffmpeg_resource_free(ctx);
+}
+
+static inline bool encoder_resource_alloc(encode_ctx_s *ctx) {
+  if (!ffmpeg_resource_alloc(ctx))
+    return false;
+  if (!sig_resource_alloc(ctx))
     goto label_free1;
   if (sirius_mutex_init(&ctx->mtx, nullptr))
     goto label_free2;
@@ -235,16 +1381,150 @@ label_free1:
   return false;
 }
 
+static void segment_free(encode_ctx_s *ctx) {
+  segment_s *seg = &ctx->segment;
+
+  /**
+   * @note The segment left by a failure is not finished.
+   */
+  if (seg->fmt_ctx && seg->fmt_ctx != ctx->encode.fmt_ctx)
+    ffmpeg_encoder_deinit(&(ffmpeg_encode_t) {.fmt_ctx = seg->fmt_ctx});
+  if (seg->durations)
+    free(seg->durations);
+  memset(seg, 0, sizeof(segment_s));
+}
+
+/**
+ * @param[out] first A buffer of `SEGMENT_URL_MAX`.
+ *
+ * @return The url of the first segment, or the url itself when the output is
+ * not segmented. nullptr on failure.
+ */
+static const char *segment_init(encode_ctx_s *ctx, const char *url,
+                                const pollux_encode_args_t *args,
+                                char *first) {
+  segment_s *seg = &ctx->segment;
+
+  memset(seg, 0, sizeof(segment_s));
+  if (args->segment_seconds <= 0 && args->ring_seconds <= 0)
+    return url;
+
+  if (args->segment_seconds > 0 && args->ring_seconds > 0) {
+    sirius_error("The segments cannot be used with the ring\n");
+    return nullptr;
+  }
+
+  /**
+   * @note The playlist is a version 3 one, without `EXT-X-MAP`, which is only
+   * valid for the segments of `mpegts`.
+   */
+  if (args->segment_seconds > 0 && args->cont_fmt != pollux_cont_fmt_mpegts) {
+    sirius_error("The segments must be mpegts\n");
+    return nullptr;
+  }
+
+  if (strlen(url) >= URL_MAX || !segment_url_parse(seg, url)) {
+    sirius_error("Invalid url of the segments: %s\n", url);
+    return nullptr;
+  }
+  if (args->playlist_url &&
+      strlen(args->playlist_url) >= sizeof(seg->playlist)) {
+    sirius_error("Invalid url of the playlist: %s\n", args->playlist_url);
+    return nullptr;
+  }
+
+  if (args->playlist_url)
+    strcpy(seg->playlist, args->playlist_url);
+  segment_url(seg, 0, first);
+
+  return first;
+}
+
+/**
+ * @note The `segment_start` function must be called after the
+ * `encoder_pts_init` function.
+ */
+static void segment_start(encode_ctx_s *ctx) {
+  segment_s *seg = &ctx->segment;
+  AVRational r = ctx->encode.stream->time_base;
+
+  if (ctx->args.segment_seconds <= 0)
+    return;
+
+  seg->len = av_rescale(ctx->args.segment_seconds, r.den, r.num);
+  seg->force_pts = seg->len;
+  seg->index = 0;
+  seg->fmt_ctx = ctx->encode.fmt_ctx;
+  seg->start_pts = 0;
+  seg->end_pts = seg->len;
+  seg->last_pts = 0;
+  seg->count = 0;
+}
+
+static void ring_free(encode_ctx_s *ctx) {
+  ring_s *ring = &ctx->ring;
+
+  for (int i = 0; i < ring->cap; ++i) {
+    if (ring->pkts[i])
+      av_packet_free(ring->pkts + i);
+  }
+  if (ring->pkts)
+    free(ring->pkts);
+  if (ring->tmp)
+    av_packet_free(&ring->tmp);
+  memset(ring, 0, sizeof(ring_s));
+  ring->trigger = AV_NOPTS_VALUE;
+  ring->frame_pts = AV_NOPTS_VALUE;
+}
+
+/**
+ * @note The `ring_start` function must be called after the `encoder_pts_init`
+ * function.
+ */
+static void ring_start(encode_ctx_s *ctx) {
+  ring_s *ring = &ctx->ring;
+  AVRational r = ctx->encode.stream->time_base;
+
+  ring->trigger = AV_NOPTS_VALUE;
+  ring->frame_pts = AV_NOPTS_VALUE;
+  if (ctx->args.ring_seconds <= 0)
+    return;
+
+  ring->len = av_rescale(ctx->args.ring_seconds, r.den, r.num);
+  ring->recording = false;
+  for (int i = 0; i < ring->count; ++i)
+    av_packet_unref(ring_at(ring, i));
+  ring->head = 0;
+  ring->count = 0;
+}
+
+/**
+ * @note The outputs are closed by `encoder_receive_thread_stop`.
+ */
+static void outputs_clear(encode_ctx_s *ctx) {
+  memset(ctx->outputs, 0, sizeof(ctx->outputs));
+  ctx->output_count = 0;
+}
+
 static inline void encoder_deinit(encode_ctx_s *ctx) {
+  outputs_clear(ctx);
   encoder_resource_free(ctx);
+  ring_free(ctx);
+  segment_free(ctx);
   encoder_ffmpeg_deinit(ctx);
 }
 
 static inline bool encoder_init(encode_ctx_s *ctx, const char *url,
                                 const pollux_encode_args_t *args) {
   pollux_encode_args_t *eargs = &ctx->args;
+  char first[SEGMENT_URL_MAX];
 
   memcpy(eargs, args, sizeof(pollux_encode_args_t));
+  eargs->playlist_url = nullptr;
+  ring_free(ctx);
+
+  if (!(url = segment_init(ctx, url, args, first)))
+    return false;
 
   if (!encoder_ffmpeg_init(ctx, url, pollux_cont_enum_to_string(args->cont_fmt),
                            eargs))
@@ -260,79 +1540,435 @@ label_free1:
   return false;
 }
 
-static inline int send_frame(encode_ctx_s *ctx, AVFrame *f) {
-  int ret;
-  ffmpeg_encode_t *e = &ctx->encode;
-  thread_s *thread = &ctx->thread;
-  thread_t *threadt = &thread->thread;
+static inline int send_frame(encode_ctx_s *ctx, AVFrame *f) {
+  int ret;
+  ffmpeg_encode_t *e = &ctx->encode;
+  thread_s *thread = &ctx->thread;
+  thread_t *threadt = &thread->thread;
+
+  while (true) {
+    if (unlikely(!threadt->is_running))
+      return pollux_err_not_init;
+
+    sirius_mutex_lock(&ctx->mtx);
+    ret = avcodec_send_frame(e->codec_ctx, f);
+    sirius_mutex_unlock(&ctx->mtx);
+
+    if (ret == AVERROR(EAGAIN)) {
+      sirius_mutex_lock(&thread->mtx);
+      sirius_cond_wait(&thread->cond, &thread->mtx);
+      sirius_mutex_unlock(&thread->mtx);
+      continue;
+    } else if (unlikely(ret < 0)) {
+      ffmpeg_error(ret, "avcodec_send_frame");
+      threadt->exit_flag = true;
+      return pollux_err_resource_alloc;
+    }
+    break;
+  }
+
+  return 0;
+}
+
+/**
+ * @note The slice threads of swscale are only used by `sws_scale_frame`, so
+ * the context is configured through its options instead of
+ * `sws_getCachedContext`.
+ */
+static bool scaler_get(encode_ctx_s *ctx, int width, int height,
+                       enum AVPixelFormat fmt) {
+  scaler_s *sc = &ctx->scaler;
+  const pollux_encode_args_t *args = &ctx->args;
+  enum AVPixelFormat dst_fmt;
+
+  if (likely(sc->sws_ctx && sc->width == width && sc->height == height &&
+             sc->fmt == fmt)) {
+    return true;
+  }
+
+  if (sc->sws_ctx)
+    sws_freeContext(sc->sws_ctx);
+  sc->sws_ctx = sws_alloc_context();
+  if (!sc->sws_ctx) {
+    sirius_error("sws_alloc_context\n");
+    return false;
+  }
+
+  cvt_pix_plx_to_ff(args->img.fmt, &dst_fmt);
+  av_opt_set_int(sc->sws_ctx, "srcw", width, 0);
+  av_opt_set_int(sc->sws_ctx, "srch", height, 0);
+  av_opt_set_int(sc->sws_ctx, "src_format", fmt, 0);
+  av_opt_set_int(sc->sws_ctx, "dstw", args->img.width, 0);
+  av_opt_set_int(sc->sws_ctx, "dsth", args->img.height, 0);
+  av_opt_set_int(sc->sws_ctx, "dst_format", dst_fmt, 0);
+  av_opt_set_int(sc->sws_ctx, "sws_flags", SWS_BILINEAR, 0);
+  av_opt_set_int(sc->sws_ctx, "threads", sirius_max(args->thread_count, 1), 0);
+
+  int ret = sws_init_context(sc->sws_ctx, nullptr, nullptr);
+  if (ret < 0) {
+    ffmpeg_error(ret, "sws_init_context");
+    sws_freeContext(sc->sws_ctx);
+    sc->sws_ctx = nullptr;
+    return false;
+  }
+
+  sirius_infosp("Conversion: %dx%d (%d) -> %dx%d (%d)\n", width, height, fmt,
+                args->img.width, args->img.height, dst_fmt);
+  sc->width = width;
+  sc->height = height;
+  sc->fmt = fmt;
+
+  return true;
+}
+
+static void buffer_free_none(void *opaque, uint8_t *data) {
+  (void)opaque;
+  (void)data;
+}
+
+static force_inline bool frame_convert_needed(encode_ctx_s *ctx,
+                                              const pollux_frame_t *r) {
+  const pollux_img_t *img = &ctx->args.img;
+
+  return ctx->args.auto_convert &&
+         (img->width != r->width || img->height != r->height ||
+          img->fmt != r->fmt);
+}
+
+/**
+ * @brief Convert the frame into a buffer of `buf_pool`, which is referenced
+ * by the encoder instead of being copied.
+ *
+ * @note The source is wrapped in a buffer which is not freed, otherwise
+ * `sws_scale_frame` copies it to take a reference.
+ */
+static int frame_convert(encode_ctx_s *ctx, AVFrame *dst,
+                         const pollux_frame_t *r) {
+  int ret;
+  scaler_s *sc = &ctx->scaler;
+  AVFrame *src = sc->src;
+  const pollux_img_t *img = &ctx->args.img;
+
+  if (unlikely(!cvt_frame_plx_to_ff(r, src)))
+    return pollux_err_args;
+  if (unlikely(!scaler_get(ctx, src->width, src->height, src->format)))
+    return pollux_err_resource_alloc;
+
+  src->buf[0] = av_buffer_create(src->data[0], 1, buffer_free_none, nullptr,
+                                 AV_BUFFER_FLAG_READONLY);
+  dst->buf[0] = av_buffer_pool_get(ctx->buf_pool);
+  if (unlikely(!src->buf[0] || !dst->buf[0])) {
+    sirius_error("Failed to get the buffers of the conversion\n");
+    ret = pollux_err_memory_alloc;
+    goto label_free;
+  }
+
+  cvt_pix_plx_to_ff(img->fmt, &dst->format);
+  dst->width = img->width;
+  dst->height = img->height;
+  ret = av_image_fill_arrays(dst->data, dst->linesize, dst->buf[0]->data,
+                             dst->format, dst->width, dst->height,
+                             ctx->buf_align);
+  if (unlikely(ret < 0)) {
+    ffmpeg_error(ret, "av_image_fill_arrays");
+    ret = pollux_err_resource_alloc;
+    goto label_free;
+  }
+
+  ret = sws_scale_frame(sc->sws_ctx, dst, src);
+  if (unlikely(ret < 0)) {
+    ffmpeg_error(ret, "sws_scale_frame");
+    ret = pollux_err_resource_alloc;
+    goto label_free;
+  }
+
+  av_buffer_unref(&src->buf[0]);
+  return 0;
+
+label_free:
+  av_buffer_unref(&src->buf[0]);
+  av_frame_unref(dst);
+
+  return ret;
+}
+
+/**
+ * @return `pollux_err_t`.
+ */
+static inline int frame_send(encode_ctx_s *ctx, AVFrame *f,
+                             const pollux_frame_t *r) {
+  int ret;
+
+  if (frame_convert_needed(ctx, r)) {
+    if ((ret = frame_convert(ctx, f, r)) != 0)
+      return ret;
+  } else if (unlikely(!cvt_frame_plx_to_ff(r, f))) {
+    return pollux_err_args;
+  }
+
+  frame_pts_set(ctx, f, r);
+  ret = send_frame(ctx, f);
+  av_frame_unref(f);
+
+  return ret;
+}
+
+static force_inline void frame_release(encode_ctx_s *ctx,
+                                       frame_item_s *item) {
+  if (ctx->args.frame_release_cb)
+    ctx->args.frame_release_cb(item->frame, item->opaque);
+  cache_put(ctx->que_item_free, item);
+}
+
+/**
+ * @note The frame is not referenced by the encoder, `avcodec_send_frame`
+ * copies its data, so it is released as soon as it has been sent.
+ */
+static void thread_feed(void *args) {
+  encode_ctx_s *ctx = (encode_ctx_s *)args;
+  thread_t *threadt = &ctx->feeder;
+  AVFrame *f = ctx->feed_frame;
+
+  int ret;
+  while (!threadt->exit_flag) {
+    frame_item_s *item = nullptr;
+
+    bool eof = ctx->feed_eof_flag;
+    ret = sirius_que_get(ctx->que_feed, (size_t *)&item,
+                         eof ? sirius_timeout_none : PACKET_WAIT_MS);
+    if (ret == sirius_err_timeout) {
+      if (eof)
+        break;
+      continue;
+    } else if (unlikely(ret || !item)) {
+      sirius_error("Failed to get the frame to send\n");
+      ctx->feed_err = pollux_err_resource_alloc;
+      break;
+    }
+
+    ret = frame_send(ctx, f, item->frame);
+    frame_release(ctx, item);
+    if (unlikely(ret)) {
+      ctx->feed_err = ret;
+      break;
+    }
+  }
+
+  sirius_infosp("Feeding thread has exited\n");
+  threadt->is_running = false;
+}
+
+static void thread_stop(thread_t *threadt) {
+  if (!threadt->create_flag)
+    return;
+
+  if (!threadt->is_running) {
+    sirius_thread_join(threadt->thread, nullptr);
+    goto label_free;
+  }
+
+  threadt->exit_flag = true;
+
+  for (int i = 20; i-- && threadt->is_running;) {
+    sirius_usleep(200 * 1000);
+  }
+
+  if (threadt->is_running) {
+    sirius_warnsp("Thread (%llu) will force exit\n", sirius_thread_id);
+    sirius_thread_cancel(threadt->thread);
+  }
+  sirius_thread_join(threadt->thread, nullptr);
+
+label_free:
+  memset(threadt, 0, sizeof(thread_t));
+}
+
+static bool thread_start(thread_t *threadt, void (*fn)(void *), void *args) {
+  threadt->exit_flag = false;
+  threadt->is_running = true;
+  if (sirius_thread_create(&threadt->thread, nullptr, (void *)fn, args)) {
+    threadt->is_running = false;
+    return false;
+  } else {
+    threadt->create_flag = true;
+  }
+
+  return true;
+}
+
+static void output_cache_free(output_s *o) {
+  for (int i = 0; i < o->packet_count; ++i)
+    av_packet_free(o->packets + i);
+  o->packet_count = 0;
+
+  sirius_que_handle *q[] = {&o->que_free, &o->que_write};
+  for (size_t i = 0; i < sizeof(q) / sizeof(q[0]); ++i) {
+    if (*q[i]) {
+      if (sirius_que_free(*q[i])) {
+        sirius_error("sirius_que_free\n");
+      } else {
+        *q[i] = nullptr;
+      }
+    }
+  }
+}
+
+static bool output_cache_alloc(output_s *o, int cache_count) {
+  int count = cache_count > 0 ? cache_count : PACKET_CACHE_DEFAULT;
+  count = sirius_min(count, PACKET_CACHE_MAX);
+
+  sirius_que_t c = {.elem_nr = count, .que_type = sirius_que_type_mtx};
+  if (sirius_que_alloc(&c, &o->que_free) ||
+      sirius_que_alloc(&c, &o->que_write)) {
+    sirius_error("sirius_que_alloc\n");
+    goto label_free;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    AVPacket *pkt = av_packet_alloc();
+    if (!pkt) {
+      sirius_error("av_packet_alloc failed\n");
+      goto label_free;
+    }
+    o->packets[o->packet_count++] = pkt;
+
+    if (cache_put(o->que_free, pkt))
+      goto label_free;
+  }
+
+  return true;
+
+label_free:
+  output_cache_free(o);
+
+  return false;
+}
+
+/**
+ * @brief Stop the writing thread of the output once its queue is written, and
+ * close it. It is repeatable.
+ */
+static void output_close(output_s *o, bool tail) {
+  thread_stop(&o->writer);
+
+  if (o->fmt_ctx) {
+    if (tail && !o->failed && av_write_trailer(o->fmt_ctx) != 0)
+      sirius_error("Failed to write the tail of the output: %s\n", o->url);
+    ffmpeg_encoder_deinit(&(ffmpeg_encode_t) {.fmt_ctx = o->fmt_ctx});
+    o->fmt_ctx = nullptr;
+  }
+  if (o->dropped) {
+    sirius_warnsp("%lld packets of the output are dropped: %s\n",
+                  (long long)o->dropped, o->sink_cb ? "sink" : o->url);
+    o->dropped = 0;
+  }
+
+  output_cache_free(o);
+}
+
+static void outputs_close(encode_ctx_s *ctx, bool tail) {
+  for (int i = 0; i < ctx->output_count; ++i)
+    output_close(ctx->outputs + i, tail);
+}
 
-  while (true) {
-    if (unlikely(!threadt->is_running))
-      return pollux_err_not_init;
+/**
+ * @brief Open the outputs and start their writing threads. An output which
+ * cannot be opened is skipped, so that the others go on.
+ *
+ * @note The `outputs_start` function must be called after the
+ * `avformat_write_header` function, see `encoder_pts_init`.
+ */
+static void outputs_start(encode_ctx_s *ctx) {
+  for (int i = 0; i < ctx->output_count; ++i) {
+    output_s *o = ctx->outputs + i;
 
-    sirius_mutex_lock(&ctx->mtx);
-    ret = avcodec_send_frame(e->codec_ctx, f);
-    sirius_mutex_unlock(&ctx->mtx);
+    o->time_base = ctx->encode.stream->time_base;
+    o->key_wait = true;
+    o->dropped = 0;
+    o->failed = true;
 
-    if (ret == AVERROR(EAGAIN)) {
-      sirius_mutex_lock(&thread->mtx);
-      sirius_cond_wait(&thread->cond, &thread->mtx);
-      sirius_mutex_unlock(&thread->mtx);
+    if (!output_cache_alloc(o, ctx->args.packet_cache_count))
+      continue;
+    if (!o->sink_cb &&
+        output_open(ctx, o->url, pollux_cont_enum_to_string(o->cont_fmt),
+                    &o->fmt_ctx)) {
+      sirius_error("Failed to open the output: %s\n", o->url);
       continue;
-    } else if (unlikely(ret < 0)) {
-      ffmpeg_error(ret, "avcodec_send_frame");
-      threadt->exit_flag = true;
-      return pollux_err_resource_alloc;
     }
-    break;
-  }
 
-  return 0;
+    o->failed = false;
+    if (!thread_start(&o->writer, thread_output, o)) {
+      sirius_error("Failed to start the output: %d\n", i);
+      o->failed = true;
+    }
+  }
 }
 
+/**
+ * @note The threads are stopped in the order of the data flow, so that none
+ * of them is waiting for a stopped one.
+ */
 static inline void encoder_receive_thread_stop(encode_ctx_s *ctx) {
-  thread_s *thread = &ctx->thread;
-  thread_t *threadt = &thread->thread;
-
-  if (!threadt->create_flag)
-    return;
-
-  if (!threadt->is_running) {
-    sirius_thread_join(threadt->thread, nullptr);
-    goto label_free;
+  AVPacket *pkt;
+  frame_item_s *item;
+
+  thread_stop(&ctx->feeder);
+  while (ctx->que_feed &&
+         !sirius_que_get(ctx->que_feed, (size_t *)&item,
+                         sirius_timeout_none) &&
+         item) {
+    frame_release(ctx, item);
   }
 
-  threadt->exit_flag = true;
-
-  for (int i = 20; i-- && threadt->is_running;) {
-    sirius_usleep(200 * 1000);
-  }
+  thread_stop(&ctx->thread.thread);
+  thread_stop(&ctx->writer);
+  outputs_close(ctx, false);
 
-  if (threadt->is_running) {
-    sirius_warnsp("Thread (%llu) will force exit\n", sirius_thread_id);
-    sirius_thread_cancel(threadt->thread);
+  /**
+   * @note The packets left by a failure are not written.
+   */
+  while (ctx->que_write &&
+         !sirius_que_get(ctx->que_write, (size_t *)&pkt,
+                         sirius_timeout_none) &&
+         pkt) {
+    av_packet_unref(pkt);
+    cache_put(ctx->que_free, pkt);
   }
-  sirius_thread_join(threadt->thread, nullptr);
-
-label_free:
-  memset(thread, 0, sizeof(thread_s));
 }
 
 static inline bool encoder_receive_thread_start(encode_ctx_s *ctx) {
-  thread_s *thread = &ctx->thread;
-  thread_t *threadt = &thread->thread;
+  ctx->receive_eof_flag = false;
+  ctx->encoder_eof_flag = false;
+  ctx->feed_eof_flag = false;
+  ctx->feed_err = 0;
 
-  threadt->exit_flag = false;
-  threadt->is_running = true;
-  if (sirius_thread_create(&threadt->thread, nullptr,
-                           (void *)thread_receive_and_write, (void *)ctx)) {
-    threadt->is_running = false;
+  if (!thread_start(&ctx->writer, thread_write, ctx))
     return false;
-  } else {
-    threadt->create_flag = true;
-  }
+  if (!thread_start(&ctx->thread.thread, thread_receive, ctx))
+    goto label_free1;
+  if (!thread_start(&ctx->feeder, thread_feed, ctx))
+    goto label_free2;
 
   return true;
+
+label_free2:
+  thread_stop(&ctx->thread.thread);
+label_free1:
+  thread_stop(&ctx->writer);
+
+  return false;
+}
+
+/**
+ * @return `pollux_err_t`.
+ */
+static inline int feed_last_frames(encode_ctx_s *ctx) {
+  ctx->feed_eof_flag = true;
+  while (ctx->feeder.is_running) {
+    sirius_nsleep(100);
+  }
+
+  return ctx->feed_err;
 }
 
 /**
@@ -361,9 +1997,10 @@ static inline int flush_last_frames(encode_ctx_s *ctx) {
     return pollux_err_stream_flush;
   }
 
-  while (threadt->is_running) {
-    if (ctx->encoder_eof_flag)
-      return 0;
+  /**
+   * @note The packets are written once the writing thread has exited.
+   */
+  while (ctx->writer.is_running) {
     sirius_nsleep(100);
   }
 
@@ -390,6 +2027,7 @@ static inline void encoder_release(encode_ctx_s *ctx) {
   if (!ctx->param_set_flag)
     return;
 
+  encoder_receive_thread_stop(ctx);
   encoder_deinit(ctx);
 
   ctx->param_set_flag = false;
@@ -402,8 +2040,10 @@ static inline void encoder_release(encode_ctx_s *ctx) {
  */
 static inline int encoder_param_set(encode_ctx_s *ctx, const char *url,
                                     const pollux_encode_args_t *args) {
-  if (ctx->param_set_flag)
+  if (ctx->param_set_flag) {
+    encoder_receive_thread_stop(ctx);
     encoder_deinit(ctx);
+  }
 
   ctx->param_set_flag = false;
 
@@ -432,13 +2072,17 @@ static inline int encoder_start(encode_ctx_s *ctx) {
     goto label_free1;
   }
 
-  if ((ret = avformat_write_header(e->fmt_ctx, nullptr)) < 0) {
+  if (ctx->args.ring_seconds <= 0 &&
+      (ret = avformat_write_header(e->fmt_ctx, nullptr)) < 0) {
     ffmpeg_error(ret, "avformat_write_header");
     ret = pollux_err_file_write;
     goto label_free2;
   }
 
   encoder_pts_init(ctx);
+  segment_start(ctx);
+  ring_start(ctx);
+  outputs_start(ctx);
 
   return 0;
 
@@ -459,10 +2103,23 @@ static inline int encoder_stop(encode_ctx_s *ctx) {
     return pollux_err_not_init;
   }
 
+  if ((ret = feed_last_frames(ctx)) != 0)
+    return ret;
   if ((ret = flush_last_frames(ctx)) != 0)
     return ret;
 
-  if ((ret = write_url_tail(e)) != 0)
+  outputs_close(ctx, true);
+
+  if (ctx->segment.len > 0) {
+    ret = segment_close(ctx, true);
+    ctx->segment.len = 0;
+  } else if (ctx->ring.len > 0) {
+    ret = ctx->ring.recording ? event_close(ctx) : 0;
+    ctx->ring.len = 0;
+  } else {
+    ret = write_url_tail(e);
+  }
+  if (ret != 0)
     return ret;
 
   encoder_receive_thread_stop(ctx);
@@ -471,15 +2128,12 @@ static inline int encoder_stop(encode_ctx_s *ctx) {
   return 0;
 }
 
-static inline int encoder_send_frame(encode_ctx_s *ctx,
-                                     const pollux_frame_t *r) {
-  AVFrame *f = ctx->av_frame;
+static force_inline int frame_args_check(encode_ctx_s *ctx,
+                                        const pollux_frame_t *r) {
   pollux_img_t *img = &ctx->args.img;
 
-  if (unlikely(!ctx->param_set_flag)) {
-    sirius_error("The resource is uninitialized\n");
-    return pollux_err_not_init;
-  }
+  if (ctx->args.auto_convert)
+    return 0;
 
   if (unlikely(img->width != r->width || img->height != r->height ||
                img->fmt != r->fmt)) {
@@ -492,12 +2146,244 @@ static inline int encoder_send_frame(encode_ctx_s *ctx,
     return pollux_err_args;
   }
 
-  if (unlikely(!cvt_frame_plx_to_ff(r, f)))
+  return 0;
+}
+
+static inline int encoder_send_frame(encode_ctx_s *ctx,
+                                     const pollux_frame_t *r) {
+  int ret;
+  AVFrame *f = ctx->av_frame;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  if ((ret = frame_args_check(ctx, r)) != 0)
+    return ret;
+
+  return frame_send(ctx, f, r);
+}
+
+static inline int encoder_send_frame_async(encode_ctx_s *ctx,
+                                           const pollux_frame_t *r,
+                                           void *opaque) {
+  int ret;
+  frame_item_s *item = nullptr;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  if (unlikely(!ctx->feeder.is_running))
+    return ctx->feed_err ? ctx->feed_err : pollux_err_not_init;
+
+  if ((ret = frame_args_check(ctx, r)) != 0)
+    return ret;
+
+  ret = sirius_que_get(ctx->que_item_free, (size_t *)&item,
+                       sirius_timeout_none);
+  if (ret == sirius_err_timeout) {
+    return pollux_err_cache_overflow;
+  } else if (unlikely(ret || !item)) {
+    sirius_error("Failed to get the frame item\n");
+    return pollux_err_resource_alloc;
+  }
+
+  item->frame = r;
+  item->opaque = opaque;
+
+  return cache_put(ctx->que_feed, item);
+}
+
+static inline int encoder_get_input_frame(encode_ctx_s *ctx,
+                                          pollux_frame_t **frame) {
+  int ret;
+  input_frame_s *in = nullptr;
+  const pollux_img_t *img = &ctx->args.img;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  ret = sirius_que_get(ctx->que_input_free, (size_t *)&in,
+                       sirius_timeout_none);
+  if (ret == sirius_err_timeout) {
+    return pollux_err_cache_overflow;
+  } else if (unlikely(ret || !in)) {
+    sirius_error("Failed to get the input frame\n");
+    return pollux_err_resource_alloc;
+  }
+
+  AVFrame *f = in->priv.av_frame;
+  pollux_frame_t *r = &in->frame;
+
+  f->buf[0] = av_buffer_pool_get(ctx->buf_pool);
+  if (unlikely(!f->buf[0])) {
+    sirius_error("av_buffer_pool_get\n");
+    cache_put(ctx->que_input_free, in);
+    return pollux_err_memory_alloc;
+  }
+
+  cvt_pix_plx_to_ff(img->fmt, &f->format);
+  f->width = img->width;
+  f->height = img->height;
+  ret = av_image_fill_arrays(f->data, f->linesize, f->buf[0]->data, f->format,
+                             f->width, f->height, ctx->buf_align);
+  if (unlikely(ret < 0)) {
+    ffmpeg_error(ret, "av_image_fill_arrays");
+    av_frame_unref(f);
+    cache_put(ctx->que_input_free, in);
+    return pollux_err_resource_alloc;
+  }
+
+  memcpy(r->linesize, f->linesize, sizeof(f->linesize));
+  memcpy(r->data, f->data, sizeof(f->data));
+  r->width = img->width;
+  r->height = img->height;
+  r->fmt = img->fmt;
+  r->pts = AV_NOPTS_VALUE;
+  r->pkt_dts = AV_NOPTS_VALUE;
+
+  *frame = r;
+  return 0;
+}
+
+static force_inline input_frame_s *input_frame_find(encode_ctx_s *ctx,
+                                                     pollux_frame_t *r) {
+  uintptr_t base = (uintptr_t)ctx->inputs;
+  uintptr_t p = (uintptr_t)r;
+
+  if (unlikely(!base || p < base ||
+               p >= base + ctx->input_count * sizeof(input_frame_s) ||
+               (p - base) % sizeof(input_frame_s))) {
+    return nullptr;
+  }
+  return (input_frame_s *)r;
+}
+
+/**
+ * @note The encoder takes a reference of the buffer instead of copying it, and
+ * the buffer returns to the pool once it is unreferenced by the encoder.
+ */
+static inline int encoder_submit_input_frame(encode_ctx_s *ctx,
+                                             pollux_frame_t *r) {
+  int ret;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  input_frame_s *in = input_frame_find(ctx, r);
+  if (unlikely(!in)) {
+    sirius_error("The frame is not from `get_input_frame`\n");
     return pollux_err_args;
+  }
 
+  AVFrame *f = in->priv.av_frame;
   frame_pts_set(ctx, f, r);
+  ret = send_frame(ctx, f);
+
+  av_frame_unref(f);
+  cache_put(ctx->que_input_free, in);
+
+  return ret;
+}
+
+static inline int encoder_key_frame_request(encode_ctx_s *ctx) {
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  ctx->key_frame_flag = true;
+
+  return 0;
+}
+
+static inline int encoder_trigger(encode_ctx_s *ctx, int post_seconds) {
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  if (unlikely(ctx->args.ring_seconds <= 0)) {
+    sirius_error("The output is not a ring\n");
+    return pollux_err_args;
+  }
+
+  ring_s *ring = &ctx->ring;
+  AVRational r = ctx->encode.stream->time_base;
+  int64_t pts = ring->frame_pts;
+  int64_t end = (pts == AV_NOPTS_VALUE ? 0 : pts) +
+                av_rescale(sirius_max(post_seconds, 0), r.den, r.num);
+
+  ring->trigger = end;
+
+  return 0;
+}
+
+/**
+ * @return `pollux_err_t`.
+ */
+static int output_new(encode_ctx_s *ctx, output_s **o) {
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  if (unlikely(ctx->writer.create_flag)) {
+    sirius_error("The outputs cannot be added after `start`\n");
+    return pollux_err_args;
+  }
+  if (unlikely(ctx->output_count == POLLUX_ENCODE_OUTPUT_MAX)) {
+    sirius_error("Too many outputs: %d\n", ctx->output_count);
+    return pollux_err_args;
+  }
+
+  *o = ctx->outputs + ctx->output_count;
+  memset(*o, 0, sizeof(output_s));
+
+  return 0;
+}
+
+static inline int encoder_output_add(encode_ctx_s *ctx, const char *url,
+                                     pollux_cont_fmt_t cont_fmt) {
+  int ret;
+  output_s *o;
+
+  if ((ret = output_new(ctx, &o)) != 0)
+    return ret;
+
+  if (unlikely(strlen(url) >= sizeof(o->url))) {
+    sirius_error("Invalid url of the output: %s\n", url);
+    return pollux_err_args;
+  }
+
+  strcpy(o->url, url);
+  o->cont_fmt = cont_fmt;
+  ctx->output_count++;
+
+  return 0;
+}
+
+static inline int encoder_output_add_sink(encode_ctx_s *ctx,
+                                          pollux_encode_sink_cb_t cb,
+                                          void *opaque) {
+  int ret;
+  output_s *o;
 
-  return send_frame(ctx, f);
+  if ((ret = output_new(ctx, &o)) != 0)
+    return ret;
+
+  o->sink_cb = cb;
+  o->opaque = opaque;
+  ctx->output_count++;
+
+  return 0;
 }
 
 static inline void encoder_priv_set(encode_ctx_s *ctx,
@@ -552,6 +2438,65 @@ static int ptr_send_frame(pollux_encode_t *h, const pollux_frame_t *r) {
   return encoder_send_frame(ctx, r);
 }
 
+static int ptr_send_frame_async(pollux_encode_t *h, const pollux_frame_t *r,
+                                void *opaque) {
+  if (unlikely(!h || !h->priv_data || !r))
+    return pollux_err_entry;
+
+  encode_ctx_s *ctx = (encode_ctx_s *)h->priv_data;
+  return encoder_send_frame_async(ctx, r, opaque);
+}
+
+static int ptr_get_input_frame(pollux_encode_t *h, pollux_frame_t **frame) {
+  if (unlikely(!h || !h->priv_data || !frame))
+    return pollux_err_entry;
+
+  encode_ctx_s *ctx = (encode_ctx_s *)h->priv_data;
+  return encoder_get_input_frame(ctx, frame);
+}
+
+static int ptr_submit_input_frame(pollux_encode_t *h, pollux_frame_t *frame) {
+  if (unlikely(!h || !h->priv_data || !frame))
+    return pollux_err_entry;
+
+  encode_ctx_s *ctx = (encode_ctx_s *)h->priv_data;
+  return encoder_submit_input_frame(ctx, frame);
+}
+
+static int ptr_key_frame_request(pollux_encode_t *h) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  encode_ctx_s *ctx = (encode_ctx_s *)h->priv_data;
+  return encoder_key_frame_request(ctx);
+}
+
+static int ptr_trigger(pollux_encode_t *h, int post_seconds) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  encode_ctx_s *ctx = (encode_ctx_s *)h->priv_data;
+  return encoder_trigger(ctx, post_seconds);
+}
+
+static int ptr_output_add(pollux_encode_t *h, const char *url,
+                          pollux_cont_fmt_t cont_fmt) {
+  if (unlikely(!h || !h->priv_data || !url))
+    return pollux_err_entry;
+
+  encode_ctx_s *ctx = (encode_ctx_s *)h->priv_data;
+  return encoder_output_add(ctx, url, cont_fmt);
+}
+
+static int ptr_output_add_sink(pollux_encode_t *h, pollux_encode_sink_cb_t cb,
+                               void *opaque) {
+  if (unlikely(!h || !h->priv_data || !cb))
+    return pollux_err_entry;
+
+  encode_ctx_s *ctx = (encode_ctx_s *)h->priv_data;
+  return encoder_output_add_sink(ctx, cb, opaque);
+}
+
 static inline void ptr_copy(pollux_encode_t *h, encode_ctx_s *ctx) {
   h->priv_data = (void *)ctx;
 
@@ -560,6 +2505,13 @@ static inline void ptr_copy(pollux_encode_t *h, encode_ctx_s *ctx) {
   h->start = ptr_start;
   h->stop = ptr_stop;
   h->send_frame = ptr_send_frame;
+  h->send_frame_async = ptr_send_frame_async;
+  h->get_input_frame = ptr_get_input_frame;
+  h->submit_input_frame = ptr_submit_input_frame;
+  h->key_frame_request = ptr_key_frame_request;
+  h->trigger = ptr_trigger;
+  h->output_add = ptr_output_add;
+  h->output_add_sink = ptr_output_add_sink;
 }
 
 pollux_api int _pollux_encode_priv_set(pollux_encode_t *handle,
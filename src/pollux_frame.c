@@ -1,6 +1,9 @@
 #include "pollux/pollux_frame.h"
 
+#include <assert.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/motion_vector.h>
+#include <libavutil/video_enc_params.h>
 
 #include "pollux/internal/ffmpeg_cvt/pixel.h"
 #include "pollux/internal/frame.h"
@@ -106,3 +109,70 @@ label_free:
 
   return pollux_err_memory_alloc;
 }
+
+static_assert(sizeof(pollux_motion_vector_t) == sizeof(AVMotionVector),
+              "pollux_motion_vector_t must have the layout of AVMotionVector");
+
+static force_inline const AVFrame *frame_av_ptr(const pollux_frame_t *frame) {
+  const frame_t *rf = (const frame_t *)frame->priv_data;
+  return rf ? rf->av_frame : nullptr;
+}
+
+pollux_api int pollux_frame_mvs_get(const pollux_frame_t *frame,
+                                    const pollux_motion_vector_t **mvs,
+                                    int *count) {
+  if (!frame || !mvs || !count)
+    return pollux_err_entry;
+
+  *mvs = nullptr;
+  *count = 0;
+
+  const AVFrame *f = frame_av_ptr(frame);
+  if (!f)
+    return pollux_err_entry;
+
+  AVFrameSideData *sd = av_frame_get_side_data(f, AV_FRAME_DATA_MOTION_VECTORS);
+  if (!sd)
+    return pollux_err_args;
+
+  *mvs = (const pollux_motion_vector_t *)sd->data;
+  *count = (int)(sd->size / sizeof(AVMotionVector));
+
+  return 0;
+}
+
+pollux_api int pollux_frame_qp_get(const pollux_frame_t *frame, int *frame_qp,
+                                   pollux_block_qp_t *blocks, int *count) {
+  if (!frame || !count)
+    return pollux_err_entry;
+
+  const AVFrame *f = frame_av_ptr(frame);
+  if (!f)
+    return pollux_err_entry;
+
+  AVFrameSideData *sd =
+    av_frame_get_side_data(f, AV_FRAME_DATA_VIDEO_ENC_PARAMS);
+  if (!sd) {
+    *count = 0;
+    return pollux_err_args;
+  }
+
+  AVVideoEncParams *par = (AVVideoEncParams *)sd->data;
+  int capacity = blocks ? *count : 0;
+
+  if (frame_qp)
+    *frame_qp = par->qp;
+
+  for (unsigned int i = 0; i < par->nb_blocks && (int)i < capacity; ++i) {
+    AVVideoBlockParams *b = av_video_enc_params_block(par, i);
+
+    blocks[i].x = b->src_x;
+    blocks[i].y = b->src_y;
+    blocks[i].w = b->w;
+    blocks[i].h = b->h;
+    blocks[i].qp = par->qp + b->delta_qp;
+  }
+  *count = (int)par->nb_blocks;
+
+  return 0;
+}
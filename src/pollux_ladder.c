@@ -0,0 +1,372 @@
+#include "pollux/pollux_ladder.h"
+
+#include <libswscale/swscale.h>
+
+#include "pollux/internal/ffmpeg_cvt/pixel.h"
+#include "pollux/internal/util.h"
+#include "pollux/pollux_erron.h"
+
+typedef struct {
+  pollux_encode_t *e;
+  pollux_encode_args_t args;
+
+  /**
+   * @brief The conversion from the previous rung, or from the sent frames for
+   * the first rung.
+   */
+  struct SwsContext *sws_ctx;
+
+  /**
+   * @brief The input frame of the encoder, which is held from the scaling to
+   * the sending.
+   */
+  pollux_frame_t *frame;
+} rung_s;
+
+typedef struct {
+  bool param_set_flag;
+  bool start_flag;
+
+  rung_s rungs[POLLUX_LADDER_RUNG_MAX];
+  int rung_count;
+
+  int gop_size;
+  int64_t frame_index;
+} ladder_ctx_s;
+
+/**
+ * @return `pollux_err_t`.
+ */
+static int frame_scale(struct SwsContext **sc, const pollux_frame_t *src,
+                       pollux_frame_t *dst) {
+  enum AVPixelFormat src_fmt, dst_fmt;
+
+  if (unlikely(!cvt_pix_plx_to_ff(src->fmt, &src_fmt) ||
+               !cvt_pix_plx_to_ff(dst->fmt, &dst_fmt))) {
+    return pollux_err_args;
+  }
+
+  *sc = sws_getCachedContext(*sc, src->width, src->height, src_fmt,
+                             dst->width, dst->height, dst_fmt, SWS_BILINEAR,
+                             nullptr, nullptr, nullptr);
+  if (unlikely(!*sc)) {
+    sirius_error("sws_getCachedContext\n");
+    return pollux_err_resource_alloc;
+  }
+
+  int height = sws_scale(*sc, (const uint8_t *const *)src->data, src->linesize,
+                         0, src->height, dst->data, dst->linesize);
+  if (unlikely(height <= 0)) {
+    sirius_error("sws_scale: %d\n", height);
+    return pollux_err_resource_alloc;
+  }
+
+  dst->pts = src->pts;
+  dst->pkt_dts = src->pkt_dts;
+  dst->time_base = src->time_base;
+
+  return 0;
+}
+
+static void ladder_deinit(ladder_ctx_s *ctx) {
+  for (int i = 0; i < ctx->rung_count; ++i) {
+    rung_s *r = ctx->rungs + i;
+
+    if (r->e)
+      pollux_encode_deinit(r->e);
+    if (r->sws_ctx)
+      sws_freeContext(r->sws_ctx);
+  }
+  memset(ctx->rungs, 0, sizeof(ctx->rungs));
+  ctx->rung_count = 0;
+}
+
+/**
+ * @brief Disable the key frames inserted by the encoder on scene changes,
+ * which differ between the rungs.
+ */
+static int rung_scenecut_disable(rung_s *r) {
+  if (r->args.codec_id != pollux_codec_id_h264) {
+    sirius_warnsp("The scene cuts of the codec %d are not disabled\n",
+                  (int)r->args.codec_id);
+    return 0;
+  }
+
+  h264_encode_args_t priv = {0};
+  priv.advanced_options = "scenecut=0";
+
+  return pollux_encode_priv_set(r->e, &priv);
+}
+
+static int ladder_init(ladder_ctx_s *ctx, const pollux_ladder_args_t *args) {
+  int ret;
+
+  if (args->rung_count <= 0 || args->rung_count > POLLUX_LADDER_RUNG_MAX) {
+    sirius_error("Invalid number of rungs: %d\n", args->rung_count);
+    return pollux_err_args;
+  }
+
+  const pollux_encode_args_t *top = &args->rungs[0].args;
+  for (int i = 0; i < args->rung_count; ++i) {
+    const pollux_ladder_rung_t *rung = args->rungs + i;
+    const pollux_img_t *img = &rung->args.img;
+
+    if (!rung->url ||
+        (i > 0 && (img->width > args->rungs[i - 1].args.img.width ||
+                   img->height > args->rungs[i - 1].args.img.height))) {
+      sirius_error("Invalid rung: %d\n", i);
+      return pollux_err_args;
+    }
+  }
+
+  for (int i = 0; i < args->rung_count; ++i) {
+    const pollux_ladder_rung_t *rung = args->rungs + i;
+    rung_s *r = ctx->rungs + i;
+    pollux_encode_args_t *eargs = &r->args;
+
+    memcpy(eargs, &rung->args, sizeof(pollux_encode_args_t));
+    eargs->frame_rate = top->frame_rate;
+    /**
+     * @note The key frames are requested by the ladder, the own interval of
+     * the encoders is set above it so that it never inserts one.
+     */
+    eargs->gop_size = top->gop_size > 0 ? top->gop_size * 2 : 0;
+    eargs->custom_pts = top->custom_pts;
+    eargs->auto_convert = false;
+
+    ctx->rung_count++;
+    if ((ret = pollux_encode_init(&r->e)) != 0)
+      goto label_free;
+    if ((ret = r->e->param_set(r->e, rung->url, eargs)) != 0) {
+      sirius_error("Failed to set the rung: %d\n", i);
+      goto label_free;
+    }
+    if ((ret = rung_scenecut_disable(r)) != 0)
+      goto label_free;
+  }
+
+  ctx->gop_size = top->gop_size;
+
+  return 0;
+
+label_free:
+  ladder_deinit(ctx);
+
+  return ret;
+}
+
+static inline void ladder_release(ladder_ctx_s *ctx) {
+  if (!ctx->param_set_flag)
+    return;
+
+  if (ctx->start_flag)
+    sirius_warnsp("The rungs are released without the tails\n");
+  ladder_deinit(ctx);
+
+  ctx->start_flag = false;
+  ctx->param_set_flag = false;
+}
+
+static inline int ladder_param_set(ladder_ctx_s *ctx,
+                                   const pollux_ladder_args_t *args) {
+  int ret;
+
+  ladder_release(ctx);
+
+  if ((ret = ladder_init(ctx, args)) != 0)
+    return ret;
+
+  ctx->param_set_flag = true;
+
+  return 0;
+}
+
+static inline int ladder_stop(ladder_ctx_s *ctx) {
+  int ret = 0;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  for (int i = 0; i < ctx->rung_count; ++i) {
+    rung_s *r = ctx->rungs + i;
+
+    int rung_ret = r->e->stop(r->e);
+    if (rung_ret) {
+      sirius_error("Failed to stop the rung: %d\n", i);
+      ret = ret ? ret : rung_ret;
+    }
+  }
+  ctx->start_flag = false;
+
+  return ret;
+}
+
+static inline int ladder_start(ladder_ctx_s *ctx) {
+  int ret;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+
+  for (int i = 0; i < ctx->rung_count; ++i) {
+    rung_s *r = ctx->rungs + i;
+
+    if ((ret = r->e->start(r->e)) != 0) {
+      sirius_error("Failed to start the rung: %d\n", i);
+      while (i--) {
+        r = ctx->rungs + i;
+        r->e->stop(r->e);
+      }
+      return ret;
+    }
+  }
+
+  ctx->frame_index = 0;
+  ctx->start_flag = true;
+
+  return 0;
+}
+
+/**
+ * @note Each rung is sent once the next one has been scaled from it, so that
+ * at most two input frames are held. On failure, the held frames are only
+ * returned to the encoders by `release`.
+ */
+static inline int ladder_send_frame(ladder_ctx_s *ctx,
+                                    const pollux_frame_t *frame) {
+  int ret;
+
+  if (unlikely(!ctx->start_flag)) {
+    sirius_error("The ladder is not started\n");
+    return pollux_err_not_init;
+  }
+
+  if (ctx->gop_size > 0 && ctx->frame_index % ctx->gop_size == 0) {
+    for (int i = 0; i < ctx->rung_count; ++i) {
+      rung_s *r = ctx->rungs + i;
+      r->e->key_frame_request(r->e);
+    }
+  }
+
+  for (int i = 0; i < ctx->rung_count; ++i) {
+    rung_s *r = ctx->rungs + i;
+    rung_s *prev = i > 0 ? r - 1 : nullptr;
+
+    if ((ret = r->e->get_input_frame(r->e, &r->frame)) != 0)
+      return ret;
+    ret = frame_scale(&r->sws_ctx, prev ? prev->frame : frame, r->frame);
+    if (ret)
+      return ret;
+
+    if (prev && (ret = prev->e->submit_input_frame(prev->e, prev->frame)) != 0)
+      return ret;
+  }
+
+  rung_s *last = ctx->rungs + ctx->rung_count - 1;
+  if ((ret = last->e->submit_input_frame(last->e, last->frame)) != 0)
+    return ret;
+
+  ctx->frame_index++;
+
+  return 0;
+}
+
+static int ptr_release(pollux_ladder_t *h) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  ladder_ctx_s *ctx = (ladder_ctx_s *)h->priv_data;
+  ladder_release(ctx);
+
+  return 0;
+}
+
+static int ptr_param_set(pollux_ladder_t *h,
+                         const pollux_ladder_args_t *args) {
+  if (unlikely(!h || !h->priv_data || !args || !args->rungs))
+    return pollux_err_entry;
+
+  ladder_ctx_s *ctx = (ladder_ctx_s *)h->priv_data;
+  return ladder_param_set(ctx, args);
+}
+
+static int ptr_start(pollux_ladder_t *h) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  ladder_ctx_s *ctx = (ladder_ctx_s *)h->priv_data;
+  return ladder_start(ctx);
+}
+
+static int ptr_stop(pollux_ladder_t *h) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  ladder_ctx_s *ctx = (ladder_ctx_s *)h->priv_data;
+  return ladder_stop(ctx);
+}
+
+static int ptr_send_frame(pollux_ladder_t *h, const pollux_frame_t *frame) {
+  if (unlikely(!h || !h->priv_data || !frame))
+    return pollux_err_entry;
+
+  ladder_ctx_s *ctx = (ladder_ctx_s *)h->priv_data;
+  return ladder_send_frame(ctx, frame);
+}
+
+static inline void ptr_copy(pollux_ladder_t *h, ladder_ctx_s *ctx) {
+  h->priv_data = (void *)ctx;
+
+  h->release = ptr_release;
+  h->param_set = ptr_param_set;
+  h->start = ptr_start;
+  h->stop = ptr_stop;
+  h->send_frame = ptr_send_frame;
+}
+
+pollux_api void pollux_ladder_deinit(pollux_ladder_t *handle) {
+  if (!handle)
+    return;
+  if (!handle->priv_data)
+    goto label_free;
+
+  ladder_ctx_s **ctx = (ladder_ctx_s **)(&handle->priv_data);
+
+  ladder_release(*ctx);
+
+  free(*ctx);
+  *ctx = nullptr;
+
+label_free:
+  free(handle);
+}
+
+pollux_api int pollux_ladder_init(pollux_ladder_t **handle) {
+  int ret = 0;
+
+  pollux_ladder_t *h = (pollux_ladder_t *)calloc(1, sizeof(pollux_ladder_t));
+  if (!h) {
+    sirius_error("calloc -> 'pollux_ladder_t'\n");
+    return pollux_err_memory_alloc;
+  }
+
+  ladder_ctx_s *ctx = (ladder_ctx_s *)calloc(1, sizeof(ladder_ctx_s));
+  if (!ctx) {
+    sirius_error("calloc -> 'ladder_ctx_s'\n");
+    ret = pollux_err_memory_alloc;
+    goto label_free1;
+  }
+
+  ptr_copy(h, ctx);
+  *handle = h;
+
+  return 0;
+
+label_free1:
+  free(h);
+
+  return ret;
+}
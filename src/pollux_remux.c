@@ -0,0 +1,1452 @@
+#include "pollux/pollux_remux.h"
+
+#include <libswscale/swscale.h>
+#include <sirius/sirius_thread.h>
+
+#include "pollux/internal/codec/ffmpeg_decode.h"
+#include "pollux/internal/codec/ffmpeg_encode.h"
+#include "pollux/internal/ffmpeg_cvt/frame.h"
+#include "pollux/internal/util.h"
+#include "pollux/pollux_erron.h"
+
+typedef struct {
+  bool param_set_flag;
+
+  pollux_remux_args_t args;
+
+  /**
+   * @brief The output, only the format context and the stream are used.
+   */
+  ffmpeg_encode_t encode;
+
+  bool header_flag;
+  bool finish_flag;
+
+  AVPacket *pkt;
+
+  /**
+   * @brief The timeline of the output, in units of the time base of the
+   * output stream: the last written dts and the dts at which the next input
+   * starts.
+   */
+  int64_t last_dts;
+  int64_t next_dts;
+  int64_t packets_written;
+} remux_ctx_s;
+
+/**
+ * @brief The placement of an input on the timeline of the output.
+ */
+typedef struct {
+  /**
+   * @brief The timestamp of the input placed at `next_dts`, in units of the
+   * time base of the input stream. `AV_NOPTS_VALUE` for the dts of the first
+   * packet.
+   */
+  int64_t base;
+
+  /**
+   * @brief The interval of the last packet in the output, and the number of
+   * packets written from the input.
+   */
+  int64_t delta;
+  int64_t count;
+} timeline_s;
+
+/**
+ * @brief The sections of a cut, in units of the time base of the input stream.
+ * The frames in [start, copy_start) and [copy_end, end) are re-encoded, the
+ * packets in [copy_start, copy_end) are copied.
+ */
+typedef struct {
+  int64_t start, end;
+
+  /**
+   * @brief The first key frame at or after `start`, `INT64_MAX` if there is
+   * none before `end`.
+   */
+  int64_t copy_start;
+
+  /**
+   * @brief The key frame at which the copy stops, `INT64_MAX` to copy up to
+   * the end of the input.
+   */
+  int64_t copy_end;
+} cut_plan_s;
+
+typedef enum {
+  cut_state_head,
+  cut_state_copy,
+  cut_state_tail,
+  cut_state_done,
+} cut_state_s;
+
+/**
+ * @brief The number of frames between the key frames of a re-encoded section,
+ * in seconds. The edge of a cut is shorter than a GOP of the source, so it
+ * usually has a single key frame.
+ */
+#define EDGE_GOP_SECONDS (10)
+
+static void input_close(ffmpeg_decode_t **d_ptr) {
+  ffmpeg_decoder_destroy(d_ptr);
+}
+
+static ffmpeg_decode_t *input_open(remux_ctx_s *ctx, const char *url) {
+  ffmpeg_decode_t *d;
+  ffmpeg_decode_args_t ffmpeg_args = {0};
+
+  ffmpeg_args.mmap_enable = ctx->args.mmap_enable;
+  ffmpeg_args.prefetch_size =
+    (int64_t)ctx->args.prefetch_size_mb * 1024 * 1024;
+
+  if (!(d = ffmpeg_decoder_create(url, &ffmpeg_args)))
+    return nullptr;
+
+  /**
+   * @note `AVMEDIA_TYPE_VIDEO` default, Subsequent improvement.
+   */
+  if (ffmpeg_decoder_find_stream(d, AVMEDIA_TYPE_VIDEO))
+    goto label_free;
+
+  /**
+   * @note H.264/HEVC are copied as Annex B, so that the parameter sets stay
+   * in-band when inputs or re-encoded sections with different parameter sets
+   * are spliced. The `mp4` muxer converts them back to the length-prefixed
+   * format.
+   */
+  if (ffmpeg_decoder_annexb_open(d))
+    goto label_free;
+
+  return d;
+
+label_free:
+  input_close(&d);
+
+  return nullptr;
+}
+
+/**
+ * @brief The codec parameters of the packets read from an input, which are
+ * converted to Annex B for H.264/HEVC.
+ */
+static force_inline const AVCodecParameters *
+input_par(const ffmpeg_decode_t *d) {
+  return d->bsf ? d->bsf->par_out
+                : d->fmt_ctx->streams[d->stream_index]->codecpar;
+}
+
+/**
+ * @brief Open a decoder of the packets read from an input.
+ */
+static ffmpeg_decode_t *input_decoder_open(const ffmpeg_decode_t *d) {
+  ffmpeg_decode_t *dec;
+  ffmpeg_decode_args_t args = {0};
+
+  args.pkt_timebase = d->fmt_ctx->streams[d->stream_index]->time_base;
+  if (!(dec = ffmpeg_decoder_create_par(input_par(d), &args)))
+    return nullptr;
+
+  if (ffmpeg_decoder_alloc_buffers(dec)) {
+    ffmpeg_decoder_destroy(&dec);
+    return nullptr;
+  }
+
+  return dec;
+}
+
+/**
+ * @brief Check that the packets of an input can be copied to the output.
+ *
+ * @note The parameter sets of H.264/HEVC are in-band after the conversion to
+ * Annex B, their extradata may differ.
+ */
+static bool input_compatible(const remux_ctx_s *ctx,
+                             const ffmpeg_decode_t *d) {
+  const AVCodecParameters *a = input_par(d);
+  const AVCodecParameters *b = ctx->encode.stream->codecpar;
+  const char *url = d->fmt_ctx->url;
+
+  if (a->codec_id != b->codec_id) {
+    sirius_warnsp("Codec differs from the output: %s\n", url);
+    return false;
+  }
+  if (a->width != b->width || a->height != b->height) {
+    sirius_warnsp("Size %dx%d differs from the output %dx%d: %s\n", a->width,
+                  a->height, b->width, b->height, url);
+    return false;
+  }
+  if (a->format != b->format) {
+    sirius_warnsp("Pixel format differs from the output: %s\n", url);
+    return false;
+  }
+  if (a->profile != b->profile) {
+    sirius_warnsp("Profile %d differs from the output %d: %s\n", a->profile,
+                  b->profile, url);
+    return false;
+  }
+
+  if (a->codec_id == AV_CODEC_ID_H264 || a->codec_id == AV_CODEC_ID_HEVC)
+    return true;
+  if (a->extradata_size != b->extradata_size ||
+      (a->extradata_size &&
+       memcmp(a->extradata, b->extradata, a->extradata_size))) {
+    sirius_warnsp("Extradata differs from the output: %s\n", url);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Create the output stream with the codec parameters of the first
+ * input, and write the header.
+ */
+static int output_stream_open(remux_ctx_s *ctx, const ffmpeg_decode_t *d) {
+  int ret;
+  ffmpeg_encode_t *e = &ctx->encode;
+  AVStream *ist = d->fmt_ctx->streams[d->stream_index];
+  const AVCodecParameters *par = input_par(d);
+
+  e->stream = avformat_new_stream(e->fmt_ctx, nullptr);
+  if (!e->stream) {
+    sirius_error("avformat_new_stream\n");
+    return pollux_err_resource_alloc;
+  }
+
+  ret = avcodec_parameters_copy(e->stream->codecpar, par);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avcodec_parameters_copy");
+    return pollux_err_resource_alloc;
+  }
+
+  /**
+   * @note The tag of the input container may be invalid in the output one,
+   * let the muxer choose it.
+   */
+  e->stream->codecpar->codec_tag = 0;
+  e->stream->time_base = ist->time_base;
+  e->stream->avg_frame_rate = ist->avg_frame_rate;
+
+  ret = avformat_write_header(e->fmt_ctx, nullptr);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avformat_write_header");
+    return pollux_err_file_write;
+  }
+  ctx->header_flag = true;
+
+  av_dump_format(e->fmt_ctx, 0, e->fmt_ctx->url, 1);
+  return 0;
+}
+
+/**
+ * @brief Open the output stream with the first input, or check that the
+ * codec of a following input is the same.
+ */
+static int output_prepare(remux_ctx_s *ctx, const ffmpeg_decode_t *d) {
+  AVCodecParameters *par = d->fmt_ctx->streams[d->stream_index]->codecpar;
+
+  if (!ctx->header_flag)
+    return output_stream_open(ctx, d);
+
+  if (par->codec_id != ctx->encode.stream->codecpar->codec_id) {
+    sirius_error("The codec of the input differs from the output: %s\n",
+                 d->fmt_ctx->url);
+    return pollux_err_args;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Write a packet of an input to the output. The reference of the packet
+ * is taken.
+ *
+ * @param[in] tb The time base of the timestamps of the packet.
+ */
+static int packet_write(remux_ctx_s *ctx, timeline_s *tl, AVPacket *pkt,
+                        AVRational tb) {
+  int ret;
+  AVStream *ost = ctx->encode.stream;
+
+  if (pkt->dts == AV_NOPTS_VALUE)
+    pkt->dts = pkt->pts;
+  if (unlikely(pkt->dts == AV_NOPTS_VALUE)) {
+    sirius_warnsp("Packet without timestamp, dropped\n");
+    av_packet_unref(pkt);
+    return 0;
+  }
+
+  /**
+   * @brief Shift the input to start at 0, then to the end of the output.
+   */
+  if (tl->base == AV_NOPTS_VALUE)
+    tl->base = pkt->dts;
+  pkt->dts -= tl->base;
+  if (pkt->pts != AV_NOPTS_VALUE)
+    pkt->pts -= tl->base;
+  av_packet_rescale_ts(pkt, tb, ost->time_base);
+  pkt->dts += ctx->next_dts;
+  if (pkt->pts != AV_NOPTS_VALUE)
+    pkt->pts += ctx->next_dts;
+
+  /**
+   * @note The muxers require strictly increasing dts, which the rounding of
+   * the rescaling, or the reordering delay of a section that follows another
+   * one, may break.
+   */
+  if (ctx->packets_written && pkt->dts <= ctx->last_dts)
+    pkt->dts = ctx->last_dts + 1;
+  if (pkt->pts != AV_NOPTS_VALUE && pkt->pts < pkt->dts)
+    pkt->pts = pkt->dts;
+
+  if (tl->count)
+    tl->delta = pkt->dts - ctx->last_dts;
+  ctx->last_dts = pkt->dts;
+  if (pkt->duration > 0)
+    tl->delta = pkt->duration;
+
+  pkt->stream_index = ost->index;
+  pkt->pos = -1;
+
+  /**
+   * @note `av_interleaved_write_frame` takes the reference of the packet.
+   */
+  ret = av_interleaved_write_frame(ctx->encode.fmt_ctx, pkt);
+  if (ret < 0) {
+    ffmpeg_error(ret, "av_interleaved_write_frame");
+    return pollux_err_file_write;
+  }
+  tl->count++;
+  ctx->packets_written++;
+
+  return 0;
+}
+
+/**
+ * @brief Move `next_dts` to the end of an input.
+ */
+static void timeline_close(remux_ctx_s *ctx, const timeline_s *tl) {
+  /**
+   * @note The next input starts one packet interval after the last one.
+   */
+  if (tl->count)
+    ctx->next_dts = ctx->last_dts + sirius_max(tl->delta, 1);
+}
+
+/**
+ * @brief Copy the packets of an input to the output, starting at `next_dts`.
+ */
+static int packets_copy(remux_ctx_s *ctx, ffmpeg_decode_t *d) {
+  int ret;
+  AVPacket *pkt = ctx->pkt;
+  AVStream *ist = d->fmt_ctx->streams[d->stream_index];
+  timeline_s tl = {AV_NOPTS_VALUE, 0, 0};
+
+  while ((ret = ffmpeg_decoder_read_packet(d, pkt)) == 0) {
+    if ((ret = packet_write(ctx, &tl, pkt, ist->time_base)) != 0)
+      return ret;
+  }
+  if (ret != pollux_err_stream_end)
+    return ret;
+
+  timeline_close(ctx, &tl);
+
+  sirius_infosp("%" PRId64 " packets copied from: %s\n", tl.count,
+                d->fmt_ctx->url);
+  return 0;
+}
+
+/**
+ * @brief A re-encoded section: the frames decoded from the input, whose pts
+ * is in [lo, hi), are encoded again with the codec parameters `par`.
+ */
+typedef struct {
+  const AVStream *ist;
+  const AVCodecParameters *par;
+
+  /**
+   * @brief The decoder of the packets of the input, which are Annex B, and
+   * the encoder of the section, which is opened on the first frame.
+   */
+  ffmpeg_decode_t *dec;
+  ffmpeg_encode_t enc;
+
+  /**
+   * @brief The conversion of the frames whose size or format differs from
+   * the encoder.
+   */
+  struct SwsContext *sws;
+  AVFrame *scaled;
+
+  int64_t lo, hi;
+
+  /**
+   * @brief A frame at or after `hi` has been decoded.
+   */
+  bool past;
+
+  /**
+   * @brief The number of frames encoded by all the sections.
+   */
+  int64_t frames;
+} edge_s;
+
+static force_inline int64_t packet_pts(const AVPacket *pkt) {
+  return pkt->pts != AV_NOPTS_VALUE ? pkt->pts : pkt->dts;
+}
+
+/**
+ * @brief Seek to the key frame at or before `ts`, in units of the time base of
+ * the input stream.
+ */
+static int input_seek(ffmpeg_decode_t *d, int64_t ts) {
+  int ret = avformat_seek_file(d->fmt_ctx, d->stream_index, INT64_MIN, ts, ts,
+                               AVSEEK_FLAG_BACKWARD);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avformat_seek_file");
+    return pollux_err_file_read;
+  }
+  if (d->bsf)
+    av_bsf_flush(d->bsf);
+
+  return 0;
+}
+
+/**
+ * @brief Find the key frames of a cut by scanning the packets of the input,
+ * without decoding them, from the key frame at or before `start` to the first
+ * one after `end`.
+ */
+static int cut_plan_make(remux_ctx_s *ctx, ffmpeg_decode_t *d,
+                         cut_plan_s *plan) {
+  int ret;
+  AVPacket *pkt = ctx->pkt;
+  int64_t last_key = INT64_MAX;
+  int64_t max_pts = INT64_MIN;
+
+  plan->copy_start = INT64_MAX;
+  plan->copy_end = INT64_MAX;
+
+  if ((ret = input_seek(d, plan->start)) != 0)
+    return ret;
+
+  while ((ret = ffmpeg_decoder_read_packet(d, pkt)) == 0) {
+    bool key = pkt->flags & AV_PKT_FLAG_KEY;
+    int64_t pts = packet_pts(pkt);
+
+    av_packet_unref(pkt);
+    if (pts == AV_NOPTS_VALUE)
+      continue;
+    if (key && pts > plan->end)
+      break;
+
+    max_pts = sirius_max(max_pts, pts);
+    if (key && pts >= plan->start) {
+      if (plan->copy_start == INT64_MAX && pts < plan->end)
+        plan->copy_start = pts;
+      last_key = pts;
+    }
+  }
+
+  if (ret == 0) {
+    plan->copy_end = last_key;
+  } else if (ret == pollux_err_stream_end) {
+    /**
+     * @note The last GOP ends with the input, it is copied as a whole if the
+     * input ends before `end`.
+     */
+    plan->copy_end = max_pts < plan->end ? INT64_MAX : last_key;
+  } else {
+    return ret;
+  }
+
+  if (plan->copy_start == INT64_MAX)
+    plan->copy_end = INT64_MAX;
+
+  return 0;
+}
+
+/**
+ * @brief Open the encoder of a section with the codec parameters `par`. The
+ * parameter sets are kept in-band, the section is spliced between packets
+ * that carry their own.
+ */
+static int edge_open(edge_s *edge, const AVFrame *frame) {
+  int ret;
+  const AVStream *ist = edge->ist;
+  const AVCodecParameters *par = edge->par;
+  ffmpeg_encode_t *e = &edge->enc;
+  ffmpeg_encode_args_t args = {0};
+
+  AVRational fps = ist->avg_frame_rate;
+  if (!fps.num || !fps.den)
+    fps = ist->r_frame_rate;
+  if (!fps.num || !fps.den)
+    fps = (AVRational) {25, 1};
+
+  args.bit_rate = par->bit_rate ? par->bit_rate : ist->codecpar->bit_rate;
+  args.width = par->width > 0 ? par->width : frame->width;
+  args.height = par->height > 0 ? par->height : frame->height;
+  args.frame_rate.num = fps.num;
+  args.frame_rate.den = fps.den;
+  args.gop_size = EDGE_GOP_SECONDS * fps.num / fps.den;
+  args.max_b_frames = 0;
+  args.pix_fmt = (enum AVPixelFormat)(par->format >= 0 ? par->format
+                                                        : frame->format);
+
+  if ((ret = ffmpeg_encoder_codec_alloc(e, &args, par->codec_id)) != 0)
+    goto label_free;
+
+  /**
+   * @note The frames keep the timestamps of the input.
+   */
+  AVCodecContext *cc = e->codec_ctx;
+  cc->time_base = ist->time_base;
+  cc->profile = par->profile;
+  cc->level = par->level;
+  cc->sample_aspect_ratio = frame->sample_aspect_ratio;
+  cc->color_range = par->color_range;
+  cc->color_primaries = par->color_primaries;
+  cc->color_trc = par->color_trc;
+  cc->colorspace = par->color_space;
+
+  if ((ret = ffmpeg_encoder_codec_open(e)) != 0)
+    goto label_free;
+
+  sirius_debgsp("Section encoder opened: [%" PRId64 ", %" PRId64 ")\n",
+                edge->lo, edge->hi);
+  return 0;
+
+label_free:
+  ffmpeg_encoder_ctx_free(e);
+
+  return ret;
+}
+
+/**
+ * @brief Encode a frame of a section, nullptr to flush the encoder.
+ */
+static int edge_encode(remux_ctx_s *ctx, timeline_s *tl, edge_s *edge,
+                       const AVFrame *frame) {
+  int ret;
+  AVCodecContext *cc = edge->enc.codec_ctx;
+  AVPacket *pkt = ctx->pkt;
+
+  ret = avcodec_send_frame(cc, frame);
+  if (ret < 0) {
+    ffmpeg_error(ret, "avcodec_send_frame");
+    return pollux_err_args;
+  }
+
+  while ((ret = avcodec_receive_packet(cc, pkt)) == 0) {
+    if ((ret = packet_write(ctx, tl, pkt, cc->time_base)) != 0)
+      return ret;
+  }
+  if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+    ffmpeg_error(ret, "avcodec_receive_packet");
+    return pollux_err_args;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Convert a frame to the size and format of the encoder, if needed.
+ *
+ * @return The frame to encode, nullptr on failure.
+ */
+static AVFrame *edge_scale(edge_s *edge, AVFrame *f) {
+  AVCodecContext *cc = edge->enc.codec_ctx;
+
+  if (likely(f->width == cc->width && f->height == cc->height &&
+             f->format == cc->pix_fmt))
+    return f;
+
+  edge->sws = sws_getCachedContext(edge->sws, f->width, f->height, f->format,
+                                   cc->width, cc->height, cc->pix_fmt,
+                                   SWS_BILINEAR, nullptr, nullptr, nullptr);
+  if (unlikely(!edge->sws)) {
+    sirius_error("sws_getCachedContext\n");
+    return nullptr;
+  }
+
+  if (!edge->scaled) {
+    if (!(edge->scaled = av_frame_alloc())) {
+      sirius_error("av_frame_alloc failed\n");
+      return nullptr;
+    }
+    edge->scaled->width = cc->width;
+    edge->scaled->height = cc->height;
+    edge->scaled->format = cc->pix_fmt;
+    if (av_frame_get_buffer(edge->scaled, 0) < 0) {
+      sirius_error("av_frame_get_buffer failed\n");
+      return nullptr;
+    }
+  }
+
+  /**
+   * @note The encoder may still hold a reference of the previous frame.
+   */
+  if (av_frame_make_writable(edge->scaled) < 0) {
+    sirius_error("av_frame_make_writable failed\n");
+    return nullptr;
+  }
+
+  sws_scale(edge->sws, (const uint8_t *const *)f->data, f->linesize, 0,
+            f->height, edge->scaled->data, edge->scaled->linesize);
+  av_frame_copy_props(edge->scaled, f);
+
+  return edge->scaled;
+}
+
+/**
+ * @brief Decode a packet of the input and encode the frames of the section,
+ * nullptr to flush the decoder. The reference of the packet is taken.
+ */
+static int edge_decode(remux_ctx_s *ctx, timeline_s *tl, edge_s *edge,
+                       AVPacket *pkt) {
+  int ret;
+  AVCodecContext *dc = edge->dec->codec_ctx;
+  AVFrame *f = edge->dec->frame;
+
+  ret = avcodec_send_packet(dc, pkt);
+  if (pkt)
+    av_packet_unref(pkt);
+  if (ret < 0 && ret != AVERROR_EOF) {
+    ffmpeg_error(ret, "avcodec_send_packet");
+    return pollux_err_file_read;
+  }
+
+  while ((ret = avcodec_receive_frame(dc, f)) == 0) {
+    int64_t pts = f->best_effort_timestamp;
+
+    if (pts != AV_NOPTS_VALUE && pts >= edge->lo && pts < edge->hi) {
+      if (!edge->enc.codec_ctx)
+        ret = edge_open(edge, f);
+      if (!ret) {
+        AVFrame *ef = edge_scale(edge, f);
+
+        /**
+         * @note The picture type of the input must not force the key frames
+         * of the section.
+         */
+        if (likely(ef)) {
+          ef->pts = pts;
+          ef->pict_type = AV_PICTURE_TYPE_NONE;
+          ret = edge_encode(ctx, tl, edge, ef);
+          edge->frames++;
+        } else {
+          ret = pollux_err_resource_alloc;
+        }
+      }
+    } else if (pts != AV_NOPTS_VALUE && pts >= edge->hi) {
+      edge->past = true;
+    }
+
+    av_frame_unref(f);
+    if (ret)
+      return ret;
+  }
+  if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+    ffmpeg_error(ret, "avcodec_receive_frame");
+    return pollux_err_file_read;
+  }
+
+  return 0;
+}
+
+static void edge_close(edge_s *edge) {
+  ffmpeg_encoder_ctx_free(&edge->enc);
+  av_frame_free(&edge->scaled);
+  if (edge->sws) {
+    sws_freeContext(edge->sws);
+    edge->sws = nullptr;
+  }
+}
+
+/**
+ * @brief Drain the decoder and the encoder of a section, and close the
+ * encoder. The decoder is reset for the next section.
+ */
+static int edge_finish(remux_ctx_s *ctx, timeline_s *tl, edge_s *edge) {
+  int ret = edge_decode(ctx, tl, edge, nullptr);
+
+  avcodec_flush_buffers(edge->dec->codec_ctx);
+  if (!ret && edge->enc.codec_ctx)
+    ret = edge_encode(ctx, tl, edge, nullptr);
+
+  ffmpeg_encoder_ctx_free(&edge->enc);
+  edge->past = false;
+
+  return ret;
+}
+
+/**
+ * @brief Write a cut to the output in one sweep over the input: the head
+ * section is re-encoded, the whole GOPs are copied, then the tail section is
+ * re-encoded.
+ *
+ * @note Closed GOPs are assumed. The leading pictures of an open GOP, which
+ * precede its key frame in presentation order, are dropped from the copy.
+ */
+static int cut_write(remux_ctx_s *ctx, ffmpeg_decode_t *d,
+                     ffmpeg_decode_t *dec, const cut_plan_s *plan) {
+  int ret;
+  AVPacket *pkt = ctx->pkt;
+  AVStream *ist = d->fmt_ctx->streams[d->stream_index];
+  timeline_s tl = {plan->start, 0, 0};
+  cut_state_s state = cut_state_head;
+  int64_t copied = 0;
+  edge_s edge = {0};
+
+  edge.ist = ist;
+  edge.par = input_par(d);
+  edge.dec = dec;
+  edge.lo = plan->start;
+  edge.hi = sirius_min(plan->copy_start, plan->end);
+
+  if ((ret = input_seek(d, plan->start)) != 0)
+    return ret;
+
+  while (state != cut_state_done &&
+         (ret = ffmpeg_decoder_read_packet(d, pkt)) == 0) {
+    bool key = pkt->flags & AV_PKT_FLAG_KEY;
+    int64_t pts = packet_pts(pkt);
+
+    if (state == cut_state_head && key && pts >= plan->copy_start) {
+      if ((ret = edge_finish(ctx, &tl, &edge)) != 0)
+        goto label_free;
+      state = cut_state_copy;
+    }
+    if (state == cut_state_copy && key && pts >= plan->copy_end) {
+      state =
+        plan->copy_end >= plan->end ? cut_state_done : cut_state_tail;
+      edge.lo = plan->copy_end;
+      edge.hi = plan->end;
+    }
+
+    switch (state) {
+    case cut_state_copy:
+      if (pts >= plan->copy_start) {
+        ret = packet_write(ctx, &tl, pkt, ist->time_base);
+        copied++;
+      } else {
+        av_packet_unref(pkt);
+      }
+      break;
+    case cut_state_done:
+      av_packet_unref(pkt);
+      break;
+    default:
+      ret = edge_decode(ctx, &tl, &edge, pkt);
+      if (!ret && edge.past && edge.hi == plan->end) {
+        ret = edge_finish(ctx, &tl, &edge);
+        state = cut_state_done;
+      }
+      break;
+    }
+    if (ret)
+      goto label_free;
+  }
+
+  if (state != cut_state_done) {
+    if (ret != pollux_err_stream_end)
+      goto label_free;
+    if (state != cut_state_copy && (ret = edge_finish(ctx, &tl, &edge)) != 0)
+      goto label_free;
+  }
+
+  if (!tl.count) {
+    sirius_error("No frame in the range of the cut: %s\n", d->fmt_ctx->url);
+    ret = pollux_err_args;
+    goto label_free;
+  }
+  timeline_close(ctx, &tl);
+
+  sirius_infosp("%" PRId64 " packets copied and %" PRId64
+                " frames re-encoded from: %s\n",
+                copied, edge.frames, d->fmt_ctx->url);
+  ret = 0;
+
+label_free:
+  edge_close(&edge);
+
+  return ret;
+}
+
+/**
+ * @brief Decode an input and encode it again with the codec parameters of
+ * the output, starting at `next_dts`.
+ */
+static int input_transcode(remux_ctx_s *ctx, ffmpeg_decode_t *d) {
+  int ret;
+  AVPacket *pkt = ctx->pkt;
+  timeline_s tl = {AV_NOPTS_VALUE, 0, 0};
+  edge_s edge = {0};
+
+  if (!(edge.dec = input_decoder_open(d)))
+    return pollux_err_resource_alloc;
+  edge.ist = d->fmt_ctx->streams[d->stream_index];
+  edge.par = ctx->encode.stream->codecpar;
+  edge.lo = INT64_MIN;
+  edge.hi = INT64_MAX;
+
+  while ((ret = ffmpeg_decoder_read_packet(d, pkt)) == 0) {
+    if ((ret = edge_decode(ctx, &tl, &edge, pkt)) != 0)
+      goto label_free;
+  }
+  if (ret != pollux_err_stream_end)
+    goto label_free;
+  if ((ret = edge_finish(ctx, &tl, &edge)) != 0)
+    goto label_free;
+
+  timeline_close(ctx, &tl);
+
+  sirius_infosp("%" PRId64 " frames re-encoded from: %s\n", edge.frames,
+                d->fmt_ctx->url);
+  ret = 0;
+
+label_free:
+  edge_close(&edge);
+  ffmpeg_decoder_destroy(&edge.dec);
+
+  return ret;
+}
+
+#define CHUNK_DEFAULT (4)
+#define CHUNK_MAX (64)
+
+/**
+ * @brief A chunk of `transcode`, which is encoded into a temporary file on its
+ * own thread.
+ */
+typedef struct {
+  remux_ctx_s *ctx;
+  const char *url;
+  pollux_encode_args_t args;
+
+  /**
+   * @brief The range of the chunk, [start, end), in units of the time base of
+   * the input stream. `start` is a key frame, INT64_MIN for the first chunk.
+   */
+  int64_t start, end;
+
+  char path[1024];
+
+  sirius_thread_handle thread;
+  int64_t frames;
+  int ret;
+} chunk_s;
+
+/**
+ * @brief Split an input at the key frames nearest to the equal parts of its
+ * duration, by scanning its packets without decoding them.
+ *
+ * @return The number of chunks, or a negative error code.
+ */
+static int chunk_plan_make(remux_ctx_s *ctx, ffmpeg_decode_t *d,
+                           chunk_s *chunks, int count) {
+  int ret;
+  AVPacket *pkt = ctx->pkt;
+  int64_t *keys = nullptr;
+  int key_count = 0, key_cap = 0;
+  int64_t min_pts = INT64_MAX, max_pts = INT64_MIN;
+
+  while ((ret = ffmpeg_decoder_read_packet(d, pkt)) == 0) {
+    bool key = pkt->flags & AV_PKT_FLAG_KEY;
+    int64_t pts = packet_pts(pkt);
+
+    av_packet_unref(pkt);
+    if (pts == AV_NOPTS_VALUE)
+      continue;
+
+    min_pts = sirius_min(min_pts, pts);
+    max_pts = sirius_max(max_pts, pts);
+    if (!key)
+      continue;
+
+    if (key_count == key_cap) {
+      key_cap = key_cap ? key_cap * 2 : 256;
+      int64_t *p = (int64_t *)realloc(keys, sizeof(int64_t) * key_cap);
+      if (!p) {
+        sirius_error("realloc -> 'keys'\n");
+        free(keys);
+        return pollux_err_memory_alloc;
+      }
+      keys = p;
+    }
+    keys[key_count++] = pts;
+  }
+  if (ret != pollux_err_stream_end) {
+    free(keys);
+    return ret;
+  }
+
+  int n = 0;
+  chunks[n++].start = INT64_MIN;
+  for (int i = 1; i < count && min_pts < max_pts; ++i) {
+    int64_t target = min_pts + (max_pts - min_pts) / count * i;
+    int64_t best = INT64_MIN;
+
+    for (int k = 0; k < key_count; ++k) {
+      if (keys[k] <= min_pts)
+        continue;
+      if (best == INT64_MIN ||
+          llabs(keys[k] - target) < llabs(best - target)) {
+        best = keys[k];
+      }
+    }
+
+    /**
+     * @note The key frames may be too sparse for `count` chunks.
+     */
+    if (best != INT64_MIN && best > chunks[n - 1].start) {
+      chunks[n - 1].end = best;
+      chunks[n++].start = best;
+    }
+  }
+  chunks[n - 1].end = INT64_MAX;
+
+  free(keys);
+  return n;
+}
+
+/**
+ * @brief Decode a packet of a chunk and send the frames in its range to the
+ * encoder, nullptr to flush the decoder. The reference of the packet is taken.
+ */
+static int chunk_decode(chunk_s *c, ffmpeg_decode_t *dec, pollux_encode_t *e,
+                        AVPacket *pkt) {
+  int ret;
+  AVCodecContext *dc = dec->codec_ctx;
+  AVFrame *f = dec->frame;
+  pollux_frame_t pf = {0};
+
+  ret = avcodec_send_packet(dc, pkt);
+  if (pkt)
+    av_packet_unref(pkt);
+  if (ret < 0 && ret != AVERROR_EOF) {
+    ffmpeg_error(ret, "avcodec_send_packet");
+    return pollux_err_file_read;
+  }
+
+  while ((ret = avcodec_receive_frame(dc, f)) == 0) {
+    int64_t pts = f->best_effort_timestamp;
+
+    if (pts != AV_NOPTS_VALUE && pts >= c->start && pts < c->end) {
+      if (likely(cvt_frame_ff_to_plx(f, &pf))) {
+        ret = e->send_frame(e, &pf);
+        c->frames++;
+      } else {
+        ret = pollux_err_args;
+      }
+    }
+
+    av_frame_unref(f);
+    if (ret)
+      return ret;
+  }
+  if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
+    ffmpeg_error(ret, "avcodec_receive_frame");
+    return pollux_err_file_read;
+  }
+
+  return 0;
+}
+
+/**
+ * @return `pollux_err_t`.
+ */
+static int chunk_encode(chunk_s *c, ffmpeg_decode_t *d, ffmpeg_decode_t *dec,
+                        pollux_encode_t *e) {
+  int ret;
+  AVPacket *pkt = dec->pkt;
+
+  if ((ret = e->param_set(e, c->path, &c->args)) != 0)
+    return ret;
+  if ((ret = e->start(e)) != 0)
+    return ret;
+
+  if (c->start != INT64_MIN && (ret = input_seek(d, c->start)) != 0)
+    goto label_free;
+
+  while ((ret = ffmpeg_decoder_read_packet(d, pkt)) == 0) {
+    if ((pkt->flags & AV_PKT_FLAG_KEY) && packet_pts(pkt) >= c->end) {
+      av_packet_unref(pkt);
+      break;
+    }
+    if ((ret = chunk_decode(c, dec, e, pkt)) != 0)
+      goto label_free;
+  }
+  if (ret && ret != pollux_err_stream_end)
+    goto label_free;
+
+  ret = chunk_decode(c, dec, e, nullptr);
+
+label_free:
+  if (ret) {
+    e->release(e);
+    return ret;
+  }
+
+  return e->stop(e);
+}
+
+static void chunk_thread(void *args) {
+  chunk_s *c = (chunk_s *)args;
+  ffmpeg_decode_t *d, *dec;
+  pollux_encode_t *e;
+
+  if (!(d = input_open(c->ctx, c->url))) {
+    c->ret = pollux_err_file_open;
+    return;
+  }
+  if (!(dec = input_decoder_open(d))) {
+    c->ret = pollux_err_resource_alloc;
+    goto label_free1;
+  }
+  if ((c->ret = pollux_encode_init(&e)) != 0)
+    goto label_free2;
+
+  c->ret = chunk_encode(c, d, dec, e);
+
+  pollux_encode_deinit(e);
+label_free2:
+  ffmpeg_decoder_destroy(&dec);
+label_free1:
+  input_close(&d);
+}
+
+static void remuxer_deinit(remux_ctx_s *ctx) {
+  ffmpeg_encode_t *e = &ctx->encode;
+
+  av_packet_free(&ctx->pkt);
+  ffmpeg_encoder_deinit(e);
+  memset(e, 0, sizeof(ffmpeg_encode_t));
+}
+
+static bool remuxer_init(remux_ctx_s *ctx, const char *url,
+                         const pollux_remux_args_t *args) {
+  ffmpeg_encode_t *e = &ctx->encode;
+  pollux_remux_args_t *rargs = &ctx->args;
+
+  memset(rargs, 0, sizeof(pollux_remux_args_t));
+  if (args)
+    memcpy(rargs, args, sizeof(pollux_remux_args_t));
+
+  if (ffmpeg_encoder_init(e, url, pollux_cont_enum_to_string(rargs->cont_fmt)))
+    return false;
+
+  if (!(ctx->pkt = av_packet_alloc())) {
+    sirius_error("av_packet_alloc failed\n");
+    goto label_free1;
+  }
+
+  ctx->header_flag = false;
+  ctx->finish_flag = false;
+  ctx->last_dts = 0;
+  ctx->next_dts = 0;
+  ctx->packets_written = 0;
+
+  return true;
+
+label_free1:
+  ffmpeg_encoder_deinit(e);
+
+  return false;
+}
+
+static inline void remuxer_release(remux_ctx_s *ctx) {
+  if (!ctx->param_set_flag)
+    return;
+
+  if (ctx->header_flag && !ctx->finish_flag)
+    sirius_warnsp("The output is released without the tail\n");
+  remuxer_deinit(ctx);
+
+  ctx->param_set_flag = false;
+}
+
+static inline int remuxer_param_set(remux_ctx_s *ctx, const char *url,
+                                    const pollux_remux_args_t *args) {
+  if (ctx->param_set_flag)
+    remuxer_deinit(ctx);
+
+  ctx->param_set_flag = false;
+
+  if (!remuxer_init(ctx, url, args))
+    return pollux_err_resource_alloc;
+
+  ctx->param_set_flag = true;
+
+  return 0;
+}
+
+static inline int remuxer_append(remux_ctx_s *ctx, const char *url) {
+  int ret;
+  ffmpeg_decode_t *d;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+  if (unlikely(ctx->finish_flag)) {
+    sirius_error("The output has been finished\n");
+    return pollux_err_not_init;
+  }
+
+  if (!(d = input_open(ctx, url)))
+    return pollux_err_file_open;
+
+  if ((ret = output_prepare(ctx, d)) != 0)
+    goto label_free;
+
+  ret = packets_copy(ctx, d);
+
+label_free:
+  input_close(&d);
+
+  return ret;
+}
+
+static inline int remuxer_cut(remux_ctx_s *ctx, const char *url,
+                              int64_t start_us, int64_t end_us) {
+  int ret;
+  ffmpeg_decode_t *d, *dec;
+  cut_plan_s plan;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+  if (unlikely(ctx->finish_flag)) {
+    sirius_error("The output has been finished\n");
+    return pollux_err_not_init;
+  }
+  if (unlikely(start_us < 0 || end_us <= start_us)) {
+    sirius_error("Invalid range: [%" PRId64 ", %" PRId64 ")\n", start_us,
+                 end_us);
+    return pollux_err_args;
+  }
+
+  if (!(d = input_open(ctx, url)))
+    return pollux_err_file_open;
+
+  AVStream *ist = d->fmt_ctx->streams[d->stream_index];
+  if (!(dec = input_decoder_open(d))) {
+    ret = pollux_err_resource_alloc;
+    goto label_free1;
+  }
+
+  if ((ret = output_prepare(ctx, d)) != 0)
+    goto label_free2;
+
+  int64_t offset = ist->start_time != AV_NOPTS_VALUE ? ist->start_time : 0;
+  plan.start = av_rescale_q(start_us, AV_TIME_BASE_Q, ist->time_base) + offset;
+  plan.end = av_rescale_q(end_us, AV_TIME_BASE_Q, ist->time_base) + offset;
+
+  if ((ret = cut_plan_make(ctx, d, &plan)) != 0)
+    goto label_free2;
+  sirius_debgsp("Cut plan: [%" PRId64 ", %" PRId64 "), copy [%" PRId64
+                ", %" PRId64 ")\n",
+                plan.start, plan.end, plan.copy_start, plan.copy_end);
+
+  ret = cut_write(ctx, d, dec, &plan);
+
+label_free2:
+  ffmpeg_decoder_destroy(&dec);
+label_free1:
+  input_close(&d);
+
+  return ret;
+}
+
+static inline int remuxer_concat(remux_ctx_s *ctx, const char *const *urls,
+                                 int count) {
+  int ret = 0;
+  int copied = 0;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+  if (unlikely(ctx->finish_flag)) {
+    sirius_error("The output has been finished\n");
+    return pollux_err_not_init;
+  }
+
+  for (int i = 0; i < count; ++i) {
+    ffmpeg_decode_t *d;
+
+    if (unlikely(!urls[i]))
+      return pollux_err_args;
+    if (!(d = input_open(ctx, urls[i])))
+      return pollux_err_file_open;
+
+    if (!ctx->header_flag)
+      ret = output_stream_open(ctx, d);
+
+    if (!ret) {
+      if (input_compatible(ctx, d)) {
+        ret = packets_copy(ctx, d);
+        copied++;
+      } else {
+        sirius_warnsp("Incompatible input, re-encoded: %s\n", urls[i]);
+        ret = input_transcode(ctx, d);
+      }
+    }
+
+    input_close(&d);
+    if (ret)
+      return ret;
+  }
+
+  sirius_infosp("%d of %d inputs copied\n", copied, count);
+  return 0;
+}
+
+/**
+ * @brief Fill the encoding parameters left to the input.
+ */
+static void transcode_args_fill(pollux_encode_args_t *args,
+                                const ffmpeg_decode_t *d) {
+  const AVStream *ist = d->fmt_ctx->streams[d->stream_index];
+
+  args->cont_fmt = pollux_cont_fmt_mp4;
+  args->auto_convert = true;
+  args->custom_pts = false;
+  if (args->img.width <= 0 || args->img.height <= 0) {
+    args->img.width = ist->codecpar->width;
+    args->img.height = ist->codecpar->height;
+  }
+  if (args->frame_rate.num <= 0 || args->frame_rate.den <= 0) {
+    AVRational r = ist->avg_frame_rate.num > 0 ? ist->avg_frame_rate
+                                               : ist->r_frame_rate;
+    args->frame_rate.num = r.num;
+    args->frame_rate.den = r.den;
+  }
+}
+
+static inline int remuxer_transcode(remux_ctx_s *ctx, const char *url,
+                                    const pollux_remux_transcode_args_t *args) {
+  int ret, count;
+  ffmpeg_decode_t *d;
+  chunk_s *chunks;
+  pollux_encode_args_t eargs;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+  if (unlikely(ctx->finish_flag)) {
+    sirius_error("The output has been finished\n");
+    return pollux_err_not_init;
+  }
+
+  count = args->chunk_count > 0 ? args->chunk_count : CHUNK_DEFAULT;
+  count = sirius_min(count, CHUNK_MAX);
+  const char *prefix =
+    args->chunk_prefix ? args->chunk_prefix : ctx->encode.fmt_ctx->url;
+
+  chunks = (chunk_s *)calloc(count, sizeof(chunk_s));
+  if (!chunks) {
+    sirius_error("calloc -> 'chunk_s'\n");
+    return pollux_err_memory_alloc;
+  }
+
+  if (!(d = input_open(ctx, url))) {
+    ret = pollux_err_file_open;
+    goto label_free;
+  }
+  memcpy(&eargs, &args->encode, sizeof(pollux_encode_args_t));
+  transcode_args_fill(&eargs, d);
+  ret = chunk_plan_make(ctx, d, chunks, count);
+  input_close(&d);
+  if (ret < 0)
+    goto label_free;
+  count = ret;
+
+  for (int i = 0; i < count; ++i) {
+    chunk_s *c = chunks + i;
+
+    c->ctx = ctx;
+    c->url = url;
+    memcpy(&c->args, &eargs, sizeof(pollux_encode_args_t));
+    snprintf(c->path, sizeof(c->path), "%s.chunk%d.mp4", prefix, i);
+  }
+
+  ret = 0;
+  int started = 0;
+  for (; started < count; ++started) {
+    chunk_s *c = chunks + started;
+    if (sirius_thread_create(&c->thread, nullptr, (void *)chunk_thread,
+                             (void *)c)) {
+      sirius_error("Failed to create the thread of the chunk: %d\n", started);
+      ret = pollux_err_resource_alloc;
+      break;
+    }
+  }
+  for (int i = 0; i < started; ++i) {
+    sirius_thread_join(chunks[i].thread, nullptr);
+    if (!ret && chunks[i].ret) {
+      sirius_error("Failed to encode the chunk: %d\n", i);
+      ret = chunks[i].ret;
+    }
+  }
+
+  for (int i = 0; i < started; ++i) {
+    chunk_s *c = chunks + i;
+
+    if (!ret) {
+      sirius_infosp("Chunk %d: %" PRId64 " frames\n", i, c->frames);
+      ret = remuxer_append(ctx, c->path);
+    }
+    remove(c->path);
+  }
+
+label_free:
+  free(chunks);
+
+  return ret;
+}
+
+static inline int remuxer_finish(remux_ctx_s *ctx) {
+  int ret;
+
+  if (unlikely(!ctx->param_set_flag)) {
+    sirius_error("The resource is uninitialized\n");
+    return pollux_err_not_init;
+  }
+  if (unlikely(!ctx->header_flag || ctx->finish_flag)) {
+    sirius_error("No input has been appended, or the output is finished\n");
+    return pollux_err_not_init;
+  }
+
+  ret = av_write_trailer(ctx->encode.fmt_ctx);
+  if (ret != 0) {
+    ffmpeg_error(ret, "av_write_trailer");
+    return pollux_err_file_write;
+  }
+  ctx->finish_flag = true;
+
+  return 0;
+}
+
+static int ptr_release(pollux_remux_t *h) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  remux_ctx_s *ctx = (remux_ctx_s *)h->priv_data;
+  remuxer_release(ctx);
+
+  return 0;
+}
+
+static int ptr_param_set(pollux_remux_t *h, const char *url,
+                         const pollux_remux_args_t *args) {
+  if (unlikely(!h || !h->priv_data || !url))
+    return pollux_err_entry;
+
+  remux_ctx_s *ctx = (remux_ctx_s *)h->priv_data;
+  return remuxer_param_set(ctx, url, args);
+}
+
+static int ptr_append(pollux_remux_t *h, const char *url) {
+  if (unlikely(!h || !h->priv_data || !url))
+    return pollux_err_entry;
+
+  remux_ctx_s *ctx = (remux_ctx_s *)h->priv_data;
+  return remuxer_append(ctx, url);
+}
+
+static int ptr_cut(pollux_remux_t *h, const char *url, int64_t start_us,
+                   int64_t end_us) {
+  if (unlikely(!h || !h->priv_data || !url))
+    return pollux_err_entry;
+
+  remux_ctx_s *ctx = (remux_ctx_s *)h->priv_data;
+  return remuxer_cut(ctx, url, start_us, end_us);
+}
+
+static int ptr_concat(pollux_remux_t *h, const char *const *urls,
+                      int count) {
+  if (unlikely(!h || !h->priv_data || !urls || count <= 0))
+    return pollux_err_entry;
+
+  remux_ctx_s *ctx = (remux_ctx_s *)h->priv_data;
+  return remuxer_concat(ctx, urls, count);
+}
+
+static int ptr_transcode(pollux_remux_t *h, const char *url,
+                         const pollux_remux_transcode_args_t *args) {
+  if (unlikely(!h || !h->priv_data || !url || !args))
+    return pollux_err_entry;
+
+  remux_ctx_s *ctx = (remux_ctx_s *)h->priv_data;
+  return remuxer_transcode(ctx, url, args);
+}
+
+static int ptr_finish(pollux_remux_t *h) {
+  if (unlikely(!h || !h->priv_data))
+    return pollux_err_entry;
+
+  remux_ctx_s *ctx = (remux_ctx_s *)h->priv_data;
+  return remuxer_finish(ctx);
+}
+
+static inline void ptr_copy(pollux_remux_t *h, remux_ctx_s *ctx) {
+  h->priv_data = (void *)ctx;
+
+  h->release = ptr_release;
+  h->param_set = ptr_param_set;
+  h->append = ptr_append;
+  h->finish = ptr_finish;
+  h->cut = ptr_cut;
+  h->concat = ptr_concat;
+  h->transcode = ptr_transcode;
+}
+
+pollux_api void pollux_remux_deinit(pollux_remux_t *handle) {
+  if (!handle)
+    return;
+  if (!handle->priv_data)
+    goto label_free;
+
+  remux_ctx_s **ctx = (remux_ctx_s **)(&handle->priv_data);
+
+  remuxer_release(*ctx);
+
+  free(*ctx);
+  *ctx = nullptr;
+
+label_free:
+  free(handle);
+}
+
+pollux_api int pollux_remux_init(pollux_remux_t **handle) {
+  int ret = 0;
+
+  pollux_remux_t *h = (pollux_remux_t *)calloc(1, sizeof(pollux_remux_t));
+  if (!h) {
+    sirius_error("calloc -> 'pollux_remux_t'\n");
+    return pollux_err_memory_alloc;
+  }
+
+  remux_ctx_s *ctx = (remux_ctx_s *)calloc(1, sizeof(remux_ctx_s));
+  if (!ctx) {
+    sirius_error("calloc -> 'remux_ctx_s'\n");
+    ret = pollux_err_memory_alloc;
+    goto label_free1;
+  }
+
+  ptr_copy(h, ctx);
+  *handle = h;
+
+  return 0;
+
+label_free1:
+  free(h);
+
+  return ret;
+}
@@ -0,0 +1,153 @@
+/**
+ * @brief Side data test. The motion vectors and the quantization parameters
+ * are exported by the decoder, with and without the image conversion, and
+ * the motion of each frame is summed from the vectors.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+static const int FRAME_COUNT = 100;
+
+static const int SRC_WIDTH = 2560, SRC_HEIGHT = 1440;
+static const int CVT_WIDTH = 1280, CVT_HEIGHT = 720;
+
+#define QP_BLOCKS_MAX (256 * 1024)
+
+typedef struct {
+  int frames;
+  int frames_mvs;
+  int frames_qp;
+  int64_t mvs;
+  int64_t blocks;
+  int mvs_outside;
+} side_count_t;
+
+static void side_data_count(const pollux_frame_t *f, side_count_t *c,
+                            pollux_block_qp_t *blocks) {
+  const pollux_motion_vector_t *mvs;
+  int count;
+  int frame_qp;
+  double motion = 0;
+
+  if (pollux_frame_mvs_get(f, &mvs, &count) == 0) {
+    c->frames_mvs++;
+    c->mvs += count;
+    for (int i = 0; i < count; ++i) {
+      const pollux_motion_vector_t *mv = mvs + i;
+
+      /**
+       * @note The destination is the block of the current frame, in the size
+       * of the source image.
+       */
+      if (mv->dst_x < 0 || mv->dst_y < 0 || mv->dst_x > SRC_WIDTH ||
+          mv->dst_y > SRC_HEIGHT)
+        c->mvs_outside++;
+      if (mv->motion_scale) {
+        motion += (double)(abs(mv->motion_x) + abs(mv->motion_y)) /
+                  mv->motion_scale;
+      }
+    }
+  }
+
+  count = QP_BLOCKS_MAX;
+  if (pollux_frame_qp_get(f, &frame_qp, blocks, &count) == 0) {
+    c->frames_qp++;
+    c->blocks += count;
+    if (c->frames_qp == 1) {
+      sirius_infosp("frame qp %d, %d blocks, first block qp %d\n", frame_qp,
+                    count, count ? blocks[0].qp : frame_qp);
+    }
+  }
+
+  sirius_debgsp("pts %lld: motion %.1f\n", (long long)f->pts, motion);
+}
+
+static int decode_side_data(pollux_decode_t *d, pollux_img_t *img,
+                            pollux_block_qp_t *blocks) {
+  int ret;
+  pollux_decode_args_t args = {0};
+  side_count_t c = {0};
+  pollux_frame_t *f;
+
+  args.cache_count = 4;
+  args.thread_count = 4;
+  args.fmt_cvt_img = img;
+  args.export_side_data = POLLUX_DECODE_EXPORT_MVS | POLLUX_DECODE_EXPORT_QP;
+
+  ret = d->param_set(d, INPUT_URL, &args);
+  if (ret) {
+    sirius_error("param_set: %d\n", ret);
+    return ret;
+  }
+
+  while (c.frames < FRAME_COUNT) {
+    ret = d->result_get(d, &f, 3000);
+    if (ret == pollux_err_stream_end) {
+      break;
+    } else if (ret) {
+      sirius_error("result_get: %d\n", ret);
+      return ret;
+    }
+
+    c.frames++;
+    side_data_count(f, &c, blocks);
+    d->result_free(d, f);
+  }
+  d->release(d);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("conversion: %s\n", img ? "on" : "off");
+  sirius_infosp("\tframes %d; with mvs %d (%lld mvs); with qp %d (%lld "
+                "blocks)\n",
+                c.frames, c.frames_mvs, (long long)c.mvs, c.frames_qp,
+                (long long)c.blocks);
+  sirius_infosp("---------------------\n\n");
+
+  /**
+   * @note The intra frames have no motion vector.
+   */
+  if (c.frames <= 0 || c.frames_mvs <= 0 || c.frames_mvs >= c.frames ||
+      c.frames_qp != c.frames || c.mvs_outside) {
+    sirius_error("Unexpected side data\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_decode_t *d;
+  pollux_img_t img = {CVT_WIDTH, CVT_HEIGHT, 1, pollux_pix_fmt_yuv420p};
+  pollux_block_qp_t *blocks;
+
+  blocks = malloc(sizeof(pollux_block_qp_t) * QP_BLOCKS_MAX);
+  if (!blocks) {
+    ret = -1;
+    goto label_free1;
+  }
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free2;
+
+  ret = decode_side_data(d, nullptr, blocks);
+  if (ret)
+    goto label_free3;
+
+  ret = decode_side_data(d, &img, blocks);
+
+label_free3:
+  pollux_decode_deinit(d);
+label_free2:
+  free(blocks);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
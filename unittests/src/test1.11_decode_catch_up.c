@@ -0,0 +1,132 @@
+/**
+ * @brief Catch-up test. The url is looped and consumed slowly with the
+ * catch-up mode enabled, the catch-up level must rise and frames must be
+ * skipped. Then the results are consumed as fast as possible, and the level
+ * must fall back to full decoding.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+
+static const int CACHE_COUNT = 4;
+static const int CATCH_UP_LAG_MS = 100;
+
+/**
+ * @brief Slower than the frame rate of the url, so that both the cache and the
+ * lag behind the wall clock build up.
+ */
+static const int CONSUME_DELAY_MS = 50;
+static const int SLOW_FRAMES_MAX = 200;
+
+/**
+ * @brief The limit of the fast consumer, unit: us.
+ */
+static const uint64_t FAST_US_MAX = 20 * 1000 * 1000;
+
+static int catch_up_stats(pollux_decode_t *d, pollux_decode_stats_t *stats) {
+  int ret = d->stats_get(d, stats);
+  if (ret)
+    sirius_error("stats_get: %d\n", ret);
+
+  return ret;
+}
+
+static int frame_consume(pollux_decode_t *d, int delay_ms) {
+  pollux_frame_t *f;
+
+  int ret = d->result_get(d, &f, 3000);
+  if (ret) {
+    sirius_error("result_get: %d\n", ret);
+    return ret;
+  }
+
+  if (delay_ms > 0)
+    sirius_usleep(delay_ms * 1000);
+  d->result_free(d, f);
+
+  return 0;
+}
+
+int main() {
+  test_init();
+
+  int ret, max_level = 0, slow_frames = 0, fast_frames = 0;
+  pollux_decode_t *d;
+  pollux_decode_args_t args = {0};
+  pollux_decode_stats_t stats = {0};
+  uint64_t skipped;
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free1;
+
+  args.cache_count = CACHE_COUNT;
+  args.thread_count = 4;
+  args.loop_count = -1;
+  args.catch_up_lag_ms = CATCH_UP_LAG_MS;
+  ret = d->param_set(d, INPUT_URL, &args);
+  if (ret) {
+    sirius_error("param_set: %d\n", ret);
+    goto label_free2;
+  }
+
+  /**
+   * @note The slow consumer, until the decoder only decodes the key frames and
+   * has skipped some of them.
+   */
+  while (slow_frames < SLOW_FRAMES_MAX) {
+    if ((ret = frame_consume(d, CONSUME_DELAY_MS)) != 0)
+      goto label_free3;
+    slow_frames++;
+
+    if ((ret = catch_up_stats(d, &stats)) != 0)
+      goto label_free3;
+    max_level = sirius_max(max_level, stats.catch_up_level);
+    if (stats.catch_up_level == 2 && stats.frames_skipped > 0)
+      break;
+  }
+  skipped = stats.frames_skipped;
+
+  /**
+   * @note The fast consumer, until full decoding is restored.
+   */
+  uint64_t start_us = sirius_get_time_us();
+  while (stats.catch_up_level > 0 &&
+         sirius_get_time_us() - start_us < FAST_US_MAX) {
+    if ((ret = frame_consume(d, 0)) != 0)
+      goto label_free3;
+    fast_frames++;
+
+    if ((ret = catch_up_stats(d, &stats)) != 0)
+      goto label_free3;
+  }
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("\tslow: %d frames, max level: %d, skipped: %llu\n",
+                slow_frames, max_level, (unsigned long long)skipped);
+  sirius_infosp("\tfast: %d frames, level: %d, skipped: %llu\n", fast_frames,
+                stats.catch_up_level,
+                (unsigned long long)stats.frames_skipped);
+  sirius_infosp("\tdecoded: %llu\n", (unsigned long long)stats.frames_decoded);
+  sirius_infosp("---------------------\n\n");
+
+  if (max_level == 0 || skipped == 0) {
+    sirius_error("The decoder did not catch up\n");
+    ret = -1;
+  } else if (stats.catch_up_level != 0) {
+    sirius_error("Full decoding is not restored\n");
+    ret = -1;
+  }
+
+label_free3:
+  d->release(d);
+label_free2:
+  pollux_decode_deinit(d);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
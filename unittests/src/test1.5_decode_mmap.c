@@ -0,0 +1,118 @@
+/**
+ * @brief Benchmark of the memory-mapped input and the readahead thread against
+ * the default `file:` protocol of ffmpeg. The packets of each input are read
+ * to the end once with each backend through the demuxer, without decoding, so
+ * that only the input is timed, and the elapsed time is compared.
+ */
+
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *INPUT_URLS[] = {
+  "./input1_2560-1440_video.mp4",
+  "./input2_3506-2200_video.avi",
+  "./input5_1920-1080_video.dav",
+};
+
+static const int CACHE_COUNT = 16;
+static const int PREFETCH_SIZE_MB = 32;
+
+typedef enum {
+  IO_FILE,
+  IO_MMAP,
+  IO_PREFETCH,
+} io_mode_t;
+
+/**
+ * @return The number of packets read, or a negative error code.
+ */
+static int demux_to_end(pollux_demux_t *dm, const char *url, io_mode_t mode,
+                        uint64_t *elapsed_us) {
+  int ret, count = 0;
+  pollux_demux_args_t args = {0};
+  pollux_packet_t *p;
+
+  args.cache_count = CACHE_COUNT;
+  args.mmap_enable = mode == IO_MMAP;
+  args.prefetch_size_mb = mode == IO_PREFETCH ? PREFETCH_SIZE_MB : 0;
+
+  uint64_t start = sirius_get_time_us();
+
+  ret = dm->param_set(dm, url, &args);
+  if (ret) {
+    sirius_error("param_set: %d\n", ret);
+    return ret;
+  }
+
+  while (true) {
+    ret = dm->read_packet(dm, &p, 2000);
+    if (ret == pollux_err_stream_end) {
+      break;
+    } else if (ret) {
+      sirius_error("read_packet: %d\n", ret);
+      dm->release(dm);
+      return ret;
+    }
+
+    count++;
+    dm->packet_free(dm, p);
+  }
+
+  dm->release(dm);
+  *elapsed_us = sirius_get_time_us() - start;
+
+  return count;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_demux_t *dm;
+
+  ret = pollux_demux_init(&dm);
+  if (ret)
+    goto label_free1;
+
+  for (size_t i = 0; i < sizeof(INPUT_URLS) / sizeof(INPUT_URLS[0]); ++i) {
+    const char *url = INPUT_URLS[i];
+    uint64_t us_file = 0, us_mmap = 0, us_prefetch = 0;
+
+    /**
+     * @note Warm up the page cache, so that both backends read from memory.
+     */
+    ret = demux_to_end(dm, url, IO_FILE, &us_file);
+    if (ret < 0)
+      goto label_free2;
+
+    int n_file = demux_to_end(dm, url, IO_FILE, &us_file);
+    int n_mmap = demux_to_end(dm, url, IO_MMAP, &us_mmap);
+    int n_prefetch = demux_to_end(dm, url, IO_PREFETCH, &us_prefetch);
+    if (n_file < 0 || n_mmap < 0 || n_prefetch < 0) {
+      ret = -1;
+      goto label_free2;
+    }
+    if (n_file != n_mmap || n_file != n_prefetch) {
+      sirius_error("Packet count mismatch, file: %d; mmap: %d; prefetch: %d\n",
+                   n_file, n_mmap, n_prefetch);
+      ret = -1;
+      goto label_free2;
+    }
+
+    sirius_infosp("---------------------\n");
+    sirius_infosp("%s, packets: %d\n", url, n_file);
+    sirius_infosp("\tfile: %llu us\n", (unsigned long long)us_file);
+    sirius_infosp("\tmmap: %llu us\n", (unsigned long long)us_mmap);
+    sirius_infosp("\tprefetch: %llu us\n", (unsigned long long)us_prefetch);
+    sirius_infosp("---------------------\n\n");
+  }
+  ret = 0;
+
+label_free2:
+  pollux_demux_deinit(dm);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
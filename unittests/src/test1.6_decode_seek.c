@@ -0,0 +1,109 @@
+/**
+ * @brief Scrubbing test. Seeks are issued in bursts while the decoding thread
+ * is running, without draining the results, and the first frame returned after
+ * the last seek must belong to the seek target.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+
+static const int SEEK_ROUNDS = 8;
+static const int SEEK_BURST = 32;
+static const int FRAMES_PER_ROUND = 5;
+
+static int frame_pts_get(pollux_decode_t *d, int64_t *pts) {
+  int ret;
+  pollux_frame_t *f;
+
+  ret = d->result_get(d, &f, 3000);
+  if (ret) {
+    sirius_error("result_get: %d\n", ret);
+    return ret;
+  }
+
+  *pts = f->pts;
+  d->result_free(d, f);
+
+  return 0;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  int64_t first_pts, pts;
+  pollux_rational tb;
+  pollux_decode_t *d;
+  pollux_decode_args_t args = {0};
+
+  args.cache_count = 16;
+  args.thread_count = 4;
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free1;
+
+  ret = d->param_set(d, INPUT_URL, &args);
+  if (ret) {
+    sirius_error("param_set: %d\n", ret);
+    goto label_free2;
+  }
+
+  ret = frame_pts_get(d, &first_pts);
+  if (ret)
+    goto label_free2;
+
+  /**
+   * @note Stream duration in the time base of the stream, which is also the
+   * one of the decoded frames.
+   */
+  tb = d->stream.time_base;
+  int64_t duration = d->stream.duration * tb.den / ((int64_t)tb.num * 1000000);
+
+  for (int round = 0; round < SEEK_ROUNDS; ++round) {
+    for (int i = 0; i < SEEK_BURST; ++i) {
+      int64_t ts = duration * ((round * SEEK_BURST + i) % 100) / 100;
+
+      ret = d->seek_file(d, 0, ts, ts);
+      if (ret) {
+        sirius_error("seek_file: %d\n", ret);
+        goto label_free2;
+      }
+    }
+
+    ret = d->seek_file(d, 0, 0, 0);
+    if (ret) {
+      sirius_error("seek_file: %d\n", ret);
+      goto label_free2;
+    }
+
+    for (int i = 0; i < FRAMES_PER_ROUND; ++i) {
+      ret = frame_pts_get(d, &pts);
+      if (ret)
+        goto label_free2;
+
+      if (i == 0 && pts != first_pts) {
+        sirius_error("Stale frame after seek, pts: %lld; expected: %lld\n",
+                     (long long)pts, (long long)first_pts);
+        ret = -1;
+        goto label_free2;
+      }
+    }
+  }
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("%d rounds of %d seeks, no stale frame\n", SEEK_ROUNDS,
+                SEEK_BURST + 1);
+  sirius_infosp("---------------------\n\n");
+  ret = 0;
+
+label_free2:
+  pollux_decode_deinit(d);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,92 @@
+/**
+ * @brief Auto-loop test. The url is decoded once without looping and once with
+ * `loop_count`, the looped run must deliver `loop_count + 1` times the frames
+ * with strictly increasing timestamps.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+
+static const int LOOP_COUNT = 2;
+
+/**
+ * @return The number of decoded frames, or a negative error code.
+ */
+static int decode_to_end(pollux_decode_t *d, int loop_count) {
+  int ret, count = 0;
+  int64_t last_pts = INT64_MIN;
+  pollux_decode_args_t args = {0};
+  pollux_frame_t *f;
+
+  args.cache_count = 16;
+  args.thread_count = 4;
+  args.loop_count = loop_count;
+
+  ret = d->param_set(d, INPUT_URL, &args);
+  if (ret) {
+    sirius_error("param_set: %d\n", ret);
+    return ret;
+  }
+
+  while (true) {
+    ret = d->result_get(d, &f, 3000);
+    if (ret == pollux_err_stream_end) {
+      break;
+    } else if (ret) {
+      sirius_error("result_get: %d\n", ret);
+      goto label_free;
+    }
+
+    if (f->pts <= last_pts) {
+      sirius_error("Non-monotonic pts: %lld after %lld\n", (long long)f->pts,
+                   (long long)last_pts);
+      d->result_free(d, f);
+      ret = -1;
+      goto label_free;
+    }
+    last_pts = f->pts;
+
+    count++;
+    d->result_free(d, f);
+  }
+  ret = count;
+
+label_free:
+  d->release(d);
+  return ret;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_decode_t *d;
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free1;
+
+  int n_once = decode_to_end(d, 0);
+  int n_loop = decode_to_end(d, LOOP_COUNT);
+  if (n_once <= 0 || n_loop < 0) {
+    ret = -1;
+    goto label_free2;
+  }
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("once: %d frames; loop (%d): %d frames\n", n_once, LOOP_COUNT,
+                n_loop);
+  sirius_infosp("---------------------\n\n");
+
+  ret = n_loop == n_once * (LOOP_COUNT + 1) ? 0 : -1;
+
+label_free2:
+  pollux_decode_deinit(d);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
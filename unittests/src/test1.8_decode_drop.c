@@ -0,0 +1,90 @@
+/**
+ * @brief Backpressure test. A slow consumer fetches the results with each drop
+ * policy, the frames that are neither fetched nor dropped indicate a leak in
+ * the accounting.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+
+static const int CACHE_COUNT = 2;
+static const int CONSUME_DELAY_MS = 20;
+
+static int decode_slow(pollux_decode_t *d, pollux_decode_drop_policy_t policy) {
+  int ret, fetched = 0;
+  pollux_decode_args_t args = {0};
+  pollux_decode_stats_t stats;
+  pollux_frame_t *f;
+
+  args.cache_count = CACHE_COUNT;
+  args.thread_count = 4;
+  args.drop_policy = policy;
+
+  ret = d->param_set(d, INPUT_URL, &args);
+  if (ret) {
+    sirius_error("param_set: %d\n", ret);
+    return ret;
+  }
+
+  while (true) {
+    ret = d->result_get(d, &f, 3000);
+    if (ret == pollux_err_stream_end) {
+      break;
+    } else if (ret) {
+      sirius_error("result_get: %d\n", ret);
+      goto label_free;
+    }
+
+    fetched++;
+    sirius_usleep(CONSUME_DELAY_MS * 1000);
+    d->result_free(d, f);
+  }
+
+  ret = d->stats_get(d, &stats);
+  if (ret)
+    goto label_free;
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("policy: %d\n", policy);
+  sirius_infosp("\tdecoded: %llu\n", (unsigned long long)stats.frames_decoded);
+  sirius_infosp("\tdropped: %llu\n", (unsigned long long)stats.frames_dropped);
+  sirius_infosp("\tfetched: %d\n", fetched);
+  sirius_infosp("---------------------\n\n");
+
+  if (stats.frames_decoded != stats.frames_dropped + fetched) {
+    sirius_error("Inconsistent statistics\n");
+    ret = -1;
+  } else if (policy == pollux_decode_drop_block) {
+    ret = stats.frames_dropped == 0 ? 0 : -1;
+  } else {
+    ret = stats.frames_dropped > 0 ? 0 : -1;
+  }
+
+label_free:
+  d->release(d);
+  return ret;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_decode_t *d;
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free1;
+
+  ret = decode_slow(d, pollux_decode_drop_block);
+  ret |= decode_slow(d, pollux_decode_drop_oldest);
+  ret |= decode_slow(d, pollux_decode_drop_newest);
+
+  pollux_decode_deinit(d);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,164 @@
+/**
+ * @brief Band output test. H.264 has no band output, so `param_set` must fail
+ * for it. The codec of the second input is probed with ffmpeg, and when it has
+ * the band capability, `param_set` must succeed and the rows handed to the
+ * band callback are counted, with and without the image conversion. The time
+ * of the first band of a frame is compared with the time the frame is returned
+ * by `result_get`.
+ */
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *H264_URL = "./input1_2560-1440_video.mp4";
+static const char *INPUT_URL = "./input2_3506-2200_video.avi";
+static const int FRAME_COUNT = 100;
+
+static const int CVT_WIDTH = 1280, CVT_HEIGHT = 720;
+
+typedef struct {
+  int bands;
+  int64_t rows;
+
+  /**
+   * @brief The time of the first band of the current frame, unit: us.
+   */
+  uint64_t first_band_us;
+  uint64_t lead_us_sum;
+} band_count_t;
+
+static void band_cb(void *opaque, const pollux_frame_t *frame, int y,
+                    int height) {
+  band_count_t *c = (band_count_t *)opaque;
+
+  if (y == 0)
+    c->first_band_us = sirius_get_time_us();
+  c->bands++;
+  c->rows += height;
+}
+
+/**
+ * @return 1 when the decoder of the url has the band capability of ffmpeg, 0
+ * when it does not, or a negative error code.
+ */
+static int band_capable(const char *url) {
+  int ret;
+  AVFormatContext *fmt_ctx = nullptr;
+  const AVCodec *codec = nullptr;
+
+  ret = avformat_open_input(&fmt_ctx, url, nullptr, nullptr);
+  if (ret < 0) {
+    sirius_error("avformat_open_input: %s\n", url);
+    return ret;
+  }
+
+  ret = avformat_find_stream_info(fmt_ctx, nullptr);
+  if (ret >= 0)
+    ret = av_find_best_stream(fmt_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, &codec, 0);
+  if (ret < 0)
+    sirius_error("No video decoder: %s\n", url);
+  else
+    ret = codec->capabilities & AV_CODEC_CAP_DRAW_HORIZ_BAND ? 1 : 0;
+
+  avformat_close_input(&fmt_ctx);
+  return ret;
+}
+
+static int decode_bands(pollux_decode_t *d, pollux_img_t *img) {
+  int ret, frames = 0;
+  pollux_decode_args_t args = {0};
+  band_count_t c = {0};
+  pollux_frame_t *f;
+
+  ret = band_capable(INPUT_URL);
+  if (ret <= 0) {
+    if (ret == 0)
+      sirius_warnsp("The codec of the input has no band output, skip\n");
+    return ret;
+  }
+
+  args.cache_count = 4;
+  args.thread_count = 1;
+  args.fmt_cvt_img = img;
+  args.band_cb = band_cb;
+  args.band_opaque = &c;
+
+  ret = d->param_set(d, INPUT_URL, &args);
+  if (ret) {
+    sirius_error("param_set: %d\n", ret);
+    return ret;
+  }
+
+  while (frames < FRAME_COUNT) {
+    ret = d->result_get(d, &f, 3000);
+    if (ret == pollux_err_stream_end) {
+      break;
+    } else if (ret) {
+      sirius_error("result_get: %d\n", ret);
+      goto label_free;
+    }
+
+    c.lead_us_sum += sirius_get_time_us() - c.first_band_us;
+    frames++;
+    d->result_free(d, f);
+  }
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("%s: %d frames, %d bands, %lld rows\n",
+                img ? "convert" : "source", frames, c.bands, (long long)c.rows);
+  if (frames)
+    sirius_infosp("\tfirst band ahead of the frame: %llu us\n",
+                  (unsigned long long)(c.lead_us_sum / frames));
+  sirius_infosp("---------------------\n\n");
+
+  ret = c.bands > 0 ? 0 : -1;
+
+label_free:
+  d->release(d);
+  return ret;
+}
+
+/**
+ * @return 0 when `param_set` fails for the H.264 input, -1 otherwise.
+ */
+static int h264_reject(pollux_decode_t *d) {
+  pollux_decode_args_t args = {0};
+  band_count_t c = {0};
+
+  args.cache_count = 4;
+  args.band_cb = band_cb;
+  args.band_opaque = &c;
+
+  if (!d->param_set(d, H264_URL, &args)) {
+    sirius_error("The band output of H.264 is not rejected\n");
+    d->release(d);
+    return -1;
+  }
+  return 0;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_decode_t *d;
+  pollux_img_t img = {CVT_WIDTH, CVT_HEIGHT, 1, pollux_pix_fmt_yuv420p};
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free1;
+
+  ret = h264_reject(d);
+  ret |= decode_bands(d, nullptr);
+  ret |= decode_bands(d, &img);
+
+  pollux_decode_deinit(d);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,195 @@
+/**
+ * @brief Ladder test. The input is decoded once and encoded into three rungs.
+ * The outputs are checked by analyzing them, the numbers of frames must match
+ * and all the rungs must have exactly the same key frames, one for each GOP.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_erron.h"
+#include "pollux/pollux_ladder.h"
+#include "test_media.h"
+
+#define RUNG_COUNT (3)
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+static const char *OUTPUT_URLS[RUNG_COUNT] = {
+  test_generated_pre "2.10_ladder_720p.mp4",
+  test_generated_pre "2.10_ladder_480p.mp4",
+  test_generated_pre "2.10_ladder_360p.mp4",
+};
+static const int SIZES[RUNG_COUNT][2] = {
+  {1280, 720},
+  {852, 480},
+  {640, 360},
+};
+static const int BIT_RATES[RUNG_COUNT] = {
+  3 * 1024 * 1024,
+  1536 * 1024,
+  768 * 1024,
+};
+static const int FPS = 30;
+static const int GOP_SIZE = 30;
+static const int FRAME_COUNT = 150;
+
+static bool key_frame_find(const test_key_frames_t *k, int64_t pts) {
+  for (int i = 0; i < k->count; ++i) {
+    if (k->pts[i] == pts)
+      return true;
+  }
+  return false;
+}
+
+/**
+ * @return The number of key frames of the first rung at the same timestamp in
+ * all the rungs.
+ */
+static int key_frames_aligned(const test_key_frames_t *keys) {
+  int count = 0;
+
+  for (int i = 0; i < keys[0].count; ++i) {
+    int j = 1;
+    while (j < RUNG_COUNT && key_frame_find(keys + j, keys[0].pts[i]))
+      j++;
+    if (j == RUNG_COUNT)
+      count++;
+  }
+  return count;
+}
+
+/**
+ * @return The number of frames sent, or a negative error code.
+ */
+static int frames_send(pollux_ladder_t *l) {
+  int ret, count = 0;
+  pollux_decode_t *d;
+  pollux_decode_args_t args = {0};
+  pollux_frame_t *f;
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    return ret;
+
+  args.cache_count = 8;
+  args.thread_count = 4;
+  ret = d->param_set(d, INPUT_URL, &args);
+  if (ret) {
+    sirius_error("decode param_set: %d\n", ret);
+    goto label_free;
+  }
+
+  while (count < FRAME_COUNT) {
+    ret = d->result_get(d, &f, 3000);
+    if (ret == pollux_err_stream_end) {
+      break;
+    } else if (ret) {
+      sirius_error("result_get: %d\n", ret);
+      goto label_free;
+    }
+
+    ret = l->send_frame(l, f);
+    d->result_free(d, f);
+    if (ret) {
+      sirius_error("send_frame: %d\n", ret);
+      goto label_free;
+    }
+    count++;
+  }
+  ret = count;
+
+label_free:
+  pollux_decode_deinit(d);
+  return ret;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_ladder_t *l;
+  pollux_ladder_rung_t rungs[RUNG_COUNT] = {0};
+  pollux_ladder_args_t args = {rungs, RUNG_COUNT};
+  pollux_demux_analysis_t r[RUNG_COUNT];
+  static test_key_frames_t keys[RUNG_COUNT];
+
+  for (int i = 0; i < RUNG_COUNT; ++i) {
+    pollux_encode_args_t *eargs = &rungs[i].args;
+
+    rungs[i].url = OUTPUT_URLS[i];
+    eargs->cont_fmt = pollux_cont_fmt_mp4;
+    eargs->bit_rate = BIT_RATES[i];
+    eargs->img.width = SIZES[i][0];
+    eargs->img.height = SIZES[i][1];
+    eargs->img.fmt = pollux_pix_fmt_yuv420p;
+    eargs->frame_rate.num = FPS;
+    eargs->frame_rate.den = 1;
+    eargs->gop_size = GOP_SIZE;
+    eargs->thread_count = 4;
+    eargs->codec_id = pollux_codec_id_h264;
+  }
+
+  ret = pollux_ladder_init(&l);
+  if (ret)
+    goto label_free1;
+
+  ret = l->param_set(l, &args);
+  if (ret) {
+    sirius_error("ladder param_set: %d\n", ret);
+    goto label_free2;
+  }
+
+  ret = l->start(l);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free2;
+  }
+
+  uint64_t t0 = sirius_get_time_us();
+  int frames = frames_send(l);
+  int stop_ret = l->stop(l);
+  uint64_t t1 = sirius_get_time_us();
+  ret = frames < 0 ? frames : stop_ret;
+  l->release(l);
+  if (ret)
+    goto label_free2;
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("encode time: %llu us; frames %d\n",
+                (unsigned long long)(t1 - t0), frames);
+  for (int i = 0; i < RUNG_COUNT; ++i) {
+    ret = test_output_analyze(OUTPUT_URLS[i], keys + i, r + i);
+    if (ret)
+      break;
+    sirius_infosp("\t[%dx%d] frames %lld; keys %d\n", SIZES[i][0],
+                  SIZES[i][1], (long long)r[i].frames, keys[i].count);
+
+    if (r[i].frames != frames) {
+      sirius_error("Unexpected number of frames\n");
+      ret = -1;
+      break;
+    }
+  }
+
+  int aligned = ret ? 0 : key_frames_aligned(keys);
+  int expected = (frames + GOP_SIZE - 1) / GOP_SIZE;
+  sirius_infosp("\taligned key frames %d; expected %d\n", aligned, expected);
+  sirius_infosp("---------------------\n\n");
+
+  for (int i = 1; !ret && i < RUNG_COUNT; ++i) {
+    if (keys[i].count != keys[0].count) {
+      sirius_error("Unaligned key frames\n");
+      ret = -1;
+    }
+  }
+  if (!ret && (aligned != keys[0].count || aligned != expected)) {
+    sirius_error("Unaligned key frames\n");
+    ret = -1;
+  }
+
+label_free2:
+  pollux_ladder_deinit(l);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,150 @@
+/**
+ * @brief Segment test. Ten seconds of frames are encoded by one encoder into
+ * segments of two seconds and a playlist. Each segment is checked by analyzing
+ * it, it must start with a key frame, and the numbers of frames must add up.
+ * The segments of mp4 must be rejected.
+ */
+
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test_media.h"
+
+static const char *OUTPUT_URL = test_generated_pre "2.11_segment_%d.ts";
+static const char *MP4_URL = test_generated_pre "2.11_segment_%d.mp4";
+static const char *PLAYLIST_URL = test_generated_pre "2.11_segment.m3u8";
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int FPS = 30;
+static const int SEGMENT_SECONDS = 2;
+static const int FRAME_COUNT = 300;
+
+/**
+ * @return The number of segments in the playlist, or -1 when it is not ended.
+ */
+static int playlist_count(void) {
+  char line[1024];
+  int count = 0;
+  bool end = false;
+  FILE *fp = fopen(PLAYLIST_URL, "r");
+
+  if (!fp)
+    return -1;
+  while (fgets(line, sizeof(line), fp)) {
+    if (!strncmp(line, "#EXTINF:", 8))
+      count++;
+    else if (!strncmp(line, "#EXT-X-ENDLIST", 14))
+      end = true;
+  }
+  fclose(fp);
+
+  return end ? count : -1;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_encode_t *e;
+  pollux_encode_args_t args = {0};
+  pollux_img_t img = {WIDTH, HEIGHT, 1, pollux_pix_fmt_yuv420p};
+  pollux_frame_t *f;
+  int segments = FRAME_COUNT / (FPS * SEGMENT_SECONDS);
+  int64_t frames = 0;
+
+  ret = pollux_frame_alloc(&img, &f);
+  if (ret)
+    goto label_free1;
+
+  ret = pollux_encode_init(&e);
+  if (ret)
+    goto label_free2;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  args.bit_rate = 4 * 1024 * 1024;
+  args.img = img;
+  args.frame_rate.num = FPS;
+  args.frame_rate.den = 1;
+  args.gop_size = 5 * FPS;
+  args.thread_count = 4;
+  args.codec_id = pollux_codec_id_h264;
+  args.segment_seconds = SEGMENT_SECONDS;
+  args.playlist_url = PLAYLIST_URL;
+
+  /**
+   * @note The playlist is only valid for the segments of mpegts.
+   */
+  if (!e->param_set(e, MP4_URL, &args)) {
+    sirius_error("The segments of mp4 are not rejected\n");
+    ret = -1;
+    goto label_free3;
+  }
+
+  args.cont_fmt = pollux_cont_fmt_mpegts;
+  ret = e->param_set(e, OUTPUT_URL, &args);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    goto label_free3;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free3;
+  }
+
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    test_frame_fill(f, i);
+    ret = e->send_frame(e, f);
+    if (ret) {
+      sirius_error("send_frame: %d\n", ret);
+      break;
+    }
+  }
+  int stop_ret = e->stop(e);
+  ret = ret ? ret : stop_ret;
+  e->release(e);
+  if (ret)
+    goto label_free3;
+
+  sirius_infosp("---------------------\n");
+  for (int i = 0; i < segments; ++i) {
+    char url[1024];
+    pollux_demux_analysis_t r;
+    test_key_frames_t k;
+
+    snprintf(url, sizeof(url), OUTPUT_URL, i);
+    ret = test_output_analyze(url, &k, &r);
+    if (ret)
+      break;
+    sirius_infosp("\t%s: frames %lld; first key %d\n", url,
+                  (long long)r.frames, k.first_key);
+
+    if (!k.first_key) {
+      sirius_error("The segment does not start with a key frame\n");
+      ret = -1;
+      break;
+    }
+    frames += r.frames;
+  }
+
+  int listed = playlist_count();
+  sirius_infosp("\tframes %lld; expected %d\n", (long long)frames,
+                FRAME_COUNT);
+  sirius_infosp("\tlisted segments %d; expected %d\n", listed, segments);
+  sirius_infosp("---------------------\n\n");
+
+  if (!ret && (frames != FRAME_COUNT || listed != segments)) {
+    sirius_error("Unexpected segments\n");
+    ret = -1;
+  }
+
+label_free3:
+  pollux_encode_deinit(e);
+label_free2:
+  pollux_frame_free(&f);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
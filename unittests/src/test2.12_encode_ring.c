@@ -0,0 +1,114 @@
+/**
+ * @brief Ring test. Ten seconds of frames are encoded into memory, and an
+ * event is triggered in the middle of them. The event is checked by analyzing
+ * it, it must start with a key frame and hold the frames of the ring before
+ * the trigger and the ones after it.
+ */
+
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test_media.h"
+
+static const char *OUTPUT_URL = test_generated_pre "2.12_event_%d.mp4";
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int FPS = 30;
+static const int GOP_SIZE = 30;
+static const int RING_SECONDS = 2;
+static const int POST_SECONDS = 2;
+static const int TRIGGER_FRAME = 150;
+static const int FRAME_COUNT = 300;
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_encode_t *e;
+  pollux_encode_args_t args = {0};
+  pollux_img_t img = {WIDTH, HEIGHT, 1, pollux_pix_fmt_yuv420p};
+  pollux_frame_t *f;
+  pollux_demux_analysis_t r;
+  test_key_frames_t k;
+  char url[1024];
+
+  ret = pollux_frame_alloc(&img, &f);
+  if (ret)
+    goto label_free1;
+
+  ret = pollux_encode_init(&e);
+  if (ret)
+    goto label_free2;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  args.bit_rate = 4 * 1024 * 1024;
+  args.img = img;
+  args.frame_rate.num = FPS;
+  args.frame_rate.den = 1;
+  args.gop_size = GOP_SIZE;
+  args.thread_count = 4;
+  args.codec_id = pollux_codec_id_h264;
+  args.ring_seconds = RING_SECONDS;
+  ret = e->param_set(e, OUTPUT_URL, &args);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    goto label_free3;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free3;
+  }
+
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    if (i == TRIGGER_FRAME && (ret = e->trigger(e, POST_SECONDS)) != 0) {
+      sirius_error("trigger: %d\n", ret);
+      break;
+    }
+
+    test_frame_fill(f, i);
+    ret = e->send_frame(e, f);
+    if (ret) {
+      sirius_error("send_frame: %d\n", ret);
+      break;
+    }
+  }
+  int stop_ret = e->stop(e);
+  ret = ret ? ret : stop_ret;
+  e->release(e);
+  if (ret)
+    goto label_free3;
+
+  snprintf(url, sizeof(url), OUTPUT_URL, 0);
+  ret = test_output_analyze(url, &k, &r);
+  if (ret)
+    goto label_free3;
+
+  /**
+   * @note The ring holds at least `RING_SECONDS` and less than two more GOPs
+   * before the trigger, since it is trimmed by whole GOPs.
+   */
+  int min_frames = (RING_SECONDS + POST_SECONDS) * FPS;
+  int max_frames = min_frames + 2 * GOP_SIZE;
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("\t%s: frames %lld; first key %d\n", url, (long long)r.frames,
+                k.first_key);
+  sirius_infosp("\texpected frames: [%d, %d)\n", min_frames, max_frames);
+  sirius_infosp("---------------------\n\n");
+
+  if (!k.first_key || r.frames < min_frames || r.frames >= max_frames) {
+    sirius_error("Unexpected event\n");
+    ret = -1;
+  }
+
+label_free3:
+  pollux_encode_deinit(e);
+label_free2:
+  pollux_frame_free(&f);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,180 @@
+/**
+ * @brief Tee test. The frames are encoded once and written to a `mp4` file, a
+ * `mpegts` file, a sink in memory and a slow sink, which stalls at the start.
+ * The outputs are checked by analyzing them, the numbers of frames must match
+ * except for the slow sink, whose packets must be dropped while it is stalled
+ * and resume on a key frame.
+ */
+
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test_media.h"
+
+#define OUTPUT_COUNT (2)
+
+static const char *OUTPUT_URLS[OUTPUT_COUNT] = {
+  test_generated_pre "2.13_tee.mp4",
+  test_generated_pre "2.13_tee.ts",
+};
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int FPS = 30;
+static const int FRAME_COUNT = 150;
+static const int PACKET_CACHE_COUNT = 8;
+
+/**
+ * @brief The slow sink takes `SLOW_MS` for each of its first `SLOW_PACKETS`
+ * packets, far longer than the encoder for its queue.
+ */
+static const int SLOW_PACKETS = 10;
+static const int SLOW_MS = 50;
+
+typedef struct {
+  int packets;
+  int key_packets;
+  bool first_key;
+
+  /**
+   * @brief For the slow sink, the number of gaps in the packets, and the
+   * number of them which do not resume on a key frame.
+   */
+  bool slow;
+  int64_t last_dts;
+  int gaps;
+  int bad_resumes;
+} sink_s;
+
+static void sink_cb(const pollux_packet_t *packet, void *opaque) {
+  sink_s *k = (sink_s *)opaque;
+  bool key = packet->flags & POLLUX_PACKET_FLAG_KEY;
+
+  if (k->packets++ == 0)
+    k->first_key = key;
+  k->key_packets += key;
+
+  if (!k->slow)
+    return;
+
+  /**
+   * @note The dts of the packets increase by one frame each, a longer step is a
+   * gap.
+   */
+  pollux_rational tb = packet->time_base;
+  if (k->packets > 1 &&
+      (packet->dts - k->last_dts) * FPS * tb.num * 2 > (int64_t)tb.den * 3) {
+    k->gaps++;
+    k->bad_resumes += !key;
+  }
+  k->last_dts = packet->dts;
+
+  if (k->packets <= SLOW_PACKETS)
+    sirius_usleep(SLOW_MS * 1000);
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_encode_t *e;
+  pollux_encode_args_t args = {0};
+  pollux_img_t img = {WIDTH, HEIGHT, 1, pollux_pix_fmt_yuv420p};
+  pollux_frame_t *f;
+  pollux_demux_analysis_t r;
+  sink_s sink = {0};
+  sink_s slow = {.slow = true};
+
+  ret = pollux_frame_alloc(&img, &f);
+  if (ret)
+    goto label_free1;
+
+  ret = pollux_encode_init(&e);
+  if (ret)
+    goto label_free2;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  args.bit_rate = 4 * 1024 * 1024;
+  args.img = img;
+  args.frame_rate.num = FPS;
+  args.frame_rate.den = 1;
+  args.gop_size = FPS;
+  args.thread_count = 4;
+  args.codec_id = pollux_codec_id_h264;
+  args.packet_cache_count = PACKET_CACHE_COUNT;
+  ret = e->param_set(e, OUTPUT_URLS[0], &args);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    goto label_free3;
+  }
+
+  ret = e->output_add(e, OUTPUT_URLS[1], pollux_cont_fmt_mpegts);
+  if (!ret)
+    ret = e->output_add_sink(e, sink_cb, &sink);
+  if (!ret)
+    ret = e->output_add_sink(e, sink_cb, &slow);
+  if (ret) {
+    sirius_error("output_add: %d\n", ret);
+    goto label_free3;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free3;
+  }
+
+  uint64_t t0 = sirius_get_time_us();
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    test_frame_fill(f, i);
+    ret = e->send_frame(e, f);
+    if (ret) {
+      sirius_error("send_frame: %d\n", ret);
+      break;
+    }
+  }
+  int stop_ret = e->stop(e);
+  uint64_t t1 = sirius_get_time_us();
+  ret = ret ? ret : stop_ret;
+  e->release(e);
+  if (ret)
+    goto label_free3;
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("encode time: %llu us\n", (unsigned long long)(t1 - t0));
+  for (int i = 0; i < OUTPUT_COUNT; ++i) {
+    ret = test_output_analyze(OUTPUT_URLS[i], nullptr, &r);
+    if (ret)
+      break;
+    sirius_infosp("\t%s: frames %lld\n", OUTPUT_URLS[i], (long long)r.frames);
+
+    if (r.frames != FRAME_COUNT) {
+      sirius_error("Unexpected number of frames\n");
+      ret = -1;
+      break;
+    }
+  }
+  sirius_infosp("\tsink: packets %d; key packets %d; first key %d\n",
+                sink.packets, sink.key_packets, sink.first_key);
+  sirius_infosp("\tslow sink: packets %d; gaps %d; bad resumes %d\n",
+                slow.packets, slow.gaps, slow.bad_resumes);
+  sirius_infosp("---------------------\n\n");
+
+  if (!ret && (sink.packets != FRAME_COUNT || !sink.first_key)) {
+    sirius_error("Unexpected packets of the sink\n");
+    ret = -1;
+  }
+  if (!ret && (slow.packets >= FRAME_COUNT || slow.gaps == 0 ||
+               slow.bad_resumes || !slow.first_key)) {
+    sirius_error("Unexpected packets of the slow sink\n");
+    ret = -1;
+  }
+
+label_free3:
+  pollux_encode_deinit(e);
+label_free2:
+  pollux_frame_free(&f);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
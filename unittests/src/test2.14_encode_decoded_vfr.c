@@ -0,0 +1,157 @@
+/**
+ * @brief Decode to encode variable frame rate test. The frames of a file are
+ * decoded, every third one is dropped, and the rest are encoded with the
+ * timestamps of the decoder, in the time base it sets to the frames. The
+ * output is checked by analyzing it, the span of the timestamps must be the
+ * one of the source frames.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test_media.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+static const char *OUTPUT_URL = test_generated_pre "2.14_decoded_vfr.mp4";
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int FRAME_COUNT = 150;
+
+/**
+ * @brief The tolerance of the span, unit: us.
+ */
+static const int64_t SPAN_TOLERANCE = 100000;
+
+typedef struct {
+  int frames;
+  int64_t first_pts, last_pts;
+  pollux_rational time_base;
+} source_s;
+
+static int frames_encode(pollux_decode_t *d, pollux_encode_t *e,
+                         source_s *s) {
+  int ret;
+  pollux_frame_t *f;
+
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    ret = d->result_get(d, &f, 3000);
+    if (ret == pollux_err_stream_end) {
+      return 0;
+    } else if (ret) {
+      sirius_error("result_get: %d\n", ret);
+      return ret;
+    }
+
+    if (i == 0) {
+      s->first_pts = f->pts;
+      s->time_base = f->time_base;
+    }
+    if (i % 3 != 2) {
+      ret = e->send_frame(e, f);
+      if (ret) {
+        sirius_error("send_frame: %d\n", ret);
+        d->result_free(d, f);
+        return ret;
+      }
+      s->frames++;
+      s->last_pts = f->pts;
+    }
+    d->result_free(d, f);
+  }
+
+  return 0;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_decode_t *d;
+  pollux_encode_t *e;
+  pollux_decode_args_t dargs = {0};
+  pollux_encode_args_t eargs = {0};
+  pollux_img_t img = {WIDTH, HEIGHT, 1, pollux_pix_fmt_yuv420p};
+  pollux_demux_analysis_t r;
+  source_s s = {0};
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free1;
+
+  ret = pollux_encode_init(&e);
+  if (ret)
+    goto label_free2;
+
+  dargs.cache_count = 8;
+  dargs.thread_count = 4;
+  dargs.fmt_cvt_img = &img;
+  ret = d->param_set(d, INPUT_URL, &dargs);
+  if (ret) {
+    sirius_error("decode param_set: %d\n", ret);
+    goto label_free3;
+  }
+
+  eargs.cont_fmt = pollux_cont_fmt_mp4;
+  eargs.bit_rate = 4 * 1024 * 1024;
+  eargs.img = img;
+  eargs.frame_rate = d->stream.video_frame_rate;
+  eargs.gop_size = 30;
+  eargs.thread_count = 4;
+  eargs.codec_id = pollux_codec_id_h264;
+  eargs.custom_pts = true;
+  ret = e->param_set(e, OUTPUT_URL, &eargs);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    goto label_free3;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free3;
+  }
+
+  ret = frames_encode(d, e, &s);
+  int stop_ret = e->stop(e);
+  ret = ret ? ret : stop_ret;
+  e->release(e);
+  d->release(d);
+  if (ret)
+    goto label_free3;
+
+  if (s.time_base.num <= 0 || s.time_base.den <= 0) {
+    sirius_error("The decoded frames have no time base: %d/%d\n",
+                 s.time_base.num, s.time_base.den);
+    ret = -1;
+    goto label_free3;
+  }
+
+  ret = test_output_analyze(OUTPUT_URL, nullptr, &r);
+  if (ret)
+    goto label_free3;
+
+  int64_t span = (s.last_pts - s.first_pts) * 1000000 * s.time_base.num /
+                 s.time_base.den;
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("\tframes: %lld; expected %d\n", (long long)r.frames, s.frames);
+  sirius_infosp("\tspan: %lld us; expected %lld us\n", (long long)r.duration,
+                (long long)span);
+  sirius_infosp("---------------------\n\n");
+
+  if (r.frames != s.frames || r.duration < span - SPAN_TOLERANCE ||
+      r.duration > span + SPAN_TOLERANCE) {
+    sirius_error("Unexpected timestamps\n");
+    ret = -1;
+  }
+
+label_free3:
+  pollux_encode_deinit(e);
+label_free2:
+  pollux_decode_deinit(d);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,301 @@
+/**
+ * @brief Writer test.
+ *
+ * - (1) The frames are encoded with a small packet queue, so that the writing
+ * thread is backed up, and the output is checked by decoding it, the number of
+ * frames must match.
+ *
+ * - (2) The frames are encoded to a pipe which is only read once the last
+ * `send_frame` has returned, the writing thread is blocked by the full pipe
+ * but `send_frame` must not be: all the frames must be sent before the reader
+ * gives up waiting. The output is copied to a file and checked by decoding it.
+ */
+
+#ifdef _WIN32
+#  include <io.h>
+#else
+#  include <unistd.h>
+#endif
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test_media.h"
+
+static const char *OUTPUT_URL = test_generated_pre "2.5_writer.mp4";
+static const char *PIPE_OUTPUT_URL = test_generated_pre "2.5_writer_pipe.ts";
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int FPS = 30;
+static const int FRAME_COUNT = 300;
+static const int PACKET_CACHE_COUNT = 2;
+
+#define PIPE_READ_SIZE (16 * 1024)
+
+/**
+ * @brief How long the reader waits for all the frames to be sent before it
+ * starts reading anyway, unit: us.
+ */
+static const uint64_t SENT_WAIT_US = 60 * 1000 * 1000;
+
+typedef struct {
+  int fd;
+  FILE *fp;
+
+  /**
+   * @brief Set when the last `send_frame` has returned.
+   */
+  atomic_bool sent;
+  bool sent_timeout;
+  int64_t bytes;
+  int ret;
+} pipe_reader_t;
+
+static void fd_close(int fd) {
+  if (fd < 0)
+    return;
+#ifdef _WIN32
+  _close(fd);
+#else
+  close(fd);
+#endif
+}
+
+static void thread_pipe_read(void *args) {
+  pipe_reader_t *r = (pipe_reader_t *)args;
+  char buf[PIPE_READ_SIZE];
+  uint64_t t0 = sirius_get_time_us();
+
+  while (!r->sent) {
+    if (sirius_get_time_us() - t0 > SENT_WAIT_US) {
+      r->sent_timeout = true;
+      break;
+    }
+    sirius_usleep(1000);
+  }
+
+  while (true) {
+#ifdef _WIN32
+    int n = _read(r->fd, buf, sizeof(buf));
+#else
+    int n = (int)read(r->fd, buf, sizeof(buf));
+#endif
+    if (n <= 0) {
+      r->ret = n;
+      break;
+    }
+
+    if (fwrite(buf, 1, n, r->fp) != (size_t)n) {
+      sirius_error("fwrite: %s\n", PIPE_OUTPUT_URL);
+      r->ret = -1;
+      break;
+    }
+    r->bytes += n;
+  }
+}
+
+static int encode_frames(pollux_encode_t *e, pollux_frame_t *f,
+                         uint64_t *max_us) {
+  int ret = 0;
+
+  *max_us = 0;
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    test_frame_fill(f, i);
+    uint64_t t = sirius_get_time_us();
+    ret = e->send_frame(e, f);
+    t = sirius_get_time_us() - t;
+    *max_us = t > *max_us ? t : *max_us;
+    if (ret) {
+      sirius_error("send_frame: %d\n", ret);
+      break;
+    }
+  }
+
+  return ret;
+}
+
+static void args_fill(pollux_encode_args_t *args, const pollux_img_t *img) {
+  memset(args, 0, sizeof(pollux_encode_args_t));
+  args->bit_rate = 4 * 1024 * 1024;
+  args->img = *img;
+  args->frame_rate.num = FPS;
+  args->frame_rate.den = 1;
+  args->gop_size = FPS;
+  args->thread_count = 4;
+  args->codec_id = pollux_codec_id_h264;
+}
+
+static int backed_up_run(pollux_encode_t *e, pollux_frame_t *f,
+                         const pollux_img_t *img) {
+  int ret;
+  pollux_encode_args_t args;
+  uint64_t max_us;
+
+  args_fill(&args, img);
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  args.packet_cache_count = PACKET_CACHE_COUNT;
+  ret = e->param_set(e, OUTPUT_URL, &args);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    return ret;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    e->release(e);
+    return ret;
+  }
+
+  uint64_t t0 = sirius_get_time_us();
+  ret = encode_frames(e, f, &max_us);
+  int stop_ret = e->stop(e);
+  uint64_t t1 = sirius_get_time_us();
+  ret = ret ? ret : stop_ret;
+  e->release(e);
+  if (ret)
+    return ret;
+
+  int n_frames = test_frames_count(OUTPUT_URL);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("encode time: %llu us; max send_frame %llu us\n",
+                (unsigned long long)(t1 - t0), (unsigned long long)max_us);
+  sirius_infosp("\tframes: %d; expected %d\n", n_frames, FRAME_COUNT);
+  sirius_infosp("---------------------\n\n");
+
+  if (n_frames != FRAME_COUNT) {
+    sirius_error("Unexpected number of frames\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+static int slow_writer_run(pollux_encode_t *e, pollux_frame_t *f,
+                           const pollux_img_t *img) {
+  int ret, fds[2];
+  char url[32];
+  pollux_encode_args_t args;
+  pipe_reader_t r = {0};
+  sirius_thread_handle thread;
+  uint64_t max_us;
+
+#ifdef _WIN32
+  ret = _pipe(fds, PIPE_READ_SIZE, _O_BINARY);
+#else
+  ret = pipe(fds);
+#endif
+  if (ret) {
+    sirius_error("pipe: %d\n", ret);
+    return -1;
+  }
+
+  r.fd = fds[0];
+  if (!(r.fp = fopen(PIPE_OUTPUT_URL, "wb"))) {
+    sirius_error("fopen: %s\n", PIPE_OUTPUT_URL);
+    ret = -1;
+    goto label_free1;
+  }
+  if (sirius_thread_create(&thread, nullptr, (void *)thread_pipe_read,
+                           (void *)&r)) {
+    ret = -1;
+    goto label_free2;
+  }
+
+  /**
+   * @note The queue holds the whole stream, so that only the writing thread
+   * waits for the pipe, which is full until all the frames are sent.
+   */
+  args_fill(&args, img);
+  args.cont_fmt = pollux_cont_fmt_mpegts;
+  args.packet_cache_count = FRAME_COUNT;
+  snprintf(url, sizeof(url), "pipe:%d", fds[1]);
+  ret = e->param_set(e, url, &args);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    goto label_free3;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free4;
+  }
+
+  ret = encode_frames(e, f, &max_us);
+  r.sent = true;
+  int stop_ret = e->stop(e);
+  ret = ret ? ret : stop_ret;
+
+label_free4:
+  e->release(e);
+label_free3:
+  r.sent = true;
+  /**
+   * @note The pipe protocol of ffmpeg does not close the descriptor, closing
+   * the write end ends the reader.
+   */
+  fd_close(fds[1]);
+  fds[1] = -1;
+  sirius_thread_join(thread, nullptr);
+label_free2:
+  fclose(r.fp);
+label_free1:
+  fd_close(fds[0]);
+  fd_close(fds[1]);
+  if (ret)
+    return ret;
+
+  int n_frames = test_frames_count(PIPE_OUTPUT_URL);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("pipe: max send_frame %llu us\n", (unsigned long long)max_us);
+  sirius_infosp("\tread: %lld bytes\n", (long long)r.bytes);
+  sirius_infosp("\tframes: %d; expected %d\n", n_frames, FRAME_COUNT);
+  sirius_infosp("---------------------\n\n");
+
+  if (r.ret < 0) {
+    sirius_error("The pipe is not read to the end\n");
+    return -1;
+  }
+  if (r.sent_timeout) {
+    sirius_error("send_frame is blocked by the writer\n");
+    return -1;
+  }
+  if (n_frames != FRAME_COUNT) {
+    sirius_error("Unexpected number of frames\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_encode_t *e;
+  pollux_img_t img = {WIDTH, HEIGHT, 1, pollux_pix_fmt_yuv420p};
+  pollux_frame_t *f;
+
+  ret = pollux_frame_alloc(&img, &f);
+  if (ret)
+    goto label_free1;
+
+  ret = pollux_encode_init(&e);
+  if (ret)
+    goto label_free2;
+
+  ret = backed_up_run(e, f, &img);
+  if (!ret)
+    ret = slow_writer_run(e, f, &img);
+
+  pollux_encode_deinit(e);
+label_free2:
+  pollux_frame_free(&f);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,164 @@
+/**
+ * @brief Asynchronous sending test. One thread feeds two encoders with
+ * `send_frame_async`, each from its own small pool of frames, which are
+ * reused once they are released. The outputs are checked by decoding them.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test_media.h"
+
+#define ENCODER_NR (2)
+#define POOL_SIZE (4)
+
+static const char *OUTPUT_URLS[ENCODER_NR] = {
+  test_generated_pre "2.6_async_h264.mp4",
+  test_generated_pre "2.6_async_hevc.mp4",
+};
+static const pollux_codec_id_t CODEC_IDS[ENCODER_NR] = {
+  pollux_codec_id_h264,
+  pollux_codec_id_hevc,
+};
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int FPS = 30;
+static const int FRAME_COUNT = 200;
+
+typedef struct {
+  pollux_encode_t *e;
+  pollux_frame_t *pool[POOL_SIZE];
+  atomic_bool busy[POOL_SIZE];
+  atomic_int released;
+  int overflows;
+} encoder_s;
+
+static void frame_release_cb(const pollux_frame_t *frame, void *opaque) {
+  encoder_s *enc = (encoder_s *)opaque;
+
+  for (int i = 0; i < POOL_SIZE; ++i) {
+    if (enc->pool[i] == frame) {
+      enc->busy[i] = false;
+      break;
+    }
+  }
+  enc->released++;
+}
+
+static int encoder_open(encoder_s *enc, int index, const pollux_img_t *img) {
+  int ret;
+  pollux_encode_args_t args = {0};
+
+  for (int i = 0; i < POOL_SIZE; ++i) {
+    ret = pollux_frame_alloc(img, enc->pool + i);
+    if (ret)
+      return ret;
+  }
+
+  ret = pollux_encode_init(&enc->e);
+  if (ret)
+    return ret;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  args.bit_rate = 4 * 1024 * 1024;
+  args.img = *img;
+  args.frame_rate.num = FPS;
+  args.frame_rate.den = 1;
+  args.gop_size = FPS;
+  args.thread_count = 4;
+  args.codec_id = CODEC_IDS[index];
+  args.frame_queue_count = POOL_SIZE;
+  args.frame_release_cb = frame_release_cb;
+  ret = enc->e->param_set(enc->e, OUTPUT_URLS[index], &args);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    return ret;
+  }
+
+  return enc->e->start(enc->e);
+}
+
+/**
+ * @return 0 on success, `pollux_err_cache_overflow` if there is no free frame
+ * or the queue is full, error code otherwise.
+ */
+static int encoder_feed(encoder_s *enc, int index) {
+  int ret;
+
+  for (int i = 0; i < POOL_SIZE; ++i) {
+    if (enc->busy[i])
+      continue;
+
+    test_frame_fill(enc->pool[i], index);
+    enc->busy[i] = true;
+    ret = enc->e->send_frame_async(enc->e, enc->pool[i], enc);
+    if (ret)
+      enc->busy[i] = false;
+    return ret;
+  }
+
+  return pollux_err_cache_overflow;
+}
+
+int main() {
+  test_init();
+
+  int ret = 0;
+  encoder_s encs[ENCODER_NR] = {0};
+  pollux_img_t img = {WIDTH, HEIGHT, 1, pollux_pix_fmt_yuv420p};
+
+  for (int i = 0; i < ENCODER_NR && !ret; ++i) {
+    ret = encoder_open(encs + i, i, &img);
+  }
+  if (ret)
+    goto label_free;
+
+  uint64_t t0 = sirius_get_time_us();
+  for (int n = 0; n < FRAME_COUNT && !ret; ++n) {
+    for (int i = 0; i < ENCODER_NR; ++i) {
+      while ((ret = encoder_feed(encs + i, n)) == pollux_err_cache_overflow) {
+        encs[i].overflows++;
+        sirius_usleep(1000);
+      }
+      if (ret) {
+        sirius_error("send_frame_async: %d\n", ret);
+        break;
+      }
+    }
+  }
+  for (int i = 0; i < ENCODER_NR; ++i) {
+    int stop_ret = encs[i].e->stop(encs[i].e);
+    ret = ret ? ret : stop_ret;
+  }
+  uint64_t t1 = sirius_get_time_us();
+  if (ret)
+    goto label_free;
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("encode time: %llu us\n", (unsigned long long)(t1 - t0));
+  for (int i = 0; i < ENCODER_NR; ++i) {
+    encs[i].e->release(encs[i].e);
+    int n_frames = test_frames_count(OUTPUT_URLS[i]);
+    sirius_infosp("\t[%d] frames: %d; released %d; overflows %d\n", i,
+                  n_frames, (int)encs[i].released, encs[i].overflows);
+    if (n_frames != FRAME_COUNT || encs[i].released != FRAME_COUNT)
+      ret = -1;
+  }
+  sirius_infosp("---------------------\n\n");
+
+  if (ret)
+    sirius_error("Unexpected number of frames\n");
+
+label_free:
+  for (int i = 0; i < ENCODER_NR; ++i) {
+    if (encs[i].e)
+      pollux_encode_deinit(encs[i].e);
+    for (int j = 0; j < POOL_SIZE; ++j) {
+      if (encs[i].pool[j])
+        pollux_frame_free(encs[i].pool + j);
+    }
+  }
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,122 @@
+/**
+ * @brief Input pool test. The frames are rendered straight into the frames of
+ * `get_input_frame`, which are limited to a small number, and the output is
+ * checked by decoding it, the number of frames must match.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test_media.h"
+
+static const char *OUTPUT_URL = test_generated_pre "2.7_input_pool.mp4";
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int FPS = 30;
+static const int FRAME_COUNT = 300;
+static const int INPUT_FRAME_COUNT = 2;
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_encode_t *e;
+  pollux_encode_args_t args = {0};
+  pollux_img_t img = {WIDTH, HEIGHT, 32, pollux_pix_fmt_yuv420p};
+  pollux_frame_t *f, *held[INPUT_FRAME_COUNT + 1];
+
+  ret = pollux_encode_init(&e);
+  if (ret)
+    goto label_free1;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  args.bit_rate = 4 * 1024 * 1024;
+  args.img = img;
+  args.frame_rate.num = FPS;
+  args.frame_rate.den = 1;
+  args.gop_size = FPS;
+  args.thread_count = 4;
+  args.codec_id = pollux_codec_id_h264;
+  args.input_frame_count = INPUT_FRAME_COUNT;
+  ret = e->param_set(e, OUTPUT_URL, &args);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    goto label_free2;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free2;
+  }
+
+  /**
+   * @note Only `INPUT_FRAME_COUNT` frames can be held at the same time.
+   */
+  for (int i = 0; i <= INPUT_FRAME_COUNT; ++i) {
+    ret = e->get_input_frame(e, held + i);
+    if (i < INPUT_FRAME_COUNT ? ret : ret != pollux_err_cache_overflow) {
+      sirius_error("get_input_frame: %d\n", ret);
+      ret = -1;
+      goto label_free2;
+    }
+  }
+  for (int i = 0; i < INPUT_FRAME_COUNT; ++i) {
+    test_frame_fill(held[i], i);
+    ret = e->submit_input_frame(e, held[i]);
+    if (ret) {
+      sirius_error("submit_input_frame: %d\n", ret);
+      goto label_free2;
+    }
+  }
+
+  uint64_t max_us = 0;
+  uint64_t t0 = sirius_get_time_us();
+  for (int i = INPUT_FRAME_COUNT; i < FRAME_COUNT; ++i) {
+    ret = e->get_input_frame(e, &f);
+    if (ret) {
+      sirius_error("get_input_frame: %d\n", ret);
+      break;
+    }
+    if ((uintptr_t)f->data[0] % img.align || f->linesize[0] % img.align) {
+      sirius_error("Unaligned input frame\n");
+      ret = -1;
+      break;
+    }
+    test_frame_fill(f, i);
+    uint64_t t = sirius_get_time_us();
+    ret = e->submit_input_frame(e, f);
+    t = sirius_get_time_us() - t;
+    max_us = t > max_us ? t : max_us;
+    if (ret) {
+      sirius_error("submit_input_frame: %d\n", ret);
+      break;
+    }
+  }
+  int stop_ret = e->stop(e);
+  uint64_t t1 = sirius_get_time_us();
+  ret = ret ? ret : stop_ret;
+  e->release(e);
+  if (ret)
+    goto label_free2;
+
+  int n_frames = test_frames_count(OUTPUT_URL);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("encode time: %llu us; max submit_input_frame %llu us\n",
+                (unsigned long long)(t1 - t0), (unsigned long long)max_us);
+  sirius_infosp("\tframes: %d; expected %d\n", n_frames, FRAME_COUNT);
+  sirius_infosp("---------------------\n\n");
+
+  if (n_frames != FRAME_COUNT) {
+    sirius_error("Unexpected number of frames\n");
+    ret = -1;
+  }
+
+label_free2:
+  pollux_encode_deinit(e);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
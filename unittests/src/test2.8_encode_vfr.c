@@ -0,0 +1,115 @@
+/**
+ * @brief Variable frame rate test. Every third frame of a constant rate source
+ * is dropped, and the rest are encoded with their own timestamps. The output
+ * is checked by analyzing it, the span of the timestamps must be the one of
+ * the source instead of the one of the number of frames.
+ */
+
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test_media.h"
+
+static const char *OUTPUT_URL = test_generated_pre "2.8_vfr.mp4";
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int FPS = 30;
+static const int SLOT_COUNT = 300;
+
+/**
+ * @brief The tolerance of the span, unit: us.
+ */
+static const int64_t SPAN_TOLERANCE = 100000;
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_encode_t *e;
+  pollux_encode_args_t args = {0};
+  pollux_img_t img = {WIDTH, HEIGHT, 1, pollux_pix_fmt_yuv420p};
+  pollux_frame_t *f;
+  pollux_demux_analysis_t r;
+  int frames = 0, last_slot = 0;
+
+  ret = pollux_frame_alloc(&img, &f);
+  if (ret)
+    goto label_free1;
+
+  ret = pollux_encode_init(&e);
+  if (ret)
+    goto label_free2;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  args.bit_rate = 4 * 1024 * 1024;
+  args.img = img;
+  args.frame_rate.num = FPS;
+  args.frame_rate.den = 1;
+  args.gop_size = FPS;
+  args.thread_count = 4;
+  args.codec_id = pollux_codec_id_h264;
+  args.custom_pts = true;
+  ret = e->param_set(e, OUTPUT_URL, &args);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    goto label_free3;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free3;
+  }
+
+  /**
+   * @note The timestamps are in milliseconds, and do not start at 0.
+   */
+  f->time_base.num = 1;
+  f->time_base.den = 1000;
+  for (int slot = 0; slot < SLOT_COUNT; ++slot) {
+    if (slot % 3 == 2)
+      continue;
+
+    test_frame_fill(f, slot);
+    f->pts = 5000 + (int64_t)slot * 1000 / FPS;
+    ret = e->send_frame(e, f);
+    if (ret) {
+      sirius_error("send_frame: %d\n", ret);
+      break;
+    }
+    frames++;
+    last_slot = slot;
+  }
+  int stop_ret = e->stop(e);
+  ret = ret ? ret : stop_ret;
+  e->release(e);
+  if (ret)
+    goto label_free3;
+
+  ret = test_output_analyze(OUTPUT_URL, nullptr, &r);
+  if (ret)
+    goto label_free3;
+
+  int64_t span = (int64_t)last_slot * 1000000 / FPS;
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("\tframes: %lld; expected %d\n", (long long)r.frames, frames);
+  sirius_infosp("\tspan: %lld us; expected %lld us\n", (long long)r.duration,
+                (long long)span);
+  sirius_infosp("---------------------\n\n");
+
+  if (r.frames != frames || r.duration < span - SPAN_TOLERANCE ||
+      r.duration > span + SPAN_TOLERANCE) {
+    sirius_error("Unexpected timestamps\n");
+    ret = -1;
+  }
+
+label_free3:
+  pollux_encode_deinit(e);
+label_free2:
+  pollux_frame_free(&f);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
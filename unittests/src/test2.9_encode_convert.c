@@ -0,0 +1,139 @@
+/**
+ * @brief Conversion test. The decoded frames of two inputs, whose sizes differ
+ * from the one of the encoder, are sent to one encoder without converting
+ * them. The output is checked by decoding it, the number of frames must match.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test_media.h"
+
+static const char *INPUT_URLS[] = {
+  "./input1_2560-1440_video.mp4",
+  "./input2_3506-2200_video.avi",
+};
+static const char *OUTPUT_URL = test_generated_pre "2.9_convert.mp4";
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int FPS = 30;
+static const int FRAME_COUNT = 60;
+
+/**
+ * @return The number of frames sent, or a negative error code.
+ */
+static int frames_send(pollux_encode_t *e, const char *url) {
+  int ret, count = 0;
+  pollux_decode_t *d;
+  pollux_decode_args_t args = {0};
+  pollux_frame_t *f;
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    return ret;
+
+  args.cache_count = 8;
+  args.thread_count = 4;
+  ret = d->param_set(d, url, &args);
+  if (ret) {
+    sirius_error("decode param_set: %d\n", ret);
+    goto label_free;
+  }
+
+  while (count < FRAME_COUNT) {
+    ret = d->result_get(d, &f, 3000);
+    if (ret == pollux_err_stream_end) {
+      ret = 0;
+      break;
+    } else if (ret) {
+      sirius_error("result_get: %d\n", ret);
+      goto label_free;
+    }
+
+    if (count == 0) {
+      sirius_infosp("%s: %dx%d, fmt %d\n", url, f->width, f->height, f->fmt);
+    }
+    ret = e->send_frame(e, f);
+    d->result_free(d, f);
+    if (ret) {
+      sirius_error("send_frame: %d\n", ret);
+      goto label_free;
+    }
+    count++;
+  }
+  ret = count;
+
+label_free:
+  pollux_decode_deinit(d);
+  return ret;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_encode_t *e;
+  pollux_encode_args_t args = {0};
+  int frames = 0;
+
+  ret = pollux_encode_init(&e);
+  if (ret)
+    goto label_free1;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  args.bit_rate = 4 * 1024 * 1024;
+  args.img.width = WIDTH;
+  args.img.height = HEIGHT;
+  args.img.fmt = pollux_pix_fmt_yuv420p;
+  args.frame_rate.num = FPS;
+  args.frame_rate.den = 1;
+  args.gop_size = FPS;
+  args.thread_count = 4;
+  args.codec_id = pollux_codec_id_h264;
+  args.auto_convert = true;
+  ret = e->param_set(e, OUTPUT_URL, &args);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    goto label_free2;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free2;
+  }
+
+  uint64_t t0 = sirius_get_time_us();
+  for (size_t i = 0; i < sizeof(INPUT_URLS) / sizeof(INPUT_URLS[0]); ++i) {
+    ret = frames_send(e, INPUT_URLS[i]);
+    if (ret < 0)
+      break;
+    frames += ret;
+    ret = 0;
+  }
+  int stop_ret = e->stop(e);
+  uint64_t t1 = sirius_get_time_us();
+  ret = ret ? ret : stop_ret;
+  e->release(e);
+  if (ret)
+    goto label_free2;
+
+  int n_frames = test_frames_count(OUTPUT_URL);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("encode time: %llu us\n", (unsigned long long)(t1 - t0));
+  sirius_infosp("\tframes: %d; expected %d\n", n_frames, frames);
+  sirius_infosp("---------------------\n\n");
+
+  if (frames <= 0 || n_frames != frames) {
+    sirius_error("Unexpected number of frames\n");
+    ret = -1;
+  }
+
+label_free2:
+  pollux_encode_deinit(e);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,241 @@
+/**
+ * @brief Loopback latency test. A local encoder sends synthetic frames to a
+ * decoder listening on `tcp://127.0.0.1`, the index of each frame is drawn into
+ * the luma plane as a row of black and white blocks. The delay from
+ * `send_frame` to `result_get` is measured once with the default decoding
+ * parameters and once with `low_delay`, the encoder is tuned for zero latency.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_encode.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+#define FRAME_COUNT (150)
+#define ID_BITS (16)
+#define ID_BLOCK (16)
+
+/**
+ * @note The listener gives up after `listen_timeout` (ms), so that it is not
+ * blocked forever when the encoder fails before connecting.
+ */
+static const char *URL_DECODE =
+  "tcp://127.0.0.1:23456?listen=1&listen_timeout=10000";
+static const char *URL_ENCODE = "tcp://127.0.0.1:23456";
+static const int WIDTH = 640, HEIGHT = 360;
+static const int FPS = 30;
+static const pollux_pix_fmt_t FMT = pollux_pix_fmt_yuv420p;
+
+typedef struct {
+  pollux_decode_t *d;
+  bool low_delay;
+  int ret;
+
+  /**
+   * @brief The time at which each frame was sent, unit: us, written by the
+   * sender before `send_frame` and read by the receiver.
+   */
+  _Atomic uint64_t send_us[FRAME_COUNT];
+  atomic_int received;
+  uint64_t latency_us_sum, latency_us_max;
+} loopback_t;
+
+static void frame_id_draw(pollux_frame_t *f, int id) {
+  for (int y = 0; y < f->height; ++y)
+    memset(f->data[0] + y * f->linesize[0], 0x80, f->width);
+  for (int y = 0; y < f->height / 2; ++y) {
+    memset(f->data[1] + y * f->linesize[1], 0x80, f->width / 2);
+    memset(f->data[2] + y * f->linesize[2], 0x80, f->width / 2);
+  }
+
+  for (int bit = 0; bit < ID_BITS; ++bit) {
+    unsigned char v = (id >> bit) & 1 ? 0xeb : 0x10;
+
+    for (int y = 0; y < ID_BLOCK; ++y)
+      memset(f->data[0] + y * f->linesize[0] + bit * ID_BLOCK, v, ID_BLOCK);
+  }
+}
+
+static int frame_id_read(const pollux_frame_t *f) {
+  int id = 0;
+
+  for (int bit = 0; bit < ID_BITS; ++bit) {
+    const unsigned char *p = f->data[0] + (ID_BLOCK / 2) * f->linesize[0] +
+      bit * ID_BLOCK + ID_BLOCK / 2;
+
+    if (*p > 0x80)
+      id |= 1 << bit;
+  }
+
+  return id;
+}
+
+static void thread_receive(void *args) {
+  loopback_t *lb = (loopback_t *)args;
+  pollux_decode_t *d = lb->d;
+  pollux_decode_args_t dargs = {0};
+  pollux_frame_t *f;
+
+  dargs.cache_count = 16;
+  dargs.low_delay = lb->low_delay;
+
+  /**
+   * @note Blocks until the encoder connects, or `listen_timeout`.
+   */
+  lb->ret = d->param_set(d, URL_DECODE, &dargs);
+  if (lb->ret) {
+    sirius_error("param_set: %d\n", lb->ret);
+    return;
+  }
+
+  while (true) {
+    /**
+     * @note The encoder stops sending on failure, the timeout ends the loop.
+     */
+    int ret = d->result_get(d, &f, 3000);
+    if (ret) {
+      if (ret != pollux_err_stream_end && ret != pollux_err_timeout)
+        sirius_warnsp("result_get: %d\n", ret);
+      break;
+    }
+
+    uint64_t now = sirius_get_time_us();
+    int id = frame_id_read(f);
+    d->result_free(d, f);
+
+    if (id < 0 || id >= FRAME_COUNT || !lb->send_us[id])
+      continue;
+
+    uint64_t latency = now - atomic_load(&lb->send_us[id]);
+    lb->latency_us_sum += latency;
+    lb->latency_us_max = sirius_max(lb->latency_us_max, latency);
+    if (++lb->received >= FRAME_COUNT)
+      break;
+  }
+
+  d->release(d);
+}
+
+static int loopback_run(loopback_t *lb) {
+  int ret, stop_ret;
+  pollux_encode_t *e;
+  pollux_frame_t *f;
+  sirius_thread_handle thread;
+  pollux_img_t img = {WIDTH, HEIGHT, 1, FMT};
+
+  ret = pollux_frame_alloc(&img, &f);
+  if (ret)
+    return ret;
+
+  if (sirius_thread_create(&thread, nullptr, (void *)thread_receive,
+                           (void *)lb)) {
+    ret = -1;
+    goto label_free1;
+  }
+  sirius_usleep(500 * 1000);
+
+  ret = pollux_encode_init(&e);
+  if (ret)
+    goto label_free2;
+
+  pollux_encode_args_t eargs = {0};
+  eargs.cont_fmt = pollux_cont_fmt_mpegts;
+  eargs.bit_rate = 2 * 1024 * 1024;
+  eargs.img = img;
+  eargs.frame_rate.num = FPS;
+  eargs.frame_rate.den = 1;
+  eargs.gop_size = FPS;
+  eargs.max_b_frames = 0;
+  eargs.codec_id = pollux_codec_id_h264;
+  ret = e->param_set(e, URL_ENCODE, &eargs);
+  if (ret) {
+    sirius_error("encode param_set: %d\n", ret);
+    goto label_free3;
+  }
+
+  h264_encode_args_t priv_args = {0};
+  priv_args.tune_mode = h264_tune_zerolatency;
+  ret = pollux_encode_priv_set(e, &priv_args);
+  if (ret) {
+    sirius_error("priv_set: %d\n", ret);
+    goto label_free4;
+  }
+
+  ret = e->start(e);
+  if (ret) {
+    sirius_error("start: %d\n", ret);
+    goto label_free4;
+  }
+
+  for (int i = 0; i < FRAME_COUNT; ++i) {
+    frame_id_draw(f, i);
+    atomic_store(&lb->send_us[i], sirius_get_time_us());
+    ret = e->send_frame(e, f);
+    if (ret) {
+      sirius_error("send_frame: %d\n", ret);
+      break;
+    }
+    sirius_usleep(1000 * 1000 / FPS);
+  }
+  stop_ret = e->stop(e);
+  if (stop_ret)
+    sirius_error("stop: %d\n", stop_ret);
+  ret = ret ? ret : stop_ret;
+
+label_free4:
+  e->release(e);
+
+label_free3:
+  pollux_encode_deinit(e);
+label_free2:
+  sirius_thread_join(thread, nullptr);
+label_free1:
+  pollux_frame_free(&f);
+
+  if (!ret)
+    ret = lb->ret;
+  return ret;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_decode_t *d;
+  static loopback_t lb[2];
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free1;
+
+  for (int i = 0; i < 2; ++i) {
+    lb[i].d = d;
+    lb[i].low_delay = i == 1;
+
+    ret = loopback_run(lb + i);
+    if (ret)
+      goto label_free2;
+    if (!lb[i].received) {
+      sirius_error("No frame received\n");
+      ret = -1;
+      goto label_free2;
+    }
+  }
+
+  sirius_infosp("---------------------\n");
+  for (int i = 0; i < 2; ++i) {
+    int received = lb[i].received;
+    sirius_infosp("%s: %d frames, latency avg: %llu us; max: %llu us\n",
+                  lb[i].low_delay ? "low_delay" : "default", received,
+                  (unsigned long long)(lb[i].latency_us_sum / received),
+                  (unsigned long long)lb[i].latency_us_max);
+  }
+  sirius_infosp("---------------------\n\n");
+
+label_free2:
+  pollux_decode_deinit(d);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,147 @@
+/**
+ * @brief Demuxing test. The packets of the url are read without decoding,
+ * converted to Annex B and fed to a decoder in the packet mode, which must
+ * output one frame per packet.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+
+typedef struct {
+  pollux_decode_t *d;
+  int frames;
+  int ret;
+} receiver_t;
+
+static void thread_receive(void *args) {
+  receiver_t *r = (receiver_t *)args;
+  pollux_frame_t *f;
+
+  while (true) {
+    int ret = r->d->result_get(r->d, &f, 3000);
+    if (ret == pollux_err_stream_end) {
+      break;
+    } else if (ret) {
+      sirius_error("result_get: %d\n", ret);
+      r->ret = ret;
+      break;
+    }
+
+    r->frames++;
+    r->d->result_free(r->d, f);
+  }
+}
+
+static int demux_to_decoder(pollux_demux_t *dm, pollux_decode_t *d) {
+  int ret, packets = 0, keys = 0;
+  int64_t last_dts = INT64_MIN;
+  pollux_demux_args_t margs = {0};
+  pollux_decode_args_t dargs = {0};
+  pollux_packet_t *p;
+  receiver_t r = {d, 0, 0};
+  sirius_thread_handle thread;
+
+  margs.cache_count = 8;
+  margs.annexb = true;
+  ret = dm->param_set(dm, INPUT_URL, &margs);
+  if (ret) {
+    sirius_error("demux param_set: %d\n", ret);
+    return ret;
+  }
+
+  dargs.cache_count = 16;
+  dargs.thread_count = 4;
+  ret = d->packet_param_set(d, dm->stream.video_codec_id, dm->stream.time_base,
+                            &dargs);
+  if (ret) {
+    sirius_error("packet_param_set: %d\n", ret);
+    goto label_free1;
+  }
+
+  if (sirius_thread_create(&thread, nullptr, (void *)thread_receive,
+                           (void *)&r)) {
+    ret = -1;
+    goto label_free2;
+  }
+
+  while (true) {
+    ret = dm->read_packet(dm, &p, 3000);
+    if (ret == pollux_err_stream_end) {
+      ret = 0;
+      break;
+    } else if (ret) {
+      sirius_error("read_packet: %d\n", ret);
+      break;
+    }
+
+    if (packets == 0 && !(p->flags & POLLUX_PACKET_FLAG_KEY)) {
+      sirius_error("The first packet is not a key frame\n");
+      ret = -1;
+    } else if (p->dts <= last_dts) {
+      sirius_error("Non-monotonic dts: %lld after %lld\n", (long long)p->dts,
+                   (long long)last_dts);
+      ret = -1;
+    }
+    last_dts = p->dts;
+    packets++;
+    if (p->flags & POLLUX_PACKET_FLAG_KEY)
+      keys++;
+
+    if (!ret)
+      ret = d->send_packet(d, p->data, p->size, p->pts, p->dts, p->flags);
+    dm->packet_free(dm, p);
+    if (ret)
+      break;
+  }
+  d->send_packet(d, nullptr, 0, 0, 0, 0);
+  sirius_thread_join(thread, nullptr);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("%d x %d, codec: %d\n", dm->stream.video_width,
+                dm->stream.video_height, dm->stream.video_codec_id);
+  sirius_infosp("\tpackets: %d; key: %d; frames: %d\n", packets, keys,
+                r.frames);
+  sirius_infosp("---------------------\n\n");
+
+  if (!ret)
+    ret = r.ret;
+  if (!ret && (keys == 0 || r.frames != packets)) {
+    sirius_error("Unexpected number of frames\n");
+    ret = -1;
+  }
+
+label_free2:
+  d->release(d);
+label_free1:
+  dm->release(dm);
+  return ret;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_demux_t *dm;
+  pollux_decode_t *d;
+
+  ret = pollux_demux_init(&dm);
+  if (ret)
+    goto label_free1;
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free2;
+
+  ret = demux_to_decoder(dm, d);
+
+  pollux_decode_deinit(d);
+label_free2:
+  pollux_demux_deinit(dm);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,112 @@
+/**
+ * @brief Analysis test. The statistics of the packets are collected without
+ * decoding, and checked against the packets read by `read_packet` and against
+ * the callbacks.
+ */
+
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+
+typedef struct {
+  int64_t frames;
+  int64_t keys_typed;
+  int64_t bucket_bytes;
+  int buckets;
+} counter_s;
+
+static void frame_cb(const pollux_demux_frame_info_t *info, void *opaque) {
+  counter_s *c = (counter_s *)opaque;
+
+  c->frames++;
+  if ((info->flags & POLLUX_PACKET_FLAG_KEY) && info->pict_type == 'I')
+    c->keys_typed++;
+  if (info->scene_hint) {
+    sirius_infosp("scene hint: pts %lld us, %c, %d bytes\n",
+                  (long long)info->pts, info->pict_type, info->size);
+  }
+}
+
+static void bitrate_cb(int64_t start_us, int64_t bytes, int64_t bit_rate,
+                       void *opaque) {
+  counter_s *c = (counter_s *)opaque;
+
+  c->buckets++;
+  c->bucket_bytes += bytes;
+  sirius_infosp("bucket %lld us: %lld bps\n", (long long)start_us,
+                (long long)bit_rate);
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_demux_t *dm;
+  pollux_demux_analyze_args_t args = {0};
+  pollux_demux_analysis_t r;
+  counter_s c = {0};
+  pollux_packet_t *p;
+  int packets = 0;
+
+  ret = pollux_demux_init(&dm);
+  if (ret)
+    goto label_free1;
+
+  ret = dm->param_set(dm, INPUT_URL, nullptr);
+  if (ret) {
+    sirius_error("demux param_set: %d\n", ret);
+    goto label_free2;
+  }
+
+  args.frame_cb = frame_cb;
+  args.bitrate_cb = bitrate_cb;
+  args.opaque = &c;
+
+  uint64_t t0 = sirius_get_time_us();
+  ret = dm->analyze(dm, &args, &r);
+  uint64_t t1 = sirius_get_time_us();
+  if (ret) {
+    sirius_error("analyze: %d\n", ret);
+    goto label_free2;
+  }
+
+  ret = dm->seek_file(dm, INT64_MIN, 0, 0);
+  if (ret) {
+    sirius_error("seek_file: %d\n", ret);
+    goto label_free2;
+  }
+  while ((ret = dm->read_packet(dm, &p, 0)) == 0) {
+    packets++;
+    dm->packet_free(dm, p);
+  }
+  ret = ret == pollux_err_stream_end ? 0 : ret;
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("analyze time: %llu us\n", (unsigned long long)(t1 - t0));
+  sirius_infosp("\tframes %lld (I %lld; P %lld; B %lld); keys %lld\n",
+                (long long)r.frames, (long long)r.frames_i,
+                (long long)r.frames_p, (long long)r.frames_b,
+                (long long)r.key_frames);
+  sirius_infosp("\tduration %lld us; %lld bps; gop %d..%d (avg %.1f)\n",
+                (long long)r.duration, (long long)r.bit_rate, r.gop_min,
+                r.gop_max, r.gop_avg);
+  sirius_infosp("\tscene hints %lld; buckets %d\n", (long long)r.scene_hints,
+                c.buckets);
+  sirius_infosp("---------------------\n\n");
+
+  if (ret || r.frames <= 0 || r.frames != packets || c.frames != r.frames ||
+      r.key_frames <= 0 || c.keys_typed != r.key_frames ||
+      c.bucket_bytes != r.bytes || r.duration <= 0 || r.bit_rate <= 0) {
+    sirius_error("Unexpected statistics\n");
+    ret = -1;
+  }
+
+label_free2:
+  pollux_demux_deinit(dm);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
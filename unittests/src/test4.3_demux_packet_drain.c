@@ -0,0 +1,148 @@
+/**
+ * @brief Packet mode drain test. The packets of the url are fed to a decoder in
+ * the packet mode, the decoder is drained before the second key frame, which
+ * is sent right after the drain. Both sends must succeed, and the decoder must
+ * output one frame per packet, with an end of stream after each drain.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+
+/**
+ * @brief The number of drains, one in the middle and one at the end.
+ */
+static const int DRAIN_COUNT = 2;
+
+typedef struct {
+  pollux_decode_t *d;
+  int frames;
+  int ends;
+  int ret;
+} receiver_t;
+
+static void thread_receive(void *args) {
+  receiver_t *r = (receiver_t *)args;
+  pollux_frame_t *f;
+
+  while (r->ends < DRAIN_COUNT) {
+    int ret = r->d->result_get(r->d, &f, 3000);
+    if (ret == pollux_err_stream_end) {
+      r->ends++;
+      continue;
+    } else if (ret) {
+      sirius_error("result_get: %d\n", ret);
+      r->ret = ret;
+      break;
+    }
+
+    r->frames++;
+    r->d->result_free(r->d, f);
+  }
+}
+
+static int demux_to_decoder(pollux_demux_t *dm, pollux_decode_t *d) {
+  int ret, packets = 0, keys = 0;
+  pollux_demux_args_t margs = {0};
+  pollux_decode_args_t dargs = {0};
+  pollux_packet_t *p;
+  receiver_t r = {d, 0, 0, 0};
+  sirius_thread_handle thread;
+
+  margs.cache_count = 8;
+  margs.annexb = true;
+  ret = dm->param_set(dm, INPUT_URL, &margs);
+  if (ret) {
+    sirius_error("demux param_set: %d\n", ret);
+    return ret;
+  }
+
+  dargs.cache_count = 16;
+  dargs.thread_count = 4;
+  ret = d->packet_param_set(d, dm->stream.video_codec_id, dm->stream.time_base,
+                            &dargs);
+  if (ret) {
+    sirius_error("packet_param_set: %d\n", ret);
+    goto label_free1;
+  }
+
+  if (sirius_thread_create(&thread, nullptr, (void *)thread_receive,
+                           (void *)&r)) {
+    ret = -1;
+    goto label_free2;
+  }
+
+  while (true) {
+    ret = dm->read_packet(dm, &p, 3000);
+    if (ret == pollux_err_stream_end) {
+      ret = 0;
+      break;
+    } else if (ret) {
+      sirius_error("read_packet: %d\n", ret);
+      break;
+    }
+
+    if ((p->flags & POLLUX_PACKET_FLAG_KEY) && keys++ == 1) {
+      ret = d->send_packet(d, nullptr, 0, 0, 0, 0);
+      if (ret)
+        sirius_error("send_packet (drain): %d\n", ret);
+    }
+    if (!ret) {
+      ret = d->send_packet(d, p->data, p->size, p->pts, p->dts, p->flags);
+      if (ret)
+        sirius_error("send_packet: %d\n", ret);
+    }
+    dm->packet_free(dm, p);
+    if (ret)
+      break;
+    packets++;
+  }
+  d->send_packet(d, nullptr, 0, 0, 0, 0);
+  sirius_thread_join(thread, nullptr);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("\tpackets: %d; key: %d; frames: %d; ends: %d\n", packets,
+                keys, r.frames, r.ends);
+  sirius_infosp("---------------------\n\n");
+
+  if (!ret)
+    ret = r.ret;
+  if (!ret && (keys < 2 || r.frames != packets || r.ends != DRAIN_COUNT)) {
+    sirius_error("Unexpected number of frames\n");
+    ret = -1;
+  }
+
+label_free2:
+  d->release(d);
+label_free1:
+  dm->release(dm);
+  return ret;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_demux_t *dm;
+  pollux_decode_t *d;
+
+  ret = pollux_demux_init(&dm);
+  if (ret)
+    goto label_free1;
+  ret = pollux_decode_init(&d);
+  if (ret)
+    goto label_free2;
+
+  ret = demux_to_decoder(dm, d);
+
+  pollux_decode_deinit(d);
+label_free2:
+  pollux_demux_deinit(dm);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,126 @@
+/**
+ * @brief Remuxing test. The input is copied from `mp4` to `mpegts` and back,
+ * and appended twice into one `mp4`. The outputs are checked by counting the
+ * demuxed packets and by decoding the `mpegts` one.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_erron.h"
+#include "pollux/pollux_remux.h"
+#include "test_media.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+static const char *OUTPUT_TS = test_generated_pre "5.1_copy.ts";
+static const char *OUTPUT_MP4 = test_generated_pre "5.1_copy.mp4";
+static const char *OUTPUT_TWICE = test_generated_pre "5.1_twice.mp4";
+
+/**
+ * @return The number of packets, or a negative error code.
+ */
+static int packets_count(const char *url) {
+  int ret, count = 0;
+  int64_t last_dts = INT64_MIN;
+  pollux_demux_t *dm;
+  pollux_packet_t *p;
+
+  ret = pollux_demux_init(&dm);
+  if (ret)
+    return ret;
+
+  ret = dm->param_set(dm, url, nullptr);
+  if (ret) {
+    sirius_error("demux param_set: %d\n", ret);
+    goto label_free;
+  }
+
+  while ((ret = dm->read_packet(dm, &p, 0)) == 0) {
+    if (p->dts <= last_dts) {
+      sirius_error("Non-monotonic dts in %s: %lld after %lld\n", url,
+                   (long long)p->dts, (long long)last_dts);
+      dm->packet_free(dm, p);
+      ret = -1;
+      goto label_free;
+    }
+    last_dts = p->dts;
+    count++;
+    dm->packet_free(dm, p);
+  }
+  ret = ret == pollux_err_stream_end ? count : ret;
+
+label_free:
+  pollux_demux_deinit(dm);
+  return ret;
+}
+
+static int remux(pollux_remux_t *r, const char *out, pollux_cont_fmt_t fmt,
+                 const char *in, int times) {
+  int ret;
+  pollux_remux_args_t args = {0};
+
+  args.cont_fmt = fmt;
+  ret = r->param_set(r, out, &args);
+  if (ret) {
+    sirius_error("remux param_set: %d\n", ret);
+    return ret;
+  }
+
+  for (int i = 0; i < times; ++i) {
+    ret = r->append(r, in);
+    if (ret) {
+      sirius_error("append: %d\n", ret);
+      goto label_free;
+    }
+  }
+
+  ret = r->finish(r);
+
+label_free:
+  r->release(r);
+  return ret;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_remux_t *r;
+
+  ret = pollux_remux_init(&r);
+  if (ret)
+    goto label_free1;
+
+  uint64_t t0 = sirius_get_time_us();
+  ret = remux(r, OUTPUT_TS, pollux_cont_fmt_mpegts, INPUT_URL, 1);
+  ret |= remux(r, OUTPUT_MP4, pollux_cont_fmt_mp4, OUTPUT_TS, 1);
+  ret |= remux(r, OUTPUT_TWICE, pollux_cont_fmt_none, INPUT_URL, 2);
+  uint64_t t1 = sirius_get_time_us();
+  if (ret)
+    goto label_free2;
+
+  int n_in = packets_count(INPUT_URL);
+  int n_ts = packets_count(OUTPUT_TS);
+  int n_mp4 = packets_count(OUTPUT_MP4);
+  int n_twice = packets_count(OUTPUT_TWICE);
+  int n_frames = test_frames_count(OUTPUT_TS);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("remux time: %llu us\n", (unsigned long long)(t1 - t0));
+  sirius_infosp("\tpackets: input %d; ts %d; mp4 %d; twice %d\n", n_in, n_ts,
+                n_mp4, n_twice);
+  sirius_infosp("\tframes decoded from ts: %d\n", n_frames);
+  sirius_infosp("---------------------\n\n");
+
+  if (n_in <= 0 || n_ts != n_in || n_mp4 != n_in || n_twice != 2 * n_in ||
+      n_frames != n_in) {
+    sirius_error("Unexpected number of packets or frames\n");
+    ret = -1;
+  }
+
+label_free2:
+  pollux_remux_deinit(r);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,100 @@
+/**
+ * @brief Cutting test. Two ranges of the input, whose edges are not on key
+ * frames, are cut into one `mp4`. The output is checked by decoding it, the
+ * number of frames must match the length of the ranges.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_erron.h"
+#include "pollux/pollux_remux.h"
+#include "test_media.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+static const char *OUTPUT_URL = test_generated_pre "5.2_cut.mp4";
+
+static const struct {
+  int64_t start_us, end_us;
+} ranges[] = {
+  {1300000, 3700000},
+  {500000, 1000000},
+};
+
+/**
+ * @return The frame rate of the input, or a negative value on failure.
+ */
+static double frame_rate_get(const char *url) {
+  double fps = -1;
+  pollux_demux_t *dm;
+
+  if (pollux_demux_init(&dm))
+    return fps;
+
+  if (dm->param_set(dm, url, nullptr) == 0 &&
+      dm->stream.video_frame_rate.den > 0) {
+    fps = (double)dm->stream.video_frame_rate.num /
+          dm->stream.video_frame_rate.den;
+  }
+
+  pollux_demux_deinit(dm);
+  return fps;
+}
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_remux_t *r;
+  pollux_remux_args_t args = {0};
+
+  ret = pollux_remux_init(&r);
+  if (ret)
+    goto label_free1;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  ret = r->param_set(r, OUTPUT_URL, &args);
+  if (ret) {
+    sirius_error("remux param_set: %d\n", ret);
+    goto label_free2;
+  }
+
+  double seconds = 0;
+  uint64_t t0 = sirius_get_time_us();
+  for (size_t i = 0; i < sizeof(ranges) / sizeof(ranges[0]); ++i) {
+    ret = r->cut(r, INPUT_URL, ranges[i].start_us, ranges[i].end_us);
+    if (ret) {
+      sirius_error("cut: %d\n", ret);
+      goto label_free2;
+    }
+    seconds += (double)(ranges[i].end_us - ranges[i].start_us) / 1000000;
+  }
+  ret = r->finish(r);
+  uint64_t t1 = sirius_get_time_us();
+  if (ret)
+    goto label_free2;
+
+  double fps = frame_rate_get(INPUT_URL);
+  int n_frames = test_frames_count(OUTPUT_URL);
+  int n_expected = (int)(seconds * fps + 0.5);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("cut time: %llu us\n", (unsigned long long)(t1 - t0));
+  sirius_infosp("\tframes: %d; expected %d (%.2f s at %.2f fps)\n", n_frames,
+                n_expected, seconds, fps);
+  sirius_infosp("---------------------\n\n");
+
+  /**
+   * @note One frame of tolerance for each edge of each range.
+   */
+  if (fps <= 0 || n_frames < n_expected - 4 || n_frames > n_expected + 4) {
+    sirius_error("Unexpected number of frames\n");
+    ret = -1;
+  }
+
+label_free2:
+  pollux_remux_deinit(r);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,67 @@
+/**
+ * @brief Concatenation test. The `mp4` input is concatenated twice with the
+ * `avi` input, whose codec parameters differ, into one `mp4`. The first two
+ * are copied and the last one is re-encoded; the output is checked by
+ * decoding it.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_erron.h"
+#include "pollux/pollux_remux.h"
+#include "test_media.h"
+
+static const char *INPUT_MP4 = "./input1_2560-1440_video.mp4";
+static const char *INPUT_AVI = "./input2_3506-2200_video.avi";
+static const char *OUTPUT_URL = test_generated_pre "5.3_concat.mp4";
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_remux_t *r;
+  pollux_remux_args_t args = {0};
+  const char *urls[] = {INPUT_MP4, INPUT_MP4, INPUT_AVI};
+
+  ret = pollux_remux_init(&r);
+  if (ret)
+    goto label_free1;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  ret = r->param_set(r, OUTPUT_URL, &args);
+  if (ret) {
+    sirius_error("remux param_set: %d\n", ret);
+    goto label_free2;
+  }
+
+  uint64_t t0 = sirius_get_time_us();
+  ret = r->concat(r, urls, sizeof(urls) / sizeof(urls[0]));
+  if (ret) {
+    sirius_error("concat: %d\n", ret);
+    goto label_free2;
+  }
+  ret = r->finish(r);
+  uint64_t t1 = sirius_get_time_us();
+  if (ret)
+    goto label_free2;
+
+  int n_mp4 = test_frames_count(INPUT_MP4);
+  int n_avi = test_frames_count(INPUT_AVI);
+  int n_out = test_frames_count(OUTPUT_URL);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("concat time: %llu us\n", (unsigned long long)(t1 - t0));
+  sirius_infosp("\tframes: mp4 %d; avi %d; output %d\n", n_mp4, n_avi, n_out);
+  sirius_infosp("---------------------\n\n");
+
+  if (n_mp4 <= 0 || n_avi <= 0 || n_out != 2 * n_mp4 + n_avi) {
+    sirius_error("Unexpected number of frames\n");
+    ret = -1;
+  }
+
+label_free2:
+  pollux_remux_deinit(r);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
@@ -0,0 +1,76 @@
+/**
+ * @brief Chunked transcoding test. The `mp4` input is split at its key frames
+ * into four chunks, which are encoded in parallel and joined into one `mp4`.
+ * The output is checked by decoding it, the number of frames must match.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_erron.h"
+#include "pollux/pollux_remux.h"
+#include "test_media.h"
+
+static const char *INPUT_URL = "./input1_2560-1440_video.mp4";
+static const char *OUTPUT_URL = test_generated_pre "5.4_transcode.mp4";
+static const int WIDTH = 1280;
+static const int HEIGHT = 720;
+static const int CHUNK_COUNT = 4;
+
+int main() {
+  test_init();
+
+  int ret;
+  pollux_remux_t *r;
+  pollux_remux_args_t args = {0};
+  pollux_remux_transcode_args_t targs = {0};
+
+  ret = pollux_remux_init(&r);
+  if (ret)
+    goto label_free1;
+
+  args.cont_fmt = pollux_cont_fmt_mp4;
+  ret = r->param_set(r, OUTPUT_URL, &args);
+  if (ret) {
+    sirius_error("remux param_set: %d\n", ret);
+    goto label_free2;
+  }
+
+  targs.encode.bit_rate = 4 * 1024 * 1024;
+  targs.encode.img.width = WIDTH;
+  targs.encode.img.height = HEIGHT;
+  targs.encode.img.fmt = pollux_pix_fmt_yuv420p;
+  targs.encode.gop_size = 30;
+  targs.encode.thread_count = 2;
+  targs.encode.codec_id = pollux_codec_id_h264;
+  targs.chunk_count = CHUNK_COUNT;
+
+  uint64_t t0 = sirius_get_time_us();
+  ret = r->transcode(r, INPUT_URL, &targs);
+  if (ret) {
+    sirius_error("transcode: %d\n", ret);
+    goto label_free2;
+  }
+  ret = r->finish(r);
+  uint64_t t1 = sirius_get_time_us();
+  if (ret)
+    goto label_free2;
+
+  int n_in = test_frames_count(INPUT_URL);
+  int n_out = test_frames_count(OUTPUT_URL);
+
+  sirius_infosp("---------------------\n");
+  sirius_infosp("transcode time: %llu us\n", (unsigned long long)(t1 - t0));
+  sirius_infosp("\tframes: input %d; output %d\n", n_in, n_out);
+  sirius_infosp("---------------------\n\n");
+
+  if (n_in <= 0 || n_out != n_in) {
+    sirius_error("Unexpected number of frames\n");
+    ret = -1;
+  }
+
+label_free2:
+  pollux_remux_deinit(r);
+label_free1:
+  test_deinit();
+
+  return ret;
+}
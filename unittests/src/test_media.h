@@ -0,0 +1,131 @@
+#ifndef POLLUX_TEST_MEDIA_H
+#define POLLUX_TEST_MEDIA_H
+
+/**
+ * @brief The helpers of the C tests, which make the frames to encode and check
+ * the outputs through the pollux `API`.
+ */
+
+#include "pollux/pollux_decode.h"
+#include "pollux/pollux_demux.h"
+#include "pollux/pollux_erron.h"
+#include "test.h"
+
+#define TEST_KEY_FRAMES_MAX (256)
+
+/**
+ * @brief The key frames of an output, see `test_output_analyze`.
+ */
+typedef struct {
+  /**
+   * @brief The pts of the key frames, unit: us.
+   */
+  int64_t pts[TEST_KEY_FRAMES_MAX];
+  int count;
+
+  /**
+   * @brief The first frame is a key frame.
+   */
+  bool first_key;
+  int64_t frames;
+} test_key_frames_t;
+
+/**
+ * @brief Fill a `yuv420p` frame with a pattern which changes with `index`, so
+ * that the encoder cannot skip it.
+ */
+static inline void test_frame_fill(pollux_frame_t *f, int index) {
+  int width = f->width, height = f->height;
+
+  for (int y = 0; y < height; ++y) {
+    memset(f->data[0] + y * f->linesize[0], (index * 3 + y) & 0xff, width);
+  }
+  for (int y = 0; y < height / 2; ++y) {
+    memset(f->data[1] + y * f->linesize[1], 128, width / 2);
+    memset(f->data[2] + y * f->linesize[2], index & 0xff, width / 2);
+  }
+}
+
+/**
+ * @return The number of frames decoded from the url, or a negative error code.
+ */
+static inline int test_frames_count(const char *url) {
+  int ret, count = 0;
+  pollux_decode_t *d;
+  pollux_decode_args_t args = {0};
+  pollux_frame_t *f;
+
+  ret = pollux_decode_init(&d);
+  if (ret)
+    return ret;
+
+  args.cache_count = 8;
+  args.thread_count = 4;
+  ret = d->param_set(d, url, &args);
+  if (ret) {
+    sirius_error("decode param_set: %d\n", ret);
+    goto label_free;
+  }
+
+  while ((ret = d->result_get(d, &f, 3000)) == 0) {
+    count++;
+    d->result_free(d, f);
+  }
+  ret = ret == pollux_err_stream_end ? count : ret;
+
+label_free:
+  pollux_decode_deinit(d);
+  return ret;
+}
+
+static inline void test_key_frames_cb(const pollux_demux_frame_info_t *info,
+                                      void *opaque) {
+  test_key_frames_t *k = (test_key_frames_t *)opaque;
+  bool key = info->flags & POLLUX_PACKET_FLAG_KEY;
+
+  if (k->frames++ == 0)
+    k->first_key = key;
+  if (key && k->count < TEST_KEY_FRAMES_MAX)
+    k->pts[k->count++] = info->pts;
+}
+
+/**
+ * @brief Analyze an output without decoding it.
+ *
+ * @param[in] url The output.
+ * @param[out] k The key frames, nullptr if they are not needed.
+ * @param[out] r The analysis.
+ *
+ * @return 0 on success, error code otherwise.
+ */
+static inline int test_output_analyze(const char *url, test_key_frames_t *k,
+                                      pollux_demux_analysis_t *r) {
+  int ret;
+  pollux_demux_t *dm;
+  pollux_demux_analyze_args_t args = {0};
+
+  ret = pollux_demux_init(&dm);
+  if (ret)
+    return ret;
+
+  ret = dm->param_set(dm, url, nullptr);
+  if (ret) {
+    sirius_error("demux param_set: %d\n", ret);
+    goto label_free;
+  }
+
+  if (k) {
+    memset(k, 0, sizeof(test_key_frames_t));
+    args.frame_cb = test_key_frames_cb;
+    args.opaque = k;
+  }
+  ret = dm->analyze(dm, &args, r);
+  if (ret)
+    sirius_error("analyze: %d\n", ret);
+
+label_free:
+  pollux_demux_deinit(dm);
+  return ret;
+}
+
+#endif // POLLUX_TEST_MEDIA_H